@@ -94,7 +94,8 @@ class FileSystem {
                 OpenFileTable[idx] = new OpenFile(fileDescriptor);
                 DEBUG(dbgTraCode,
                       "Created a new OpenFile and stored into OpenFileTable");
-                OpenFileNames[idx] = name;
+                OpenFileNames[idx] = new char[strlen(name) + 1];
+                strcpy(OpenFileNames[idx], name);
                 DEBUG(dbgTraCode,
                       "Created a new OpenFile and stored its name into "
                       "OpenFileNames");
@@ -165,6 +166,7 @@ class FileSystem {
         // int retval = Close(OpenFileFD[id]);
         delete OpenFileTable[id];
         OpenFileTable[id] = NULL;
+        delete[] OpenFileNames[id];
         OpenFileNames[id] = NULL;
         return 1;
     }
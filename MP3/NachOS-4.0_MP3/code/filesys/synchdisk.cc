@@ -53,7 +53,10 @@ SynchDisk::~SynchDisk() {
 //----------------------------------------------------------------------
 
 void SynchDisk::ReadSector(int sectorNumber, char* data) {
+    int queued = kernel->stats->totalTicks;
+
     lock->Acquire();  // only one disk I/O at a time
+    kernel->stats->disk.Queued(queued);
     disk->ReadRequest(sectorNumber, data);
     semaphore->P();  // wait for interrupt
     lock->Release();
@@ -69,7 +72,10 @@ void SynchDisk::ReadSector(int sectorNumber, char* data) {
 //----------------------------------------------------------------------
 
 void SynchDisk::WriteSector(int sectorNumber, char* data) {
+    int queued = kernel->stats->totalTicks;
+
     lock->Acquire();  // only one disk I/O at a time
+    kernel->stats->disk.Queued(queued);
     disk->WriteRequest(sectorNumber, data);
     semaphore->P();  // wait for interrupt
     lock->Release();
@@ -44,6 +44,9 @@ class SynchDisk : public CallBackObj {
                       // handler, to signal that the
                       // current disk operation is complete.
 
+    void Checkpoint(CheckpointFile *file) { disk->Checkpoint(file); }
+    // Write out, or read in, the disk
+
    private:
     Disk *disk;            // Raw disk device
     Semaphore *semaphore;  // To synchronize requesting thread
@@ -15,7 +15,8 @@
 //----------------------------------------------------------------------
 // Debug::Debug
 //      Initialize so that only DEBUG messages with a flag in flagList
-//	will be printed.
+//	will be printed.  The flags are looked up in a table, so that
+//	Debug::IsEnabled (in debug.h) is cheap.
 //
 //	If the flag is "+", we enable all DEBUG messages.
 //
@@ -24,18 +25,12 @@
 //----------------------------------------------------------------------
 
 Debug::Debug(char *flagList) {
-    enableFlags = flagList;
-}
+    bool all = (flagList != NULL && strchr(flagList, dbgAll) != 0);
 
-//----------------------------------------------------------------------
-// Debug::IsEnabled
-//      Return TRUE if DEBUG messages with "flag" are to be printed.
-//----------------------------------------------------------------------
-
-bool Debug::IsEnabled(char flag) {
-    if (enableFlags != NULL) {
-        return ((strchr(enableFlags, flag) != 0) || (strchr(enableFlags, '+') != 0));
-    } else {
-        return FALSE;
+    for (int i = 0; i < 128; i++) {
+        enabled[i] = all;
+    }
+    for (char *p = flagList; p != NULL && *p != '\0'; p++) {
+        enabled[*p & 0x7f] = TRUE;
     }
 }
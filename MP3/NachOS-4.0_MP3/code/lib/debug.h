@@ -30,26 +30,41 @@ const char dbgAddr = 'a';    // address spaces
 const char dbgNet = 'n';     // network emulation
 const char dbgSys = 'u';     // systemcall
 const char dbgTraCode = 'c';
-const char dbgZ = 'z';  // multilevel feedback queue
+const char dbgZ = 'z';     // multilevel feedback queue
+const char dbgExit = 'x';  // user registers and memory at Exit
 
 class Debug {
    public:
     Debug(char *flagList);
 
-    bool IsEnabled(char flag);
+    bool IsEnabled(char flag) { return enabled[flag & 0x7f]; }
 
    private:
-    char *enableFlags;  // controls which DEBUG messages are printed
+    bool enabled[128];  // controls which DEBUG messages are printed;
+                        // looked up on every simulated instruction,
+                        // so kept as a table rather than a string
 };
 
-extern Debug *debug;
+extern THREAD_LOCAL Debug *debug;
+
+//----------------------------------------------------------------------
+// DEBUG_ENABLED
+//      TRUE if DEBUG messages with "flag" are to be printed.  If Nachos
+//	is compiled with -DNO_DEBUG, it is always FALSE, and the compiler
+//	drops every DEBUG (and TRACE) along with the test.
+//----------------------------------------------------------------------
+#ifdef NO_DEBUG
+#define DEBUG_ENABLED(flag) FALSE
+#else
+#define DEBUG_ENABLED(flag) debug->IsEnabled(flag)
+#endif
 
 //----------------------------------------------------------------------
 // DEBUG
 //      If flag is enabled, print a message.
 //----------------------------------------------------------------------
 #define DEBUG(flag, expr)          \
-    if (!debug->IsEnabled(flag)) { \
+    if (!DEBUG_ENABLED(flag)) {    \
     } else {                       \
         cerr << expr << "\n";      \
     }
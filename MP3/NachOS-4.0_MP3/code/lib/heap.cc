@@ -0,0 +1,213 @@
+// heap.cc
+//     	Routines to manage a priority queue of "things", kept as a
+//	binary heap.  Heaps are implemented as templates so that we
+//	can store anything in them in a type-safe manner.
+//
+//	The items are copied into an array, so no memory is allocated
+//	to put an item into the heap, except when the array is full and
+//	has to be doubled in size.  Normally that only happens while
+//	the heap is first filling up.
+//
+//     	NOTE: Mutual exclusion must be provided by the caller.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+//----------------------------------------------------------------------
+// Heap<T>::Heap
+//	Initialize a heap, empty to start with.
+//
+//	"comp" is the function for ordering the items
+//	"size" is how many items there is room for at first
+//----------------------------------------------------------------------
+
+template <class T>
+Heap<T>::Heap(int (*comp)(T x, T y), int size) {
+    ASSERT(size > 0);
+    compare = comp;
+    elements = new HeapElement<T>[size];
+    numInHeap = 0;
+    numSlots = size;
+    numInserted = 0;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::~Heap
+//	Prepare a heap for deallocation.
+//      This does *NOT* free the data the items point to.
+//----------------------------------------------------------------------
+
+template <class T>
+Heap<T>::~Heap() {
+    delete[] elements;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::Before
+//	Return TRUE if "x" should come out of the heap before "y":
+//	if it is smaller, or equal but put in first.  The comparison
+//	of the sequence numbers still works after they wrap around.
+//----------------------------------------------------------------------
+
+template <class T>
+bool Heap<T>::Before(HeapElement<T> *x, HeapElement<T> *y) const {
+    int order = (*compare)(x->item, y->item);
+
+    if (order != 0) {
+        return order < 0;
+    }
+    return (int)(x->seq - y->seq) < 0;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::Grow
+//	Double the size of the array holding the heap.
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::Grow() {
+    HeapElement<T> *bigger = new HeapElement<T>[numSlots * 2];
+
+    for (int i = 0; i < numInHeap; i++) {
+        bigger[i] = elements[i];
+    }
+    delete[] elements;
+    elements = bigger;
+    numSlots *= 2;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::Insert
+//      Put an "item" into the heap: add it at the bottom, then
+//	swap it with its parent until the parent is smaller.
+//
+//	"item" is the thing to put into the heap.
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::Insert(T item) {
+    HeapElement<T> element;
+    int i, parent;
+
+    if (numInHeap == numSlots) {
+        Grow();
+    }
+    element.item = item;
+    element.seq = numInserted++;
+
+    for (i = numInHeap++; i > 0; i = parent) {
+        parent = (i - 1) / 2;
+        if (!Before(&element, &elements[parent])) {
+            break;
+        }
+        elements[i] = elements[parent];
+    }
+    elements[i] = element;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::RemoveFront
+//      Take the smallest item out of the heap: move the last item
+//	into the hole at the root, then swap it with its smaller child
+//	until both children are larger.
+//
+//	Returns the item taken out.  The heap must not be empty.
+//----------------------------------------------------------------------
+
+template <class T>
+T Heap<T>::RemoveFront() {
+    T front;
+    HeapElement<T> last;
+    int i, child;
+
+    ASSERT(numInHeap > 0);
+    front = elements[0].item;
+    last = elements[--numInHeap];
+
+    for (i = 0; (child = 2 * i + 1) < numInHeap; i = child) {
+        if (child + 1 < numInHeap &&
+            Before(&elements[child + 1], &elements[child])) {
+            child++;
+        }
+        if (!Before(&elements[child], &last)) {
+            break;
+        }
+        elements[i] = elements[child];
+    }
+    elements[i] = last;
+    return front;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::Apply
+//      Apply function to every item in the heap, in the order they
+//	would come out.  Works on a copy of the heap, so it is slow;
+//	only meant for printing.
+//
+//	"func" is the procedure to apply.
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::Apply(void (*func)(T)) const {
+    Heap<T> *copy = new Heap<T>(compare, numSlots);
+
+    for (int i = 0; i < numInHeap; i++) {
+        copy->elements[i] = elements[i];
+    }
+    copy->numInHeap = numInHeap;
+    while (!copy->IsEmpty()) {
+        (*func)(copy->RemoveFront());
+    }
+    delete copy;
+}
+
+//----------------------------------------------------------------------
+// Heap::SanityCheck
+//      Test whether this is still a legal heap.
+//
+//	Tests: is every item in the right order with its parent?
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::SanityCheck() const {
+    ASSERT(numInHeap >= 0 && numInHeap <= numSlots);
+    for (int i = 1; i < numInHeap; i++) {
+        ASSERT(!Before(&elements[i], &elements[(i - 1) / 2]));
+    }
+}
+
+//----------------------------------------------------------------------
+// Heap::SelfTest
+//      Test whether this module is working.
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::SelfTest(T *p, int numEntries) {
+    int i, j;
+    T *q = new T[numEntries * 2];
+
+    // put everything in twice, so that there are equal items
+    for (j = 0; j < 2; j++) {
+        for (i = 0; i < numEntries; i++) {
+            Insert(p[i]);
+            SanityCheck();
+        }
+    }
+    ASSERT(NumInHeap() == numEntries * 2);
+
+    // should be able to get out everything we put in,
+    // in the right order
+    for (i = 0; i < numEntries * 2; i++) {
+        q[i] = RemoveFront();
+        SanityCheck();
+    }
+    ASSERT(IsEmpty());
+    for (i = 0; i < (numEntries * 2 - 1); i++) {
+        ASSERT((*compare)(q[i], q[i + 1]) <= 0);
+    }
+
+    delete[] q;
+}
@@ -0,0 +1,96 @@
+// heap.h
+//	Data structures to manage a priority queue, kept as a binary
+//	heap in an array.
+//
+//	Like a SortedList, a Heap hands items back smallest first, as
+//	decided by a "Compare" function; items that compare equal come
+//	back in the order they were put in.  Unlike a SortedList, putting
+//	an item in or taking the smallest one out only takes O(log n)
+//	steps, and nothing is allocated per item: the items are copied
+//	into an array, which only grows when it is full.
+//
+//	Allocation and deallocation of anything the items point to are
+//	to be done by the caller.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef HEAP_H
+#define HEAP_H
+
+#include "copyright.h"
+#include "debug.h"
+
+// The following class defines a "heap element" -- one item, and
+// when it was put into the heap, so that equal items can be kept
+// in first-in, first-out order.
+//
+// This class is private to this module.  Made public for
+// notational convenience.
+
+template <class T>
+class HeapElement {
+   public:
+    T item;             // item in the heap
+    unsigned int seq;   // how many items were put in before it
+};
+
+// The following class defines a "heap" -- a binary tree of items
+// stored in an array, where no item is larger than its children,
+// so that the smallest item is always at the root.
+// All types to be inserted into a heap must have a "Compare"
+// function defined, as for a SortedList:
+//	   int Compare(T x, T y)
+//		returns -1 if x < y
+//		returns 0 if x == y
+//		returns 1 if x > y
+
+template <class T>
+class Heap {
+   public:
+    Heap(int (*comp)(T x, T y), int size = 16);
+    // initialize a heap, with room for
+    // "size" items to start with
+    ~Heap();  // de-allocate the heap
+
+    void Insert(T item);  // put an item into the heap
+
+    T Front() {
+        ASSERT(numInHeap > 0);
+        return elements[0].item;
+    }
+    // Return the smallest item
+    // without removing it
+    T RemoveFront();  // Take the smallest item out of the heap
+
+    int NumInHeap() { return numInHeap; }
+    // how many items in the heap?
+    bool IsEmpty() { return numInHeap == 0; }
+    // is the heap empty?
+
+    void Apply(void (*f)(T)) const;
+    // apply function to all items in the
+    // heap, smallest first
+
+    void SanityCheck() const;  // has this heap been corrupted?
+    void SelfTest(T *p, int numEntries);
+    // verify module is working
+
+   private:
+    int (*compare)(T x, T y);  // function for ordering heap items
+    HeapElement<T> *elements;  // the heap; children of elements[i]
+                               // are at 2i+1 and 2i+2
+    int numInHeap;             // number of items in the heap
+    int numSlots;              // room in "elements"
+    unsigned int numInserted;  // items put into the heap, ever
+
+    bool Before(HeapElement<T> *x, HeapElement<T> *y) const;
+    // should x come out before y?
+    void Grow();  // double the room in "elements"
+};
+
+#include "heap.cc"  // templates are really like macros
+                    // so needs to be included in every
+                    // file that uses the template
+#endif              // HEAP_H
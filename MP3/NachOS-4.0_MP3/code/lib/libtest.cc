@@ -1,6 +1,8 @@
 // libtest.cc
 //	Driver code to call self-test routines for standard library
-//	classes -- bitmaps, lists, sorted lists, and hash tables.
+//	classes -- bitmaps, lists, sorted lists, heaps, and hash tables.
+//	Also a benchmark of heaps against sorted lists, used as queues
+//	of pending events.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -11,6 +13,7 @@
 #include "bitmap.h"
 #include "copyright.h"
 #include "hash.h"
+#include "heap.h"
 #include "list.h"
 #include "sysdep.h"
 
@@ -30,6 +33,18 @@ IntCompare(int x, int y) {
         return 1;
 }
 
+//----------------------------------------------------------------------
+// TensCompare
+//	Compare two integers by their tens digit alone, so that the
+//	order among integers with the same tens digit is up to the
+//	container.  Used to check that Heaps are first-in, first-out.
+//----------------------------------------------------------------------
+
+static int
+TensCompare(int x, int y) {
+    return IntCompare(x / 10, y / 10);
+}
+
 //----------------------------------------------------------------------
 // HashInt, HashKey
 //	Compute a hash function on an integer.  Serves as the
@@ -57,6 +72,11 @@ HashKey(char *str) {
 // Array of values to be inserted into a List or SortedList.
 static int listTestVector[] = {9, 5, 7};
 
+// Array of values to be inserted into a Heap, ordered by TensCompare,
+// and the order they should come out in.
+static int fifoTestVector[] = {32, 15, 37, 11, 30, 19};
+static int fifoTestResult[] = {15, 11, 19, 32, 37, 30};
+
 // Array of values to be inserted into the HashTable
 // There are enough here to force a ReHash().
 static char *hashTestVector[] = {"0", "1", "2", "3", "4", "5", "6",
@@ -64,7 +84,7 @@ static char *hashTestVector[] = {"0", "1", "2", "3", "4", "5", "6",
 
 //----------------------------------------------------------------------
 // LibSelfTest
-//	Run self tests on bitmaps, lists, sorted lists, and
+//	Run self tests on bitmaps, lists, sorted lists, heaps, and
 //	hash tables.
 //----------------------------------------------------------------------
 
@@ -72,16 +92,147 @@ void LibSelfTest() {
     Bitmap *map = new Bitmap(200);
     List<int> *list = new List<int>;
     SortedList<int> *sortList = new SortedList<int>(IntCompare);
+    Heap<int> *heap = new Heap<int>(IntCompare, 2);  // small, so it grows
+    Heap<int> *fifoHeap = new Heap<int>(TensCompare);
     HashTable<int, char *> *hashTable =
         new HashTable<int, char *>(HashKey, HashInt);
+    int i;
 
     map->SelfTest();
     list->SelfTest(listTestVector, sizeof(listTestVector) / sizeof(int));
     sortList->SelfTest(listTestVector, sizeof(listTestVector) / sizeof(int));
+    heap->SelfTest(listTestVector, sizeof(listTestVector) / sizeof(int));
+    for (i = 0; i < (int)(sizeof(fifoTestVector) / sizeof(int)); i++) {
+        fifoHeap->Insert(fifoTestVector[i]);
+    }
+    for (i = 0; i < (int)(sizeof(fifoTestResult) / sizeof(int)); i++) {
+        ASSERT(fifoHeap->RemoveFront() == fifoTestResult[i]);
+    }
     hashTable->SelfTest(hashTestVector, sizeof(hashTestVector) / sizeof(char *));
 
     delete map;
     delete list;
     delete sortList;
+    delete heap;
+    delete fifoHeap;
     delete hashTable;
 }
+
+// An event in the benchmark below: a stand-in for PendingInterrupt.
+class BenchEvent {
+   public:
+    int when;  // when the event is due
+};
+
+static int
+EventCompare(BenchEvent x, BenchEvent y) {
+    return IntCompare(x.when, y.when);
+}
+
+static int
+EventPtrCompare(BenchEvent *x, BenchEvent *y) {
+    return IntCompare(x->when, y->when);
+}
+
+//----------------------------------------------------------------------
+// NextDelay
+//	Return a pseudo-random delay for the benchmark below, from a
+//	private generator, so that every queue sees the same events
+//	and the kernel's random numbers (-rs) are left alone.
+//----------------------------------------------------------------------
+
+static int
+NextDelay(unsigned int *seed) {
+    *seed = *seed * 1103515245 + 12345;
+    return 1 + (*seed >> 16) % 1000;
+}
+
+//----------------------------------------------------------------------
+// HoldList, HoldHeap
+//	Time "numSteps" steps of the classic "hold" workload on a queue
+//	of pending events: take the soonest event out, and schedule a
+//	new one some random time after it.  "numOutstanding" events are
+//	queued up first, and stay queued throughout.
+//
+//	HoldList keeps the events the way Interrupt used to: allocated
+//	one by one, on a SortedList.  HoldHeap keeps them the way it
+//	does now, copied into a Heap.
+//
+//	Returns the time taken, in seconds of host time.
+//----------------------------------------------------------------------
+
+static double
+HoldList(int numOutstanding, int numSteps) {
+    SortedList<BenchEvent *> *queue =
+        new SortedList<BenchEvent *>(EventPtrCompare);
+    unsigned int seed = numOutstanding;
+    BenchEvent *event;
+    double start;
+    int i, now;
+
+    for (i = 0; i < numOutstanding; i++) {
+        event = new BenchEvent;
+        event->when = NextDelay(&seed);
+        queue->Insert(event);
+    }
+    start = HostTime();
+    for (i = 0; i < numSteps; i++) {
+        event = queue->RemoveFront();
+        now = event->when;
+        delete event;
+        event = new BenchEvent;
+        event->when = now + NextDelay(&seed);
+        queue->Insert(event);
+    }
+    start = HostTime() - start;
+    while (!queue->IsEmpty()) {
+        delete queue->RemoveFront();
+    }
+    delete queue;
+    return start;
+}
+
+static double
+HoldHeap(int numOutstanding, int numSteps) {
+    Heap<BenchEvent> *queue = new Heap<BenchEvent>(EventCompare);
+    unsigned int seed = numOutstanding;
+    BenchEvent event;
+    double start;
+    int i;
+
+    for (i = 0; i < numOutstanding; i++) {
+        event.when = NextDelay(&seed);
+        queue->Insert(event);
+    }
+    start = HostTime();
+    for (i = 0; i < numSteps; i++) {
+        event = queue->RemoveFront();
+        event.when += NextDelay(&seed);
+        queue->Insert(event);
+    }
+    start = HostTime() - start;
+    delete queue;
+    return start;
+}
+
+//----------------------------------------------------------------------
+// QueueBenchmark
+//	Compare how fast SortedLists and Heaps work as queues of pending
+//	events (as in Interrupt::Schedule), with more and more events
+//	outstanding.  Prints the time for each in microseconds per step.
+//----------------------------------------------------------------------
+
+void QueueBenchmark() {
+    static const int numOutstanding[] = {16, 256, 4096, 16384};
+    const int numSteps = 20000;
+    double listTime, heapTime;
+
+    for (unsigned i = 0; i < sizeof(numOutstanding) / sizeof(int); i++) {
+        listTime = HoldList(numOutstanding[i], numSteps);
+        heapTime = HoldHeap(numOutstanding[i], numSteps);
+        cout << "Pending events: " << numOutstanding[i]
+             << ", usec per event: sorted list "
+             << listTime * 1000000 / numSteps << ", heap "
+             << heapTime * 1000000 / numSteps << "\n";
+    }
+}
@@ -11,5 +11,6 @@
 #include "copyright.h"
 
 extern void LibSelfTest();
+extern void QueueBenchmark();  // time Heap against SortedList
 
 #endif  // LIBTEST_H
@@ -27,6 +27,8 @@
 
 #include <stdlib.h>
 #include <sys/file.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/un.h>
@@ -43,6 +45,11 @@
 #include <fcntl.h>
 #endif
 
+#ifdef LINUX
+#include <linux/perf_event.h>  // for the host's hardware counters
+#include <sys/syscall.h>
+#endif
+
 #ifdef LINUX  // at this point, linux doesn't support mprotect
 #define NO_MPROT
 #endif
@@ -83,7 +90,7 @@ unsigned sleep(unsigned);
 
 #ifdef OSF_OR_AIX
 int mprotect(const void *, long unsigned int, int);
-#else
+#elif !defined(LINUX)  // <sys/mman.h> declares it on Linux
 int mprotect(char *, unsigned int, int);
 #endif
 #endif
@@ -139,6 +146,112 @@ void UDelay(unsigned int useconds) {
     // #endif /* SOLARIS */
 }
 
+//----------------------------------------------------------------------
+// HostTime
+// 	Return the wall-clock time of the UNIX host in seconds.  Only
+//	used to report how fast the simulation runs, never to drive it.
+//----------------------------------------------------------------------
+
+double HostTime() {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+//----------------------------------------------------------------------
+// OpenHostCounters
+// 	Start counting, for this host thread, the user-mode cycles,
+//	instructions and cache misses of the host, as one perf_event
+//	group so that they are read together.  Stops at the first one
+//	the host will not count: it may have no counters, or be a
+//	virtual machine that hides them, or not let us use them.
+//
+//	"fileNos" -- set to the UNIX file number of each counter opened,
+//		the first being the group's
+//
+// Returns:
+//	how many were opened, from 0 to MaxHostCounters
+//----------------------------------------------------------------------
+
+int OpenHostCounters(int *fileNos) {
+    int count = 0;
+
+#ifdef LINUX
+    static const unsigned long long events[MaxHostCounters] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES};
+    struct perf_event_attr attr;
+
+    for (; count < MaxHostCounters; count++) {
+        bzero(&attr, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = events[count];
+        attr.disabled = (count == 0);  // the group starts all at once
+        attr.exclude_kernel = 1;       // not the system calls that read it
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        fileNos[count] = syscall(SYS_perf_event_open, &attr, 0, -1,
+                                 count == 0 ? -1 : fileNos[0], 0);
+        if (fileNos[count] < 0) {
+            break;
+        }
+    }
+    if (count > 0) {
+        ioctl(fileNos[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+    return count;
+}
+
+//----------------------------------------------------------------------
+// ReadHostCounters
+// 	Read the "count" counters opened by OpenHostCounters into
+//	"values", with one system call.
+//----------------------------------------------------------------------
+
+void ReadHostCounters(int *fileNos, int count, unsigned long long *values) {
+    unsigned long long group[1 + MaxHostCounters];  // how many, then each
+
+    if (read(fileNos[0], (char *)group, sizeof(group)) <
+        (int)((1 + count) * sizeof(group[0]))) {
+        group[0] = 0;
+    }
+    for (int i = 0; i < count; i++) {
+        values[i] = (i < (int)group[0]) ? group[1 + i] : 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// CloseHostCounters
+// 	Stop counting, and close the counters.
+//----------------------------------------------------------------------
+
+void CloseHostCounters(int *fileNos, int count) {
+    for (int i = count - 1; i >= 0; i--) {
+        Close(fileNos[i]);
+    }
+}
+
+//----------------------------------------------------------------------
+// HostCycles
+// 	Return the host's time-stamp counter: on x86, cycles at a fixed
+//	rate, whatever the processor is doing.  Elsewhere, nanoseconds
+//	of wall-clock time.
+//----------------------------------------------------------------------
+
+unsigned long long HostCycles() {
+#if defined(x86) || defined(x86_64)
+    unsigned int low, high;
+
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((unsigned long long)high << 32) | low;
+#else
+    return (unsigned long long)(HostTime() * 1e9);
+#endif
+}
+
 //----------------------------------------------------------------------
 // Abort
 // 	Quit and drop core.
@@ -157,16 +270,79 @@ void Exit(int exitCode) { exit(exitCode); }
 // RandomInit
 // 	Initialize the pseudo-random number generator.  We use the
 //	now obsolete "srand" and "rand" because they are more portable!
+//
+//	On Linux, each host thread has a generator of its own, so that
+//	simulations running side by side (see threads/batch.h) do not
+//	take numbers from each other.  It is set up the way srand sets
+//	up the shared one, so the numbers are the same.
 //----------------------------------------------------------------------
 
-void RandomInit(unsigned seed) { srand(seed); }
+// the seed last given, and the numbers taken since, for RandomPosition
+static THREAD_LOCAL unsigned randomSeed = 1;  // as if srand was never called
+static THREAD_LOCAL int randomDrawn = 0;
+
+#ifdef LINUX
+static THREAD_LOCAL struct random_data randomData;
+static THREAD_LOCAL char randomState[128];  // as big as rand's own
+static THREAD_LOCAL bool randomReady = FALSE;
+
+void RandomInit(unsigned seed) {
+    memset(&randomData, 0, sizeof(randomData));
+    initstate_r(seed, randomState, sizeof(randomState), &randomData);
+    randomReady = TRUE;
+    randomSeed = seed;
+    randomDrawn = 0;
+}
+#else
+void RandomInit(unsigned seed) {
+    srand(seed);
+    randomSeed = seed;
+    randomDrawn = 0;
+}
+#endif
 
 //----------------------------------------------------------------------
 // RandomNumber
 // 	Return a pseudo-random number.
 //----------------------------------------------------------------------
 
-unsigned int RandomNumber() { return rand(); }
+#ifdef LINUX
+unsigned int RandomNumber() {
+    int32_t number;
+
+    if (!randomReady) {
+        RandomInit(1);  // as rand does, if srand was never called
+    }
+    random_r(&randomData, &number);
+    randomDrawn++;
+    return number;
+}
+#else
+unsigned int RandomNumber() {
+    randomDrawn++;
+    return rand();
+}
+#endif
+
+//----------------------------------------------------------------------
+// RandomPosition, RandomRestore
+// 	Return how far along the pseudo-random number generator is, and
+//	later put it back there.  The state of the generator itself is
+//	opaque, so it is set up again from the seed, and the same number
+//	of numbers is drawn.
+//----------------------------------------------------------------------
+
+void RandomPosition(unsigned *seed, int *drawn) {
+    *seed = randomSeed;
+    *drawn = randomDrawn;
+}
+
+void RandomRestore(unsigned seed, int drawn) {
+    RandomInit(seed);
+    while (randomDrawn < drawn) {
+        (void)RandomNumber();
+    }
+}
 
 //----------------------------------------------------------------------
 // AllocBoundedArray
@@ -177,6 +353,10 @@ unsigned int RandomNumber() { return rand(); }
 //
 //	Note: Just return the useful part!
 //
+//	The array gets pages of its own, since only whole pages can be
+//	protected.  If "size" is not a multiple of the page size, the
+//	slack at the end of the last page is not caught.
+//
 //	"size" -- amount of useful space needed (in bytes)
 //----------------------------------------------------------------------
 
@@ -185,17 +365,20 @@ char *AllocBoundedArray(int size) {
     return new char[size];
 #else
     int pgSize = getpagesize();
-    char *ptr = new char[pgSize * 2 + size];
+    int mapSize = pgSize * 2 + divRoundUp(size, pgSize) * pgSize;
+    char *ptr = (char *)mmap(NULL, mapSize, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
 
-    mprotect(ptr, pgSize, 0);
-    mprotect(ptr + pgSize + size, pgSize, 0);
+    ASSERT(ptr != (char *)MAP_FAILED);
+    mprotect(ptr, pgSize, PROT_NONE);
+    mprotect(ptr + mapSize - pgSize, pgSize, PROT_NONE);
     return ptr + pgSize;
 #endif
 }
 
 //----------------------------------------------------------------------
 // DeallocBoundedArray
-// 	Deallocate an array of integers, unprotecting its two boundary pages.
+// 	Deallocate an array of integers, along with its two boundary pages.
 //
 //	"ptr" -- the array to be deallocated
 //	"size" -- amount of useful space in the array (in bytes)
@@ -207,12 +390,37 @@ void DeallocBoundedArray(char *ptr, int /* size */) { delete[] ptr; }
 void DeallocBoundedArray(char *ptr, int size) {
     int pgSize = getpagesize();
 
-    mprotect(ptr - pgSize, pgSize, PROT_READ | PROT_WRITE | PROT_EXEC);
-    mprotect(ptr + size, pgSize, PROT_READ | PROT_WRITE | PROT_EXEC);
-    delete[] (ptr - pgSize);
+    munmap(ptr - pgSize, pgSize * 2 + divRoundUp(size, pgSize) * pgSize);
 }
 #endif
 
+//----------------------------------------------------------------------
+// AllocExecutableArray
+// 	Return an array whose contents the host may execute, for code
+//	generated at run time.  Return NULL if the host will not give us
+//	one.
+//
+//	"size" -- amount of space needed (in bytes)
+//----------------------------------------------------------------------
+
+char *AllocExecutableArray(int size) {
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE | PROT_EXEC,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (ptr == MAP_FAILED) return NULL;
+    return (char *)ptr;
+}
+
+//----------------------------------------------------------------------
+// DeallocExecutableArray
+// 	Give back an array from AllocExecutableArray.
+//
+//	"ptr" -- the array to be deallocated
+//	"size" -- size of the array (in bytes)
+//----------------------------------------------------------------------
+
+void DeallocExecutableArray(char *ptr, int size) { munmap(ptr, size); }
+
 //----------------------------------------------------------------------
 // PollFile
 // 	Check open file or open socket to see if there are any
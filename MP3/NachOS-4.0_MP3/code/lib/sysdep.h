@@ -21,12 +21,33 @@
 
 using namespace std;
 
+// Global variables that every host thread has its own copy of, so that
+// several simulations can run at once in one process, each on a host
+// thread of its own (see threads/batch.h)
+#define THREAD_LOCAL __thread
+
 // Process control: abort, exit, and sleep
 extern void Abort();
 extern void Exit(int exitCode);
 extern void Delay(int seconds);
 extern void UDelay(unsigned int usec);  // rcgood - to avoid spinners.
 
+// Wall-clock time of the host, in seconds, for measuring simulator speed
+extern double HostTime();
+
+// The host's own hardware counters, for measuring the simulator itself
+// (nachos -hostperf): user-mode cycles, instructions and cache misses of
+// the calling host thread, in that order, read all at once.  Open
+// returns how many of them the host lets us count (0 if none); Read
+// fills in one value for each.  HostCycles is the time-stamp counter,
+// for when there are none.
+const int MaxHostCounters = 3;
+extern int OpenHostCounters(int *fileNos);
+extern void ReadHostCounters(int *fileNos, int count,
+                             unsigned long long *values);
+extern void CloseHostCounters(int *fileNos, int count);
+extern unsigned long long HostCycles();
+
 // Initialize system so that cleanUp routine is called when user hits ctl-C
 extern void CallOnUserAbort(void (*cleanup)(int));
 
@@ -34,11 +55,20 @@ extern void CallOnUserAbort(void (*cleanup)(int));
 extern void RandomInit(unsigned seed);
 extern unsigned int RandomNumber();
 
+// Find out, and go back to, how far along the generator is: the seed,
+// and how many numbers have been taken since (for checkpoints)
+extern void RandomPosition(unsigned *seed, int *drawn);
+extern void RandomRestore(unsigned seed, int drawn);
+
 // Allocate, de-allocate an array, such that de-referencing
 // just beyond either end of the array will cause an error
 extern char *AllocBoundedArray(int size);
 extern void DeallocBoundedArray(char *p, int size);
 
+// Allocate, de-allocate an array the host can execute code from
+extern char *AllocExecutableArray(int size);
+extern void DeallocExecutableArray(char *p, int size);
+
 // Check file to see if there are any characters to be read.
 // If no characters in the file, return without waiting.
 extern bool PollFile(int fd);
@@ -0,0 +1,189 @@
+// cache.cc
+//	Routines to simulate the instruction and data caches.  See
+//	cache.h for what is, and is not, modelled.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "cache.h"
+
+#include "copyright.h"
+#include "debug.h"
+#include "machine.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// Cache::Cache
+// 	Initialize an empty cache.
+//
+//	"cacheName" -- what to call it, when printing statistics
+//	"size" -- bytes in the cache
+//	"lineSize" -- bytes in each line; a power of 2, and at least 4,
+//		so that no aligned access spans two lines
+//	"ways" -- lines in each set; size / lineSize for a fully
+//		associative cache.  The number of sets must be a power of 2.
+//	"policy" -- what stores do
+//	"hitTicks", "missTicks" -- the extra time taken by a hit, and by
+//		each trip to memory
+//----------------------------------------------------------------------
+
+Cache::Cache(char *cacheName, int size, int lineSize, int ways,
+             CacheWritePolicy policy, int hitTicks, int missTicks) {
+    int numLines = size / lineSize;
+
+    ASSERT(lineSize >= 4 && (lineSize & (lineSize - 1)) == 0);
+    ASSERT(ways > 0 && numLines % ways == 0);
+    numSets = numLines / ways;
+    ASSERT(numSets > 0 && (numSets & (numSets - 1)) == 0);
+
+    name = cacheName;
+    this->lineSize = lineSize;
+    this->ways = ways;
+    writePolicy = policy;
+    this->hitTicks = hitTicks;
+    this->missTicks = missTicks;
+    numHits = numMisses = numWritebacks = 0;
+
+    tags = new int[numLines];
+    dirty = new bool[numLines];
+    lastUsed = new unsigned[numLines];
+    for (int i = 0; i < numLines; i++) {
+        tags[i] = -1;
+        dirty[i] = FALSE;
+        lastUsed[i] = 0;
+    }
+    time = 0;
+}
+
+//----------------------------------------------------------------------
+// Cache::~Cache
+// 	De-allocate the cache.
+//----------------------------------------------------------------------
+
+Cache::~Cache() {
+    delete[] tags;
+    delete[] dirty;
+    delete[] lastUsed;
+}
+
+//----------------------------------------------------------------------
+// Cache::Access
+// 	Simulate an access to physical address "physAddr", and return
+//	the ticks it took.
+//
+//	A hit costs hitTicks.  A miss costs missTicks to load the line,
+//	and missTicks more if the line it replaces is dirty.  Under
+//	WriteThrough, every store costs missTicks, hit or miss, and a
+//	store that misses leaves the cache alone.
+//
+//	"writing" -- TRUE for a store
+//	"missCount" -- counts the misses of the running thread
+//----------------------------------------------------------------------
+
+int Cache::Access(int physAddr, bool writing, int *missCount) {
+    int line = (unsigned)physAddr / lineSize;
+    int set = (line & (numSets - 1)) * ways;
+    int victim = set;
+    int ticks;
+
+    time++;
+    for (int i = set; i < set + ways; i++) {
+        if (tags[i] == line) {
+            numHits++;
+            lastUsed[i] = time;
+            if (!writing) {
+                return hitTicks;
+            } else if (writePolicy == WriteThrough) {
+                return hitTicks + missTicks;
+            }
+            dirty[i] = TRUE;
+            return hitTicks;
+        }
+        if (lastUsed[i] < lastUsed[victim]) {
+            victim = i;
+        }
+    }
+
+    numMisses++;
+    (*missCount)++;
+    if (writing && writePolicy == WriteThrough) {
+        return missTicks;  // no write allocate
+    }
+
+    ticks = missTicks;
+    if (tags[victim] != -1 && dirty[victim]) {
+        numWritebacks++;
+        ticks += missTicks;
+    }
+    DEBUG(dbgMach, "Cache " << name << " miss at " << physAddr
+                            << ", replacing line " << tags[victim]);
+    tags[victim] = line;
+    dirty[victim] = writing;
+    lastUsed[victim] = time;
+    return ticks;
+}
+
+//----------------------------------------------------------------------
+// Cache::Print
+// 	Print the cache's configuration, hits and misses.
+//----------------------------------------------------------------------
+
+void Cache::Print() {
+    int accesses = numHits + numMisses;
+
+    cout << name << ": " << numSets * ways * lineSize << " bytes, "
+         << lineSize << " byte lines, " << ways << "-way, "
+         << (writePolicy == WriteBack ? "write-back" : "write-through")
+         << "\n";
+    cout << name << ": hits " << numHits << ", misses " << numMisses;
+    cout << " (" << (accesses > 0 ? 100.0 * numHits / accesses : 0.0)
+         << "% hit), writebacks " << numWritebacks << "\n";
+}
+
+//----------------------------------------------------------------------
+// Machine::EnableCaches
+// 	Simulate an instruction cache and a data cache from now on.
+//	Either may be NULL, for none.  The machine deletes them.
+//----------------------------------------------------------------------
+
+void Machine::EnableCaches(Cache *instCache, Cache *dataCache) {
+    FreeCaches();
+    icache = instCache;
+    dcache = dataCache;
+}
+
+//----------------------------------------------------------------------
+// Machine::FreeCaches
+// 	De-allocate the caches, if there are any.
+//----------------------------------------------------------------------
+
+void Machine::FreeCaches() {
+    if (icache != NULL) delete icache;
+    if (dcache != NULL) delete dcache;
+    icache = dcache = NULL;
+}
+
+//----------------------------------------------------------------------
+// Machine::CacheAccess
+// 	Run an access to "physAddr" through "cache", and charge the time
+//	it takes: to the user, or to the kernel if it is the kernel that
+//	is reading or writing user memory.
+//----------------------------------------------------------------------
+
+void Machine::CacheAccess(Cache *cache, int physAddr, bool writing) {
+    Statistics *stats = kernel->stats;
+    ThreadStats *thread = stats->running;
+    int ticks = cache->Access(
+        physAddr, writing,
+        cache == icache ? &thread->icacheMisses : &thread->dcacheMisses);
+
+    stats->totalTicks += ticks;
+    if (kernel->interrupt->getStatus() == SystemMode) {
+        stats->systemTicks += ticks;
+    } else {
+        stats->userTicks += ticks;
+    }
+}
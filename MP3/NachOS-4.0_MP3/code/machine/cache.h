@@ -0,0 +1,77 @@
+// cache.h
+//	Data structures for simulating the caches between the CPU and
+//	main memory (nachos -icache and -dcache).
+//
+//	Without caches, every user instruction takes the same UserTick,
+//	whatever memory it touches.  With them, each instruction fetch
+//	goes through the instruction cache and each load and store through
+//	the data cache, by physical address; an access that hits costs
+//	"hitTicks" more, one that misses "missTicks" more, and the time
+//	is added to the simulated clock.  So a program that walks memory
+//	in the wrong order gets slower, as it would on real hardware.
+//
+//	Only the timing is simulated: the data itself always comes from
+//	mainMemory.  Lines are replaced least recently used first.
+//
+//	The caches are only consulted by the interpreter; when they are
+//	on, Machine::Run always uses it (as for -prof).  When they are
+//	off, the only cost is testing a NULL pointer on each access.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "copyright.h"
+#include "utility.h"
+
+// What a store does in the data cache.
+
+enum CacheWritePolicy {
+    WriteBack,    // update the line, which is written to memory when it
+                  // is replaced; a store that misses first loads the line
+    WriteThrough  // also write to memory, paying missTicks every time;
+                  // a store that misses does not load the line
+};
+
+// The following class simulates one cache.
+
+class Cache {
+   public:
+    Cache(char *cacheName, int size, int lineSize, int ways,
+          CacheWritePolicy policy, int hitTicks, int missTicks);
+    // A cache of "size" bytes, in lines of
+    // "lineSize" bytes, "ways" lines to a set
+    ~Cache();
+
+    int Access(int physAddr, bool writing, int *missCount);
+    // Look up (and if need be, load) the line
+    // holding physAddr; return the ticks that
+    // took.  A miss is also counted in
+    // *missCount (the running thread's)
+
+    void Print();  // print the hits and misses
+
+    char *name;
+    int numHits;        // accesses found in the cache
+    int numMisses;      // accesses that were not
+    int numWritebacks;  // dirty lines written back to memory
+
+   private:
+    int lineSize;                   // bytes in a line (a power of 2)
+    int ways;                       // lines in each set
+    int numSets;                    // sets in the cache (a power of 2)
+    CacheWritePolicy writePolicy;
+    int hitTicks;                   // extra time for a hit
+    int missTicks;                  // extra time to go to memory
+
+    int *tags;           // line number held by each way of each set
+                         // (physAddr / lineSize), or -1 if none
+    bool *dirty;         // written since it was loaded (WriteBack)
+    unsigned *lastUsed;  // when each line was last used, for LRU
+    unsigned time;       // counts accesses, for lastUsed
+};
+
+#endif  // CACHE_H
@@ -15,6 +15,7 @@
 #include "console.h"
 
 #include "copyright.h"
+#include "intlog.h"
 #include "main.h"
 #include "stdio.h"
 //----------------------------------------------------------------------
@@ -27,14 +28,16 @@
 //----------------------------------------------------------------------
 
 ConsoleInput::ConsoleInput(char *readFile, CallBackObj *toCall) {
-    if (readFile == NULL)
-        readFileNo = 0;  // keyboard = stdin
+    if (readFile == NULL || (kernel->interruptLog != NULL &&
+                             !kernel->interruptLog->IsRecording()))
+        readFileNo = 0;  // keyboard = stdin (never read, when replaying)
     else
         readFileNo = OpenForReadWrite(readFile, TRUE);  // should be read-only
 
     // set up the stuff to emulate asynchronous interrupts
     callWhenAvail = toCall;
     incoming = EOF;
+    kernel->interrupt->Register(this, ConsoleReadInt);
 
     // start polling for incoming keystrokes
     kernel->interrupt->Schedule(this, ConsoleTime, ConsoleReadInt);
@@ -57,29 +60,51 @@ ConsoleInput::~ConsoleInput() {
 //
 //	First check to make sure character is available.
 //	Then invoke the "callBack" registered by whoever wants the character.
+//
+//	With -record, what was found is logged; with -replay, it is taken
+//	from the log instead, and the keyboard is not looked at.
 //----------------------------------------------------------------------
 
 void ConsoleInput::CallBack() {
-    char c;
+    InterruptLog *log = kernel->interruptLog;
+    char c, found;
     int readCount;
 
     ASSERT(incoming == EOF);
-    if (!PollFile(readFileNo)) {  // nothing to be read
+    if (log == NULL || log->IsRecording()) {
+        if (!PollFile(readFileNo)) {  // nothing to be read
+            found = NoInput;
+        } else {
+            // otherwise, try to read a character
+            readCount = ReadPartial(readFileNo, &c, sizeof(char));
+            if (readCount == 0) {
+                // this seems to happen at end of file, when the
+                // console input is a regular file
+                found = EndOfInput;
+            } else {
+                ASSERT(readCount == sizeof(char));
+                found = CharInput;
+            }
+        }
+    }
+    if (log != NULL) {
+        log->Bytes(&found, 1);
+        if (found == CharInput) {
+            log->Bytes(&c, 1);
+        }
+    }
+
+    if (found == NoInput) {
         // schedule the next time to poll for a packet
         kernel->interrupt->Schedule(this, ConsoleTime, ConsoleReadInt);
     } else {
-        // otherwise, try to read a character
-        readCount = ReadPartial(readFileNo, &c, sizeof(char));
-        if (readCount == 0) {
-            // this seems to happen at end of file, when the
-            // console input is a regular file
+        if (found == EndOfInput) {
             // don't schedule an interrupt, since there will never
             // be any more input
             // just do nothing....
         } else {
             // save the character and notify the OS that
             // it is available
-            ASSERT(readCount == sizeof(char));
             incoming = c;
             kernel->stats->numConsoleCharsRead++;
         }
@@ -114,12 +139,13 @@ char ConsoleInput::GetChar() {
 
 ConsoleOutput::ConsoleOutput(char *writeFile, CallBackObj *toCall) {
     if (writeFile == NULL)
-        writeFileNo = 1;  // display = stdout
+        writeFileNo = kernel->outputFileNo;  // display = stdout
     else
         writeFileNo = OpenForWrite(writeFile);
 
     callWhenDone = toCall;
     putBusy = FALSE;
+    kernel->interrupt->Register(this, ConsoleWriteInt);
 }
 
 //----------------------------------------------------------------------
@@ -128,7 +154,7 @@ ConsoleOutput::ConsoleOutput(char *writeFile, CallBackObj *toCall) {
 //----------------------------------------------------------------------
 
 ConsoleOutput::~ConsoleOutput() {
-    if (writeFileNo != 1)
+    if (writeFileNo != kernel->outputFileNo)
         Close(writeFileNo);
 }
 
@@ -142,6 +168,7 @@ void ConsoleOutput::CallBack() {
     DEBUG(dbgTraCode, "In ConsoleOutput::CallBack(), " << kernel->stats->totalTicks);
     putBusy = FALSE;
     kernel->stats->numConsoleCharsWritten++;
+    kernel->stats->console.Finished();
     callWhenDone->CallBack();
 }
 
@@ -155,5 +182,6 @@ void ConsoleOutput::PutChar(char ch) {
     ASSERT(putBusy == FALSE);
     WriteFile(writeFileNo, &ch, sizeof(char));
     putBusy = TRUE;
+    kernel->stats->console.Started();
     kernel->interrupt->Schedule(this, ConsoleTime, ConsoleWriteInt);
 }
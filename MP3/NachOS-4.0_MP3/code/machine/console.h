@@ -44,6 +44,11 @@
 // serial input and serial output.  But conceptually simpler to
 // use two objects.
 
+// What a poll of the keyboard finds (see ConsoleInput::CallBack)
+enum ConsoleFound { NoInput,
+                    CharInput,
+                    EndOfInput };
+
 class ConsoleInput : public CallBackObj {
    public:
     ConsoleInput(char *readFile, CallBackObj *toCall);
@@ -0,0 +1,220 @@
+// costmodel.cc
+//	Routines to charge user instructions the cycles given by a cost
+//	table.  See costmodel.h for the model, and the file format.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "costmodel.h"
+
+#include <ctype.h>
+
+#include "copyright.h"
+#include "debug.h"
+#include "sysdep.h"
+
+//----------------------------------------------------------------------
+// IsLoad
+// 	Return TRUE if "op" loads register rt from memory.
+//----------------------------------------------------------------------
+
+static bool IsLoad(int op) {
+    switch (op) {
+        case OP_LB:
+        case OP_LBU:
+        case OP_LH:
+        case OP_LHU:
+        case OP_LW:
+        case OP_LWL:
+        case OP_LWR:
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// ReadsRegister
+// 	Return TRUE if "instr" reads register "reg" (which is not r0).
+//----------------------------------------------------------------------
+
+static bool ReadsRegister(Instruction *instr, int reg) {
+    switch (instr->opCode) {
+        case OP_J:
+        case OP_JAL:
+        case OP_LUI:
+        case OP_MFHI:
+        case OP_MFLO:
+        case OP_SYSCALL:
+        case OP_RFE:
+        case OP_UNIMP:
+        case OP_RES:
+            return FALSE;
+
+        case OP_SLL:  // shift by a constant: only rt
+        case OP_SRA:
+        case OP_SRL:
+            return instr->rt == reg;
+
+        case OP_ADD:  // both rs and rt
+        case OP_ADDU:
+        case OP_AND:
+        case OP_BEQ:
+        case OP_BNE:
+        case OP_DIV:
+        case OP_DIVU:
+        case OP_LWL:  // merges into rt
+        case OP_LWR:
+        case OP_MULT:
+        case OP_MULTU:
+        case OP_NOR:
+        case OP_OR:
+        case OP_SB:
+        case OP_SH:
+        case OP_SLLV:
+        case OP_SLT:
+        case OP_SLTU:
+        case OP_SRAV:
+        case OP_SRLV:
+        case OP_SUB:
+        case OP_SUBU:
+        case OP_SW:
+        case OP_SWL:
+        case OP_SWR:
+        case OP_XOR:
+            return instr->rs == reg || instr->rt == reg;
+
+        default:  // everything else: only rs
+            return instr->rs == reg;
+    }
+}
+
+//----------------------------------------------------------------------
+// CostModel::CostModel
+// 	Read the cost table from "fileName" (see costmodel.h).  A name
+//	that is neither an opcode nor a penalty is an error, as is a
+//	file that cannot be read.
+//----------------------------------------------------------------------
+
+CostModel::CostModel(char *fileName) {
+    int fileNo = OpenForReadWrite(fileName, FALSE);
+    char *text, *line, *next;
+    int size;
+
+    for (int i = 0; i <= MaxOpcode; i++) {
+        opCost[i] = 1;
+    }
+    loadUsePenalty = branchPenalty = 0;
+    multLatency = divLatency = 0;
+    lastLoadReg = 0;
+    hiLoBusy = 0;
+
+    if (fileNo < 0) {
+        cerr << "Cannot read the cost model " << fileName << "\n";
+        ASSERT(FALSE);
+    }
+    Lseek(fileNo, 0, 2);
+    size = Tell(fileNo);
+    Lseek(fileNo, 0, 0);
+    text = new char[size + 1];
+    Read(fileNo, text, size);
+    text[size] = '\0';
+    Close(fileNo);
+
+    for (line = text; *line != '\0'; line = next) {
+        char name[32], *comment;
+        int cycles;
+
+        next = strchr(line, '\n');
+        if (next != NULL) {
+            *next++ = '\0';
+        } else {
+            next = line + strlen(line);
+        }
+        comment = strchr(line, '#');
+        if (comment != NULL) *comment = '\0';
+        if (sscanf(line, "%31s", name) != 1) continue;  // blank line
+        if (sscanf(line, "%31s %d", name, &cycles) != 2 || cycles < 0) {
+            cerr << "Bad line in the cost model " << fileName << ": "
+                 << line << "\n";
+            ASSERT(FALSE);
+        }
+        SetCost(name, cycles);
+    }
+    delete[] text;
+}
+
+//----------------------------------------------------------------------
+// CostModel::SetCost
+// 	Record the cost "cycles" under "name": an opcode, as named in
+//	opStrings, or one of the penalties.  Case is ignored.
+//----------------------------------------------------------------------
+
+void CostModel::SetCost(char *name, int cycles) {
+    for (char *p = name; *p != '\0'; p++) {
+        *p = tolower(*p);
+    }
+    if (strcmp(name, "loaduse") == 0) {
+        loadUsePenalty = cycles;
+        return;
+    } else if (strcmp(name, "branch") == 0) {
+        branchPenalty = cycles;
+        return;
+    } else if (strcmp(name, "multlatency") == 0) {
+        multLatency = cycles;
+        return;
+    } else if (strcmp(name, "divlatency") == 0) {
+        divLatency = cycles;
+        return;
+    }
+
+    int length = strlen(name);
+    for (int op = 1; op <= MaxOpcode; op++) {
+        char *format = opStrings[op].format;
+
+        if (strncasecmp(format, name, length) == 0 &&
+            (format[length] == ' ' || format[length] == '\0')) {
+            ASSERT(cycles > 0);  // every instruction takes some time
+            opCost[op] = cycles;
+            return;
+        }
+    }
+    cerr << "Unknown instruction in the cost model: " << name << "\n";
+    ASSERT(FALSE);
+}
+
+//----------------------------------------------------------------------
+// CostModel::Cycles
+// 	Return the cycles taken by "instr", and remember what the
+//	penalties of the next instruction depend on.  Called once for
+//	each instruction that completes, in the order they run.
+//
+//	"taken" -- TRUE if "instr" jumped, or was a branch that was taken
+//----------------------------------------------------------------------
+
+int CostModel::Cycles(Instruction *instr, bool taken) {
+    int op = instr->opCode;
+    int cycles = opCost[op];
+
+    if (lastLoadReg != 0 && ReadsRegister(instr, lastLoadReg)) {
+        cycles += loadUsePenalty;
+    }
+    if (op == OP_MFHI || op == OP_MFLO) {
+        cycles += hiLoBusy;  // wait for the multiply or divide
+    }
+    if (taken) {
+        cycles += branchPenalty;
+    }
+
+    hiLoBusy = max(hiLoBusy - cycles, 0);
+    if (op == OP_MULT || op == OP_MULTU) {
+        hiLoBusy = multLatency;
+    } else if (op == OP_DIV || op == OP_DIVU) {
+        hiLoBusy = divLatency;
+    }
+    lastLoadReg = IsLoad(op) ? instr->rt : 0;
+    return cycles;
+}
@@ -0,0 +1,71 @@
+// costmodel.h
+//	Data structures for charging each user instruction a modelled
+//	number of cycles (nachos -cost), rather than one UserTick.
+//
+//	The cost of an instruction is the cost of its opcode, plus:
+//	    the load-use penalty, if it reads the register loaded by
+//		the instruction just before it;
+//	    the branch penalty, if it is a branch that is taken or a jump;
+//	    for MFHI and MFLO, the cycles left until the result of the last
+//		MULT or DIV is ready (the multiply and divide latencies,
+//		counted down by the cycles of the instructions since).
+//
+//	The costs are read from a file, one per line, as a name and a
+//	number of cycles.  The names are the opcodes as "-d m" prints
+//	them (in any case), and "loaduse", "branch", "multlatency" and
+//	"divlatency".  Anything after a "#" is a comment.  For example:
+//
+//		# roughly an R3000
+//		lw 2
+//		mult 1
+//		multlatency 12
+//		divlatency 35
+//		branch 1
+//
+//	Whatever the file does not mention costs 1 cycle, with no
+//	penalties or latencies: the same timing as without a model.
+//	The cycles are charged to the simulated clock, as user time.
+//	A system call is always charged one UserTick; the kernel's own
+//	time for it is charged as usual.
+//
+//	Only the interpreter charges the modelled costs; with -cost,
+//	Machine::Run always uses it.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef COSTMODEL_H
+#define COSTMODEL_H
+
+#include "copyright.h"
+#include "mipssim.h"
+
+// The following class holds the cost table, and the little pipeline
+// state the penalties depend on.
+
+class CostModel {
+   public:
+    CostModel(char *fileName);  // read the costs from "fileName"
+
+    int Cycles(Instruction *instr, bool taken);
+    // The cycles taken by "instr", which has
+    // just completed; "taken" if it changed
+    // the flow of control
+
+   private:
+    int opCost[MaxOpcode + 1];  // cycles for each opcode
+    int loadUsePenalty;         // extra cycles for using a loaded value
+                                // right away
+    int branchPenalty;          // extra cycles for a taken branch
+    int multLatency;            // cycles until a MULT's result, and a
+    int divLatency;             // DIV's, can be read from HI and LO
+
+    int lastLoadReg;  // the register loaded by the last instruction,
+                      // or 0 if it was not a load
+    int hiLoBusy;     // cycles until HI and LO are ready
+
+    void SetCost(char *name, int cycles);  // one line of the cost file
+};
+
+#endif  // COSTMODEL_H
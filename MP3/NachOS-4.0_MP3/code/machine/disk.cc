@@ -15,6 +15,7 @@
 
 #include "disk.h"
 
+#include "checkpoint.h"
 #include "copyright.h"
 #include "debug.h"
 #include "main.h"
@@ -61,6 +62,7 @@ Disk::Disk(CallBackObj *toCall) {
         WriteFile(fileno, (char *)&tmp, sizeof(int));
     }
     active = FALSE;
+    kernel->interrupt->Register(this, DiskInt);
 }
 
 //----------------------------------------------------------------------
@@ -92,6 +94,30 @@ PrintSector(bool writing, int sector, char *data) {
     cout << "\n";
 }
 
+//----------------------------------------------------------------------
+// Disk::Checkpoint
+// 	Write the whole disk image out to a checkpoint, and the state of
+//	the track buffer, or read them back in.  A checkpoint is only
+//	taken with no thread blocked, so no request can be in progress.
+//----------------------------------------------------------------------
+
+void Disk::Checkpoint(CheckpointFile *file) {
+    char *image = new char[DiskSize];
+
+    ASSERT(!active);
+    file->Int(&lastSector);
+    file->Int(&bufferInit);
+    Lseek(fileno, 0, 0);
+    if (file->IsWriting()) {
+        Read(fileno, image, DiskSize);
+    }
+    file->Bytes(image, DiskSize);
+    if (!file->IsWriting()) {
+        WriteFile(fileno, image, DiskSize);
+    }
+    delete[] image;
+}
+
 //----------------------------------------------------------------------
 // Disk::ReadRequest/WriteRequest
 // 	Simulate a request to read/write a single disk sector
@@ -122,6 +148,7 @@ void Disk::ReadRequest(int sectorNumber, char *data) {
     active = TRUE;
     UpdateLast(sectorNumber);
     kernel->stats->numDiskReads++;
+    kernel->stats->disk.Started();
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
 
@@ -140,6 +167,7 @@ void Disk::WriteRequest(int sectorNumber, char *data) {
     active = TRUE;
     UpdateLast(sectorNumber);
     kernel->stats->numDiskWrites++;
+    kernel->stats->disk.Started();
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
 
@@ -150,6 +178,7 @@ void Disk::WriteRequest(int sectorNumber, char *data) {
 
 void Disk::CallBack() {
     active = FALSE;
+    kernel->stats->disk.Finished();
     callWhenDone->CallBack();
 }
 
@@ -21,6 +21,8 @@
 #include "copyright.h"
 #include "utility.h"
 
+class CheckpointFile;
+
 // The following class defines a physical disk I/O device.  The disk
 // has a single surface, split up into "tracks", and each track split
 // up into "sectors" (the same number of sectors on each track, and each
@@ -75,6 +77,10 @@ class Disk : public CallBackObj {
     // newSector will take:
     // (seek + rotational delay + transfer)
 
+    void Checkpoint(CheckpointFile *file);
+    // Write out, or read in, the contents
+    // of the disk, and where the head is
+
    private:
     int fileno;                 // UNIX file number for simulated disk
     char diskname[32];          // name of simulated disk's file
@@ -0,0 +1,197 @@
+// hostperf.cc
+//	Routines to count the host's cycles, instructions and cache misses
+//	in each region of the simulator.  See hostperf.h for the regions,
+//	and what the counts include.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "hostperf.h"
+
+#include "copyright.h"
+#include "debug.h"
+
+// the name of each region, for -hostperf and for printing
+static const char *regionNames[NumHostRegions] = {"other", "interp",
+                                                  "translate", "tick",
+                                                  "block"};
+
+// what each counter counts, as printed
+static const char *counterNames[MaxHostCounters] = {"cycles", "instructions",
+                                                    "cache misses"};
+
+const int CalibrationReadings = 1000;  // taken to find what one costs
+
+//----------------------------------------------------------------------
+// PerInstruction
+// 	Return "count" per simulated instruction, or 0 if none were.
+//----------------------------------------------------------------------
+
+static double PerInstruction(unsigned long long count, int instructions) {
+    return instructions > 0 ? (double)count / instructions : 0.0;
+}
+
+//----------------------------------------------------------------------
+// HostPerf::HostPerf
+// 	Open the host's counters, or fall back on the time-stamp counter,
+//	and find out what one reading costs.  Then start counting, in
+//	region "other".
+//
+//	"regions" -- the regions to measure, separated by commas (see
+//		hostperf.h), or "all", or "none"
+//----------------------------------------------------------------------
+
+HostPerf::HostPerf(char *regions) {
+    unsigned long long start[MaxHostCounters];
+    char *name = regions;
+
+    for (int r = 0; r < NumHostRegions; r++) {
+        measured[r] = FALSE;
+        readings[r] = entries[r] = 0;
+        for (int i = 0; i < MaxHostCounters; i++) {
+            counts[r][i] = 0;
+        }
+    }
+    while (*name != '\0') {
+        int length = strcspn(name, ",");
+        int r;
+
+        for (r = 0; r < NumHostRegions; r++) {
+            if ((int)strlen(regionNames[r]) == length &&
+                strncmp(name, regionNames[r], length) == 0) {
+                break;
+            }
+        }
+        if (r > HostOther && r < NumHostRegions) {
+            measured[r] = TRUE;
+        } else if (length == 3 && strncmp(name, "all", 3) == 0) {
+            for (r = HostOther + 1; r < NumHostRegions; r++) {
+                measured[r] = TRUE;
+            }
+        } else if (length != 4 || strncmp(name, "none", 4) != 0) {
+            cerr << "Unknown -hostperf region in \"" << regions
+                 << "\": use interp, translate, tick, block, all or none\n";
+            ASSERT(FALSE);
+        }
+        name += length;
+        if (*name == ',') {
+            name++;
+        }
+    }
+
+    numCounters = OpenHostCounters(fileNos);
+    ReadCounters(start);
+    for (int n = 0; n < CalibrationReadings; n++) {
+        ReadCounters(last);
+    }
+    for (int i = 0; i < MaxHostCounters; i++) {
+        cost[i] = (i < numCounters || i == 0)
+                      ? (last[i] - start[i]) / CalibrationReadings
+                      : 0;
+    }
+    current = HostOther;
+    ReadCounters(last);
+}
+
+//----------------------------------------------------------------------
+// HostPerf::~HostPerf
+// 	Close the host's counters, if they were opened.
+//----------------------------------------------------------------------
+
+HostPerf::~HostPerf() { CloseHostCounters(fileNos, numCounters); }
+
+//----------------------------------------------------------------------
+// HostPerf::ReadCounters
+// 	Read the counters into "values": all of them at once, or just
+//	the time-stamp counter, as values[0].
+//----------------------------------------------------------------------
+
+void HostPerf::ReadCounters(unsigned long long *values) {
+    if (numCounters > 0) {
+        ReadHostCounters(fileNos, numCounters, values);
+    } else {
+        values[0] = HostCycles();
+    }
+}
+
+//----------------------------------------------------------------------
+// HostPerf::Switch
+// 	Count everything since the last reading against the current
+//	region, then go on counting against "region".
+//----------------------------------------------------------------------
+
+void HostPerf::Switch(HostRegion region) {
+    unsigned long long now[MaxHostCounters];
+    int numValues = numCounters > 0 ? numCounters : 1;
+
+    ReadCounters(now);
+    for (int i = 0; i < numValues; i++) {
+        counts[current][i] += now[i] - last[i];
+        last[i] = now[i];
+    }
+    readings[current]++;
+    current = region;
+}
+
+//----------------------------------------------------------------------
+// HostPerf::Print
+// 	Print, on stderr, the counts per simulated instruction: in all,
+//	and in each region measured.  Each region has the cost of the
+//	readings counted against it taken out, so the counts are what
+//	the simulator would have spent without them (less a reading's
+//	worth of noise each).
+//
+//	"instructions" -- simulated user instructions since the start
+//----------------------------------------------------------------------
+
+void HostPerf::Print(int instructions) {
+    unsigned long long net[NumHostRegions][MaxHostCounters];
+    unsigned long long total[MaxHostCounters];
+    int numValues = numCounters > 0 ? numCounters : 1;
+
+    Switch(current);  // up to now
+    for (int i = 0; i < numValues; i++) {
+        total[i] = 0;
+        for (int r = 0; r < NumHostRegions; r++) {
+            unsigned long long overhead = readings[r] * cost[i];
+
+            net[r][i] = counts[r][i] > overhead ? counts[r][i] - overhead : 0;
+            total[i] += net[r][i];
+        }
+    }
+
+    if (numCounters > 0) {
+        cerr << "Host: perf_event counters; one reading costs";
+        for (int i = 0; i < numCounters; i++) {
+            cerr << (i > 0 ? ", " : " ") << cost[i] << " " << counterNames[i];
+        }
+        cerr << "\n";
+    } else {
+        cerr << "Host: no perf_event counters, using the time-stamp counter;"
+             << " one reading costs " << cost[0] << " cycles\n";
+    }
+    cerr << "Host: per simulated instruction (" << instructions << "):";
+    for (int i = 0; i < numValues; i++) {
+        cerr << (i > 0 ? ", " : " ") << counterNames[i] << " "
+             << PerInstruction(total[i], instructions);
+    }
+    cerr << "\n";
+    for (int r = 0; r < NumHostRegions; r++) {
+        if (!measured[r] && r != HostOther) {
+            continue;
+        }
+        cerr << "Host: " << regionNames[r];
+        if (r != HostOther) {
+            cerr << ", entered " << entries[r] << " times";
+        }
+        cerr << ": " << counterNames[0] << " "
+             << PerInstruction(net[r][0], instructions) << " ("
+             << (total[0] > 0 ? 100.0 * net[r][0] / total[0] : 0.0) << "%)";
+        for (int i = 1; i < numValues; i++) {
+            cerr << ", " << counterNames[i] << " "
+                 << PerInstruction(net[r][i], instructions);
+        }
+        cerr << "\n";
+    }
+}
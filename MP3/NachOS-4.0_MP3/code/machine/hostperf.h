@@ -0,0 +1,115 @@
+// hostperf.h
+//	Data structures for measuring the simulator itself on the host
+//	(nachos -hostperf): how many host cycles, instructions and cache
+//	misses it spends per simulated user instruction, and in which
+//	parts of it.
+//
+//	The counters are the host's own, for the host thread running this
+//	simulation, through perf_event_open (see OpenHostCounters in
+//	sysdep.cc).  Where the host will not count for us, the time-stamp
+//	counter is used instead: cycles only, at a fixed rate.
+//
+//	The parts, or regions, are:
+//	    interp -- Machine::OneInstruction, the interpreter, with the
+//		kernel code it calls for exceptions and system calls;
+//	    translate -- Machine::Translate, for each instruction fetch by
+//		the interpreter and each block the block engine runs, and
+//		for loads and stores the soft TLB misses;
+//	    tick -- Interrupt::OneTick, after every user instruction and
+//		whenever the kernel enables interrupts, with the interrupt
+//		handlers and context switches it runs;
+//	    block -- Machine::RunBlock, the block and JIT engines.
+//	Everything else -- starting up, and the kernel when not called
+//	from one of these -- is "other".  Each count goes to the region
+//	innermost when it happened, so together they add up to the total.
+//
+//	Only the regions asked for are measured, since each time one is
+//	entered or left the counters are read.  Through perf_event, that
+//	is a system call (the counters leave out the kernel's part of it);
+//	the time-stamp counter is much cheaper.  What one reading costs
+//	is measured at the start, and taken out of each region; but the
+//	readings also disturb the code around them, so the regions are
+//	best compared with each other, and the total is best measured
+//	with "none": the counters are then only read at the start and at
+//	Halt.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef HOSTPERF_H
+#define HOSTPERF_H
+
+#include "copyright.h"
+#include "sysdep.h"
+#include "utility.h"
+
+enum HostRegion { HostOther, HostInterp, HostTranslate, HostTick, HostBlock };
+
+const int NumHostRegions = HostBlock + 1;
+
+// The following class holds the counts for each region, and which
+// region the simulator is in.  A region is wrapped like this:
+//
+//	HostRegion outer = perf->Enter(HostTick);
+//	...
+//	perf->Leave(outer);
+//
+// "outer" is kept on the stack of the thread that entered, so that a
+// context switch inside a region leaves the counts straight.
+
+class HostPerf {
+   public:
+    HostPerf(char *regions);
+    // Start counting; "regions" are the ones to
+    // measure, separated by commas, or "all"
+    // or "none"
+    ~HostPerf();  // close the counters
+
+    bool Entering(HostRegion region) {
+        return measured[region] && current != region;
+    }
+    // TRUE if entering "region" would start
+    // counting it: it is measured, and not
+    // being counted already
+    HostRegion Enter(HostRegion region) {
+        HostRegion outer = current;
+
+        if (measured[region]) {
+            Switch(region);
+            entries[region]++;
+        }
+        return outer;
+    }
+    // the simulator enters "region"; returns
+    // the one it was in
+    void Leave(HostRegion outer) {
+        if (outer != current) {
+            Switch(outer);
+        }
+    }
+    // and goes back to "outer"
+
+    void Print(int instructions);
+    // print the counts per simulated
+    // instruction, on stderr
+
+   private:
+    int fileNos[MaxHostCounters];  // the host's counters, if any
+    int numCounters;               // how many; 0 to use HostCycles
+    bool measured[NumHostRegions];
+    HostRegion current;  // the region being counted now
+
+    unsigned long long last[MaxHostCounters];  // at the last reading
+    unsigned long long counts[NumHostRegions][MaxHostCounters];
+    unsigned long long readings[NumHostRegions];
+    // readings counted against each region
+    unsigned long long entries[NumHostRegions];
+    unsigned long long cost[MaxHostCounters];  // of one reading
+
+    void ReadCounters(unsigned long long *values);
+    void Switch(HostRegion region);  // count up to now, then go on
+                                     // counting "region"
+};
+
+#endif  // HOSTPERF_H
@@ -22,14 +22,21 @@
 
 #include "interrupt.h"
 
+#include <limits.h>
+
+#include "checkpoint.h"
 #include "copyright.h"
+#include "hostperf.h"
+#include "intlog.h"
 #include "main.h"
+#include "trace.h"
 
-// String definitions for debugging messages
+// String definitions for debugging messages (the interrupt types
+// are also printed by trace.cc)
 
 static char *intLevelNames[] = {"off", "on"};
-static char *intTypeNames[] = {"timer",        "disk",         "console write",
-                               "console read", "network send", "network recv"};
+char *intTypeNames[] = {"timer",        "disk",         "console write",
+                        "console read", "network send", "network recv"};
 
 //----------------------------------------------------------------------
 // PendingInterrupt::PendingInterrupt
@@ -53,10 +60,10 @@ PendingInterrupt::PendingInterrupt(CallBackObj *callOnInt, int time,
 //	Compare to interrupts based on which should occur first.
 //----------------------------------------------------------------------
 
-static int PendingCompare(PendingInterrupt *x, PendingInterrupt *y) {
-    if (x->when < y->when) {
+static int PendingCompare(PendingInterrupt x, PendingInterrupt y) {
+    if (x.when < y.when) {
         return -1;
-    } else if (x->when > y->when) {
+    } else if (x.when > y.when) {
         return 1;
     } else {
         return 0;
@@ -72,10 +79,15 @@ static int PendingCompare(PendingInterrupt *x, PendingInterrupt *y) {
 
 Interrupt::Interrupt() {
     level = IntOff;
-    pending = new SortedList<PendingInterrupt *>(PendingCompare);
+    pending = new Heap<PendingInterrupt>(PendingCompare);
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
+    traceTicks = DEBUG_ENABLED(dbgInt);
+    for (int i = 0; i <= NetworkRecvInt; i++) {
+        devices[i] = NULL;
+    }
+    SetQuietTime();
 }
 
 //----------------------------------------------------------------------
@@ -84,10 +96,66 @@ Interrupt::Interrupt() {
 //----------------------------------------------------------------------
 
 Interrupt::~Interrupt() {
+    delete pending;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Checkpoint
+// 	Write out the interrupt state, and the interrupts that are
+//	pending, soonest first (and in the order they were scheduled, if
+//	they are due at the same time); or read them back in.
+//
+//	Each pending interrupt calls back one of the devices, which are
+//	not saved.  But there is only one device for each type of
+//	interrupt, and the new devices have registered themselves as they
+//	were set up: so each saved interrupt goes to the new device of its
+//	type, whatever that device has scheduled itself (the console, for
+//	one, stops polling once the host's input ends).
+//----------------------------------------------------------------------
+
+void Interrupt::Checkpoint(CheckpointFile *file) {
+    Heap<PendingInterrupt> *saved = new Heap<PendingInterrupt>(PendingCompare);
+    int numPending = pending->NumInHeap();
+
     while (!pending->IsEmpty()) {
-        delete pending->RemoveFront();
+        saved->Insert(pending->RemoveFront());
     }
-    delete pending;
+
+    file->Int((int *)&level);
+    file->Int((int *)&status);
+    file->Bool(&yieldOnReturn);
+    file->Int(&numPending);
+    for (int i = 0; i < numPending; i++) {
+        PendingInterrupt next;
+
+        if (file->IsWriting()) {
+            next = saved->RemoveFront();
+        }
+        file->Int((int *)&next.type);
+        file->Int(&next.when);
+        if (!file->IsWriting()) {
+            next.callOnInterrupt = devices[next.type];
+            if (next.callOnInterrupt == NULL) {
+                cerr << "No device is set up to take the pending "
+                     << intTypeNames[next.type] << " interrupt\n";
+                ASSERT(FALSE);
+            }
+        }
+        pending->Insert(next);
+    }
+    delete saved;
+    SetQuietTime();
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Register
+// 	Note that "device" is the one that causes interrupts of "type",
+//	so that a restored checkpoint can hand it those still pending.
+//	Called by each hardware device simulator as it is set up.
+//----------------------------------------------------------------------
+
+void Interrupt::Register(CallBackObj *device, IntType type) {
+    devices[type] = device;
 }
 
 //----------------------------------------------------------------------
@@ -103,6 +171,7 @@ Interrupt::~Interrupt() {
 
 void Interrupt::ChangeLevel(IntStatus old, IntStatus now) {
     level = now;
+    SetQuietTime();
     DEBUG(dbgInt, "\tinterrupts: " << intLevelNames[old] << " -> "
                                    << intLevelNames[now]);
 }
@@ -131,6 +200,36 @@ IntStatus Interrupt::SetLevel(IntStatus now) {
     return old;
 }
 
+//----------------------------------------------------------------------
+// Interrupt::SetQuietTime
+// 	Work out how long OneTick can skip everything but counting the
+//	tick.  That is the case while user code runs with interrupts
+//	enabled and no context switch waiting, until the first pending
+//	interrupt is due.  In any other case quietUntil is 0, so that
+//	OneTick does all of its work.  With -smp, every tick counts
+//	towards the turn of the CPU, so quietUntil is always 0.  A
+//	-checkpoint still to be taken is waited for as if it were an
+//	interrupt.
+//
+//	Kept up to date whenever the level, the status, yieldOnReturn or
+//	the front of the pending list changes, so that OneTick only has
+//	to compare the time against it.
+//----------------------------------------------------------------------
+
+void Interrupt::SetQuietTime() {
+    if (status != UserMode || level != IntOn || yieldOnReturn || traceTicks ||
+        kernel->numCpus > 1) {
+        quietUntil = 0;
+    } else if (pending->IsEmpty()) {
+        quietUntil = INT_MAX;
+    } else {
+        quietUntil = pending->Front().when;
+    }
+    if (kernel->checkpointFile != NULL && kernel->checkpointTick < quietUntil) {
+        quietUntil = kernel->checkpointTick;
+    }
+}
+
 //----------------------------------------------------------------------
 // Interrupt::OneTick
 // 	Advance simulated time and check if there are any pending
@@ -139,34 +238,129 @@ IntStatus Interrupt::SetLevel(IntStatus now) {
 //	Two things can cause OneTick to be called:
 //		interrupts are re-enabled
 //		a user instruction is executed
+//
+//	After almost every user instruction the next interrupt is still
+//	some way off, and all there is to do is count the tick; that
+//	is checked first, against quietUntil.  The result is the same
+//	as going the long way round.
+//
+//	With -hostperf, the host's time for it is counted in the "tick"
+//	region: the first call enters the region, and calls again to do
+//	the work.
 //----------------------------------------------------------------------
 void Interrupt::OneTick() {
     MachineStatus oldStatus = status;
     Statistics *stats = kernel->stats;
 
+    if (stats->hostPerf != NULL && stats->hostPerf->Entering(HostTick)) {
+        HostRegion outer = stats->hostPerf->Enter(HostTick);
+
+        OneTick();
+        stats->hostPerf->Leave(outer);
+        return;
+    }
+
+    if (stats->totalTicks + UserTick < quietUntil) {
+        stats->totalTicks += UserTick;
+        stats->userTicks += UserTick;
+        stats->numUserInstructions++;
+        return;
+    }
+
     // advance simulated time
+    int ticks = (status == SystemMode) ? SystemTick : UserTick;
+
     if (status == SystemMode) {
-        stats->totalTicks += SystemTick;
-        stats->systemTicks += SystemTick;
+        stats->systemTicks += ticks;
     } else {
-        stats->totalTicks += UserTick;
-        stats->userTicks += UserTick;
+        stats->userTicks += ticks;
+        stats->numUserInstructions++;
+    }
+    if (kernel->numCpus > 1) {
+        if (!CpuTick(ticks)) {
+            return;  // the rest of this CPU's turn
+        }
+    } else {
+        stats->totalTicks += ticks;
+        TRACE(dbgInt, TraceTick, stats->totalTicks);
+
+        // check any pending interrupts are now ready to fire
+        ChangeLevel(IntOn, IntOff);  // first, turn off interrupts
+                                     // (interrupt handlers run with
+                                     // interrupts disabled)
+        CheckIfDue(FALSE);           // check for pending interrupts
+        ChangeLevel(IntOff, IntOn);  // re-enable interrupts
     }
-    DEBUG(dbgInt, "== Tick " << stats->totalTicks << " ==");
-
-    // check any pending interrupts are now ready to fire
-    ChangeLevel(IntOn, IntOff);  // first, turn off interrupts
-                                 // (interrupt handlers run with
-                                 // interrupts disabled)
-    CheckIfDue(FALSE);           // check for pending interrupts
-    ChangeLevel(IntOff, IntOn);  // re-enable interrupts
     if (yieldOnReturn) {         // if the timer device handler asked
                                  // for a context switch, ok to do it now
+        Thread *thread = kernel->currentThread;
+
         yieldOnReturn = FALSE;
         status = SystemMode;  // yield is a kernel routine
-        kernel->currentThread->Yield();
+        SetQuietTime();
+        thread->preempted = (oldStatus == UserMode);  // see Thread::Resume
+        thread->Yield();
+        thread->preempted = FALSE;
         status = oldStatus;
+        SetQuietTime();
+    }
+    if (kernel->checkpointFile != NULL && oldStatus == UserMode) {
+        kernel->CheckpointIfDue();  // between two user instructions
+    }
+}
+
+//----------------------------------------------------------------------
+// Interrupt::CpuTick
+// 	With -smp, count "ticks" against the turn of the running CPU, and
+//	once it has had the quantum, pass the turn on to the next CPU
+//	(see cpu.h).  By the time the turn comes back, other CPUs may
+//	have run, and the clock moved on; if the timer interrupted in
+//	the meantime, this CPU now takes the interrupt.
+//
+// Returns:
+//	TRUE, if the turn was passed on (and has come back)
+//----------------------------------------------------------------------
+
+bool Interrupt::CpuTick(int ticks) {
+    Cpu *cpu = kernel->cpu;
+    MachineStatus oldStatus = status;
+
+    cpu->busyTicks += ticks;
+    cpu->sliceTicks += ticks;
+    if (cpu->sliceTicks < kernel->cpuQuantum) {
+        return FALSE;
+    }
+    cpu->sliceTicks -= kernel->cpuQuantum;
+
+    ChangeLevel(IntOn, IntOff);  // the other CPUs run kernel code, and
+    status = SystemMode;         // take interrupts, as if in a handler
+    kernel->NextCpu();
+    cpu = kernel->cpu;  // still running the same thread, on this CPU
+    status = oldStatus;
+    if (cpu->timerPending) {
+        cpu->timerPending = FALSE;
+        inHandler = TRUE;
+        kernel->alarm->TimeSlice();
+        inHandler = FALSE;
     }
+    ChangeLevel(IntOff, IntOn);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::EndRound
+// 	With -smp, every CPU has had its turn: advance simulated time by
+//	the quantum, and fire off any interrupts that are now due.
+//	Called by Kernel::NextCpu, with interrupts disabled.
+//----------------------------------------------------------------------
+
+void Interrupt::EndRound() {
+    Statistics *stats = kernel->stats;
+
+    ASSERT(level == IntOff);
+    stats->totalTicks += kernel->cpuQuantum;
+    TRACE(dbgInt, TraceTick, stats->totalTicks);
+    CheckIfDue(FALSE);
 }
 
 //----------------------------------------------------------------------
@@ -183,6 +377,7 @@ void Interrupt::OneTick() {
 void Interrupt::YieldOnReturn() {
     ASSERT(inHandler == TRUE);
     yieldOnReturn = TRUE;
+    SetQuietTime();
 }
 
 //----------------------------------------------------------------------
@@ -199,12 +394,14 @@ void Interrupt::YieldOnReturn() {
 void Interrupt::Idle() {
     DEBUG(dbgInt, "Machine idling; checking for interrupts.");
     status = IdleMode;
+    SetQuietTime();
     DEBUG(dbgTraCode,
           "In Interrupt::Idle, into CheckIfDue, " << kernel->stats->totalTicks);
     if (CheckIfDue(TRUE)) {  // check for any pending interrupts
         DEBUG(dbgTraCode, "In Interrupt::Idle, return true from CheckIfDue, "
                               << kernel->stats->totalTicks);
         status = SystemMode;
+        SetQuietTime();
         return;  // return in case there's now
                  // a runnable thread
     }
@@ -232,6 +429,11 @@ void Interrupt::Halt() {
     cout << "This is halt\n";
     kernel->stats->Print();
 #endif
+    kernel->stats->PrintSimulator();
+    kernel->stats->WriteJson(TRUE);
+    if (kernel->returnTo != NULL) {
+        kernel->ReturnToHost();  // a batch job: on to the next one
+    }
     delete kernel;  // Never returns.
 }
 /*
@@ -277,7 +479,8 @@ Interrupt::CloseFile(OpenFileId id)
 // 	Arrange for the CPU to be interrupted when simulated time
 //	reaches "now + when".
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: just put it into the pending heap.  Interrupts
+//	due at the same time are fired in the order they were scheduled.
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
@@ -289,13 +492,13 @@ Interrupt::CloseFile(OpenFileId id)
 //----------------------------------------------------------------------
 void Interrupt::Schedule(CallBackObj *toCall, int fromNow, IntType type) {
     int when = kernel->stats->totalTicks + fromNow;
-    PendingInterrupt *toOccur = new PendingInterrupt(toCall, when, type);
+    PendingInterrupt toOccur(toCall, when, type);
 
-    DEBUG(dbgInt, "Scheduling interrupt handler the " << intTypeNames[type]
-                                                      << " at time = " << when);
+    TRACE(dbgInt, TraceSchedule, type, when);
     ASSERT(fromNow > 0);
 
     pending->Insert(toOccur);
+    SetQuietTime();
 }
 
 //----------------------------------------------------------------------
@@ -311,12 +514,12 @@ void Interrupt::Schedule(CallBackObj *toCall, int fromNow, IntType type) {
 //		pending interrupt would occur (if any).
 //----------------------------------------------------------------------
 bool Interrupt::CheckIfDue(bool advanceClock) {
-    PendingInterrupt *next;
+    PendingInterrupt next;
     Statistics *stats = kernel->stats;
 
     ASSERT(level == IntOff);  // interrupts need to be disabled,
                               // to invoke an interrupt handler
-    if (debug->IsEnabled(dbgInt)) {
+    if (DEBUG_ENABLED(dbgInt)) {
         DumpState();
     }
     if (pending->IsEmpty()) {  // no pending interrupts
@@ -324,18 +527,17 @@ bool Interrupt::CheckIfDue(bool advanceClock) {
     }
     next = pending->Front();
 
-    if (next->when > stats->totalTicks) {
+    if (next.when > stats->totalTicks) {
         if (!advanceClock) {  // not time yet
             return FALSE;
         } else {  // advance the clock to next interrupt
-            stats->idleTicks += (next->when - stats->totalTicks);
-            stats->totalTicks = next->when;
+            stats->idleTicks += (next.when - stats->totalTicks);
+            stats->totalTicks = next.when;
             // UDelay(1000L); // rcgood - to stop nachos from spinning.
         }
     }
 
-    DEBUG(dbgInt, "Invoking interrupt handler for the ");
-    DEBUG(dbgInt, intTypeNames[next->type] << " at time " << next->when);
+    TRACE(dbgInt, TraceInterrupt, next.type, next.when);
 
     if (kernel->machine != NULL) {
         kernel->machine->DelayedLoad(0, 0);
@@ -343,19 +545,22 @@ bool Interrupt::CheckIfDue(bool advanceClock) {
 
     inHandler = TRUE;
     do {
-        next = pending->RemoveFront();  // pull interrupt off list
+        next = pending->RemoveFront();  // pull interrupt off the heap
+        if (kernel->interruptLog != NULL) {
+            kernel->interruptLog->Delivered(next.type, stats->totalTicks);
+        }
         DEBUG(dbgTraCode,
               "In Interrupt::CheckIfDue, into callOnInterrupt->CallBack, "
                   << stats->totalTicks);
-        next->callOnInterrupt->CallBack();  // call the interrupt handler
+        next.callOnInterrupt->CallBack();  // call the interrupt handler
         DEBUG(
             dbgTraCode,
             "In Interrupt::CheckIfDue, return from callOnInterrupt->CallBack, "
                 << stats->totalTicks);
-        delete next;
     } while (!pending->IsEmpty() &&
-             (pending->Front()->when <= stats->totalTicks));
+             (pending->Front().when <= stats->totalTicks));
     inHandler = FALSE;
+    SetQuietTime();
     return TRUE;
 }
 
@@ -365,9 +570,9 @@ bool Interrupt::CheckIfDue(bool advanceClock) {
 //	When, where, why, etc.
 //----------------------------------------------------------------------
 
-static void PrintPending(PendingInterrupt *pending) {
-    cout << "Interrupt handler " << intTypeNames[pending->type];
-    cout << ", scheduled at " << pending->when;
+static void PrintPending(PendingInterrupt pending) {
+    cout << "Interrupt handler " << intTypeNames[pending.type];
+    cout << ", scheduled at " << pending.when;
 }
 
 //----------------------------------------------------------------------
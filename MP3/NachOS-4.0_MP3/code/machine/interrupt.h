@@ -35,7 +35,7 @@
 
 #include "callback.h"
 #include "copyright.h"
-#include "list.h"
+#include "heap.h"
 
 // Interrupts can be disabled (IntOff) or enabled (IntOn)
 enum IntStatus { IntOff,
@@ -58,6 +58,10 @@ enum IntType { TimerInt,
                NetworkSendInt,
                NetworkRecvInt };
 
+extern char *intTypeNames[];  // printable names of the IntTypes
+
+class CheckpointFile;
+
 // The following class defines an interrupt that is scheduled
 // to occur in the future.  The internal data structures are
 // left public to make it simpler to manipulate.
@@ -66,6 +70,7 @@ typedef int OpenFileId;
 
 class PendingInterrupt {
    public:
+    PendingInterrupt() {}  // an empty slot in the pending heap
     PendingInterrupt(CallBackObj *callOnInt, int time, IntType kind);
     // initialize an interrupt that will
     // occur in the future
@@ -115,7 +120,10 @@ class Interrupt {
                            // from an interrupt handler
 
     MachineStatus getStatus() { return status; }
-    void setStatus(MachineStatus st) { status = st; }
+    void setStatus(MachineStatus st) {
+        status = st;
+        SetQuietTime();
+    }
     // idle, kernel, user
 
     void DumpState();  // Print interrupt state
@@ -130,13 +138,25 @@ class Interrupt {
     // at time "when".  This is called
     // by the hardware device simulators.
 
+    void Register(CallBackObj *device, IntType type);
+    // "device" causes the interrupts of
+    // "type"; called by each hardware
+    // device simulator as it is set up
+
     void OneTick();  // Advance simulated time
 
+    void EndRound();  // -smp: every CPU has had its turn, advance
+                      // simulated time
+
+    void Checkpoint(CheckpointFile *file);
+    // write out, or read in, the pending
+    // interrupts (see threads/checkpoint.h)
+
    private:
     IntStatus level;  // are interrupts enabled or disabled?
-    SortedList<PendingInterrupt *> *pending;
-    // the list of interrupts scheduled
-    // to occur in the future
+    Heap<PendingInterrupt> *pending;
+    // the interrupts scheduled to occur
+    // in the future, soonest first
     // int writeFileNo;            //UNIX file emulating the display
     bool inHandler;  // TRUE if we are running an interrupt handler
     // bool putBusy;               // Is a PrintInt operation in progress
@@ -144,6 +164,14 @@ class Interrupt {
     bool yieldOnReturn;    // TRUE if we are to context switch
                            // on return from the interrupt handler
     MachineStatus status;  // idle, kernel mode, user mode
+    int quietUntil;        // until totalTicks reaches this, a user
+                           // tick only has to be counted: no
+                           // interrupt is due and nothing else is
+                           // waiting for OneTick
+    bool traceTicks;       // print every tick (dbgInt)
+    CallBackObj *devices[NetworkRecvInt + 1];
+    // the device behind each type of
+    // interrupt, see Register
 
     // these functions are internal to the interrupt simulation code
 
@@ -153,6 +181,13 @@ class Interrupt {
 
     void ChangeLevel(IntStatus old,   // SetLevel, without advancing the
                      IntStatus now);  // simulated time
+
+    void SetQuietTime();  // recompute quietUntil, after anything
+                          // it depends on has changed
+
+    bool CpuTick(int ticks);  // -smp: count the ticks against the
+                              // running CPU, passing on its turn
+                              // when it has had the quantum
 };
 
 #endif  // INTERRRUPT_H
@@ -0,0 +1,370 @@
+// intlog.cc
+//	Routines to record the interrupts of a simulation, and to replay
+//	a run from the log.  See intlog.h for what is logged, and how.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "intlog.h"
+
+#include "copyright.h"
+#include "main.h"
+#include "sysdep.h"
+
+const int LogMagic = 0x4e494c47;     // "NILG": starts every log
+const int LogBufferSize = 64 * 1024;  // recorded bytes kept before
+                                      // they are written out
+const unsigned char AgainMark = 0x80;   // or'ed with the type, and the
+                                        // index (times 8) of a recent
+                                        // delivery of that type: the same
+                                        // one again
+const unsigned char RepeatMark = 0xff;  // a count of repeats follows:
+                                        // the delivery before, again
+
+//----------------------------------------------------------------------
+// EncodeNumber
+// 	Write "value" into "into", seven bits to a byte, with the top bit
+//	set in all but the last.  Return the number of bytes.
+//----------------------------------------------------------------------
+
+static int EncodeNumber(char *into, unsigned int value) {
+    int count = 0;
+
+    while (value >= 0x80) {
+        into[count++] = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    into[count++] = value;
+    return count;
+}
+
+//----------------------------------------------------------------------
+// InterruptLog::InterruptLog
+// 	Set up to record a log, or to replay one.  A log being replayed is
+//	read in whole, right away.
+//
+//	The log starts with the -rs setting, and the state of the pseudo-
+//	random number generator, which decide when the timer interrupts.
+//	When recording, they are saved; when replaying, "randomSlice" and
+//	the generator are set from the log.  So this must be done before
+//	the timer is started.
+//
+//	"fileName" -- the log
+//	"recording" -- TRUE to create it, FALSE to replay it
+//	"randomSlice" -- the kernel's -rs setting
+//----------------------------------------------------------------------
+
+InterruptLog::InterruptLog(char *fileName, bool recording, bool *randomSlice) {
+    int magic = LogMagic;
+    unsigned seed;
+    int drawn;
+
+    name = fileName;
+    this->recording = recording;
+    for (int i = 0; i <= NetworkRecvInt; i++) {
+        lastTick[i] = 0;
+        for (int j = 0; j < NumRecent; j++) {
+            recentSize[i][j] = 0;
+            recentStart[i][j] = -1;
+        }
+    }
+    if (recording) {
+        fileNo = OpenForWrite(fileName);
+        buffer = new char[LogBufferSize];
+        size = 0;
+        currentSize = previousSize = 0;
+        repeats = 0;
+
+        RandomPosition(&seed, &drawn);
+        Put((char *)&magic, sizeof(magic));
+        Put((char *)randomSlice, sizeof(bool));
+        Put((char *)&seed, sizeof(seed));
+        Put((char *)&drawn, sizeof(drawn));
+    } else {
+        fileNo = OpenForReadWrite(fileName, FALSE);
+        if (fileNo < 0) {
+            cerr << "Cannot read the interrupt log " << fileName << "\n";
+            ASSERT(FALSE);
+        }
+        Lseek(fileNo, 0, 2);
+        size = Tell(fileNo);
+        Lseek(fileNo, 0, 0);
+        buffer = new char[size];
+        Read(fileNo, buffer, size);
+        cursor = 0;
+        lastMark = 0;
+        repeatsLeft = 0;
+        elsewhere = FALSE;
+
+        Bytes(&magic, sizeof(magic));
+        if (magic != LogMagic) {
+            cerr << fileName << " is not an interrupt log\n";
+            ASSERT(FALSE);
+        }
+        Bytes(randomSlice, sizeof(bool));
+        Bytes(&seed, sizeof(seed));
+        Bytes(&drawn, sizeof(drawn));
+        RandomRestore(seed, drawn);
+    }
+}
+
+//----------------------------------------------------------------------
+// InterruptLog::~InterruptLog
+// 	Finish the log: write out what is left of it, or check that the
+//	replay used all of it.  Nachos is halting, so a replay that did
+//	not is only reported.
+//----------------------------------------------------------------------
+
+InterruptLog::~InterruptLog() {
+    if (recording) {
+        EndDelivery();
+        EndRepeats();
+        WriteFile(fileNo, buffer, size);
+    } else if (repeatsLeft > 0 || (elsewhere ? next : cursor) < size) {
+        cerr << "The replay halted before the end of " << name << "\n";
+    }
+    Close(fileNo);
+    delete[] buffer;
+}
+
+//----------------------------------------------------------------------
+// InterruptLog::Delivered
+// 	An interrupt of type "type" is being delivered, at tick "when".
+//	When recording, start logging it.  When replaying, read the next
+//	delivery from the log, and make sure it is the same one.
+//
+//	The ticks logged are those since the last interrupt of the same
+//	type, so that a device that interrupts at a steady rate logs the
+//	same delivery each time.
+//----------------------------------------------------------------------
+
+void InterruptLog::Delivered(IntType type, int when) {
+    char kind = type;
+    unsigned char mark;
+
+    if (recording) {
+        char ticks[5];
+
+        EndDelivery();
+        Bytes(&kind, 1);
+        Bytes(ticks, EncodeNumber(ticks, when - lastTick[type]));
+        lastTick[type] = when;
+        return;
+    }
+
+    if (!elsewhere) {
+        next = cursor;  // the last delivery has been read, to its end
+    }
+    if (repeatsLeft > 0) {
+        repeatsLeft--;
+        Recall(type, when);
+    } else if (next >= size) {
+        Diverged(type, when);
+    } else if ((mark = buffer[next]) == RepeatMark) {
+        cursor = next + 1;
+        repeatsLeft = GetNumber() - 1;
+        next = cursor;
+        Recall(type, when);
+        elsewhere = TRUE;
+    } else if (mark & AgainMark) {
+        lastMark = mark;
+        next++;
+        Recall(type, when);
+        elsewhere = TRUE;
+    } else {
+        if (mark > NetworkRecvInt) {
+            Diverged(type, when);
+        }
+        MakeRecent(mark, NumRecent - 1);
+        cursor = recentStart[mark][0] = next;
+        lastMark = mark;
+        elsewhere = FALSE;
+    }
+    Bytes(&kind, 1);
+    if (kind != type || when - lastTick[type] != (int)GetNumber()) {
+        Diverged(type, when);
+    }
+    lastTick[type] = when;
+}
+
+//----------------------------------------------------------------------
+// InterruptLog::Bytes
+// 	Log "count" bytes from "data", as part of the delivery being
+//	logged; or, when replaying, read them into "data".
+//----------------------------------------------------------------------
+
+void InterruptLog::Bytes(void *data, int count) {
+    if (recording) {
+        ASSERT(currentSize + count <= MaxLogRecord);
+        bcopy(data, current + currentSize, count);
+        currentSize += count;
+    } else {
+        if (cursor + count > size) {
+            cerr << "The interrupt log " << name << " is cut short\n";
+            ASSERT(FALSE);
+        }
+        bcopy(buffer + cursor, data, count);
+        cursor += count;
+    }
+}
+
+//----------------------------------------------------------------------
+// InterruptLog::Put
+// 	When recording, add "count" bytes to the log, writing out what it
+//	has so far when the buffer is full.
+//----------------------------------------------------------------------
+
+void InterruptLog::Put(char *data, int count) {
+    if (size + count > LogBufferSize) {
+        WriteFile(fileNo, buffer, size);
+        size = 0;
+    }
+    bcopy(data, buffer + size, count);
+    size += count;
+}
+
+//----------------------------------------------------------------------
+// InterruptLog::GetNumber
+// 	When replaying, read a number written by EncodeNumber, at the
+//	cursor.
+//----------------------------------------------------------------------
+
+unsigned int InterruptLog::GetNumber() {
+    unsigned int value = 0;
+    unsigned char byte;
+
+    for (int shift = 0;; shift += 7) {
+        Bytes(&byte, 1);
+        value |= (unsigned int)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// InterruptLog::MakeRecent
+// 	Move entry "index" of the recent deliveries of type "type" to the
+//	front, and the ones before it back one place.  The recorder keeps
+//	the deliveries themselves; the replayer, where they start in the
+//	log.  Both see the same deliveries, so they agree on the order.
+//----------------------------------------------------------------------
+
+void InterruptLog::MakeRecent(int type, int index) {
+    if (recording) {
+        char record[MaxLogRecord];
+        int size = recentSize[type][index];
+
+        bcopy(recent[type][index], record, size);
+        for (int i = index; i > 0; i--) {
+            bcopy(recent[type][i - 1], recent[type][i], recentSize[type][i - 1]);
+            recentSize[type][i] = recentSize[type][i - 1];
+        }
+        bcopy(record, recent[type][0], size);
+        recentSize[type][0] = size;
+    } else {
+        int start = recentStart[type][index];
+
+        for (int i = index; i > 0; i--) {
+            recentStart[type][i] = recentStart[type][i - 1];
+        }
+        recentStart[type][0] = start;
+    }
+}
+
+//----------------------------------------------------------------------
+// InterruptLog::Recall
+// 	When replaying, go back to the recent delivery that the last one-
+//	byte mark names, and make it the most recent.  A repeat count
+//	repeats the mark, not the delivery: "the second most recent one,
+//	again" names a different delivery each time, when two alternate.
+//----------------------------------------------------------------------
+
+void InterruptLog::Recall(IntType type, int when) {
+    int kind = lastMark & 7;
+    int index = (lastMark >> 3) & (NumRecent - 1);
+
+    if (!(lastMark & AgainMark)) {
+        index = 0;  // a delivery logged in full is never repeated;
+                    // it is the most recent one
+    }
+    if (kind > NetworkRecvInt || recentStart[kind][index] < 0) {
+        Diverged(type, when);
+    }
+    cursor = recentStart[kind][index];
+    MakeRecent(kind, index);
+}
+
+//----------------------------------------------------------------------
+// InterruptLog::EndDelivery, InterruptLog::EndRepeats
+// 	When recording, the delivery being logged is complete.  If it is
+//	the same as one of the last few different ones of its type, it is
+//	logged as one byte saying which.  Then, if that is the same as
+//	what was logged for the delivery before, it is only counted;
+//	otherwise the count of repeats of that one goes in, then this
+//	delivery.
+//----------------------------------------------------------------------
+
+void InterruptLog::EndDelivery() {
+    char *logged = current;
+    int loggedSize = currentSize;
+    int type, found;
+    char again;
+
+    if (currentSize == 0) {
+        return;
+    }
+    type = current[0];
+    for (found = 0; found < NumRecent; found++) {
+        if (currentSize == recentSize[type][found] &&
+            memcmp(current, recent[type][found], currentSize) == 0) {
+            break;
+        }
+    }
+    if (found < NumRecent) {
+        again = AgainMark | (found << 3) | type;
+        logged = &again;
+        loggedSize = 1;
+        MakeRecent(type, found);
+    } else {
+        MakeRecent(type, NumRecent - 1);
+        bcopy(current, recent[type][0], currentSize);
+        recentSize[type][0] = currentSize;
+    }
+    currentSize = 0;
+
+    if (loggedSize == previousSize &&
+        memcmp(logged, previous, loggedSize) == 0) {
+        repeats++;
+    } else {
+        EndRepeats();
+        Put(logged, loggedSize);
+        bcopy(logged, previous, loggedSize);
+        previousSize = loggedSize;
+    }
+}
+
+void InterruptLog::EndRepeats() {
+    char count[6];
+
+    if (repeats == 0) {
+        return;
+    }
+    count[0] = RepeatMark;
+    Put(count, 1 + EncodeNumber(count + 1, repeats));
+    repeats = 0;
+}
+
+//----------------------------------------------------------------------
+// InterruptLog::Diverged
+// 	The replay has delivered an interrupt that the log does not have
+//	next: it is no longer the same run.  Stop.
+//----------------------------------------------------------------------
+
+void InterruptLog::Diverged(IntType type, int when) {
+    cerr << "The replay of " << name << " went its own way: a "
+         << intTypeNames[type] << " interrupt at tick " << when << " is not"
+         << (next >= size ? " in the log\n" : " the next one in the log\n");
+    ASSERT(FALSE);
+}
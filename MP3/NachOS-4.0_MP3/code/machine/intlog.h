@@ -0,0 +1,120 @@
+// intlog.h
+//	Data structures to record the interrupts of a simulation to a log,
+//	and to replay another run from it (nachos -record, -replay).
+//
+//	What makes two runs of the same programs differ is outside the
+//	simulation: when console input arrives on the host, and when
+//	network packets do.  Recording logs every interrupt as it is
+//	delivered -- its type and tick -- along with what each polled
+//	device found on the host: whether a character or a packet had
+//	arrived, and what it was.  The log also keeps the -rs setting and
+//	where the pseudo-random number generator started, which decide
+//	the timer interrupts.
+//
+//	Replaying takes all of that from the log instead.  The console
+//	and the network are never polled: each poll takes its result
+//	from the log, so a replay does none of the host I/O that a live
+//	run does after every tick or two while it waits for input.  Each
+//	interrupt delivered is checked against the log, and the replay
+//	stops at the first one that differs.  Otherwise it delivers the
+//	same interrupts at the same ticks, and ends with the same
+//	statistics, as the run that was recorded.
+//
+//	Both runs must be given the same programs and any other flags that
+//	change the simulation, such as -smp or -cost; -rs is taken from the
+//	log.  Neither can be used with -checkpoint or -restore.
+//
+//	The log is compact.  Each delivery is a type byte, then the ticks
+//	since the last one of that type, as a variable-length number, then
+//	what the device found, if it polls the host.  A delivery that is
+//	the same, byte for byte, as one of the last few different ones of
+//	its type is one byte, and one that is logged the same as the one
+//	before it is only counted: so a timer interrupt every 100 ticks,
+//	and console polls that find nothing on every tick in between, take
+//	a handful of bytes per 100 ticks.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef INTLOG_H
+#define INTLOG_H
+
+#include "copyright.h"
+#include "interrupt.h"
+#include "utility.h"
+
+const int MaxLogRecord = 128;  // bytes in one delivery, with what the
+                               // device found (at most a packet)
+const int NumRecent = 4;       // different deliveries of each type that
+                               // can be logged again as one byte
+
+// The following class is an interrupt log, being recorded or replayed.
+// Interrupt::CheckIfDue calls Delivered for each interrupt, before its
+// handler; a device that polls the host then calls Bytes for what it
+// found -- which, when replaying, gives back what was found then.
+
+class InterruptLog {
+   public:
+    InterruptLog(char *fileName, bool recording, bool *randomSlice);
+    // Create "fileName" to record to, or
+    // open it to replay; the -rs setting
+    // is saved to, or read back from, it
+    ~InterruptLog();  // write out the rest of the log, and close it
+
+    bool IsRecording() { return recording; }
+
+    void Delivered(IntType type, int when);
+    // an interrupt is being delivered:
+    // log it, or check it against the log
+    void Bytes(void *data, int count);
+    // log what the device found, or read it
+
+   private:
+    int fileNo;      // UNIX file number of the log
+    char *name;      // its name, for error messages
+    bool recording;  // TRUE if it is being written
+    char *buffer;    // recording: not written out yet;
+                     // replaying: the whole log
+    int size;        // bytes in the buffer
+    int lastTick[NetworkRecvInt + 1];  // when the last interrupt of
+                                       // each type was delivered
+
+    // recording
+    char current[MaxLogRecord];  // the delivery being logged
+    int currentSize;
+    char recent[NetworkRecvInt + 1][NumRecent][MaxLogRecord];
+    int recentSize[NetworkRecvInt + 1][NumRecent];
+    // the last few different deliveries
+    // of each type, most recent first
+    char previous[MaxLogRecord];  // what was put in the buffer
+    int previousSize;             // for the delivery before
+    int repeats;                  // times it has been repeated since
+
+    void Put(char *data, int count);  // add to the buffer
+    void EndDelivery();  // put the current delivery in the buffer
+    void EndRepeats();   // put in the count of repeats, if any
+
+    // replaying
+    int next;    // where the next delivery starts, in the buffer
+    int cursor;  // the next byte of this delivery to read
+    unsigned char lastMark;  // the type of the delivery before, or
+                             // the one-byte mark it was logged as
+    int recentStart[NetworkRecvInt + 1][NumRecent];
+    // where the recent deliveries of
+    // each type start, or -1
+    int repeatsLeft;  // times it is still to be repeated
+    bool elsewhere;   // TRUE if this delivery is read from
+                      // earlier in the buffer
+
+    unsigned int GetNumber();  // read at the cursor
+
+    void MakeRecent(int type, int index);
+    // move a recent delivery to the front
+    void Recall(IntType type, int when);
+    // read the one the last mark names
+    void Diverged(IntType type, int when);
+    // the replay does not match the log
+};
+
+#endif  // INTLOG_H
@@ -9,8 +9,12 @@
 
 #include "machine.h"
 
+#include "cache.h"
+#include "checkpoint.h"
 #include "copyright.h"
+#include "costmodel.h"
 #include "main.h"
+#include "mipsjit.h"
 
 // Textual names of the exceptions that can be generated by user program
 // execution, for debugging.
@@ -59,17 +63,28 @@ Machine::Machine(bool debug) {
     mainMemory = new char[MemorySize];
     for (i = 0; i < MemorySize; i++)
         mainMemory[i] = 0;
-#ifdef USE_TLB
-    tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++)
-        tlb[i].valid = FALSE;
-    pageTable = NULL;
-#else  // use linear page table
     tlb = NULL;
+    tlbSize = 0;
+    currentAsid = 0;
     pageTable = NULL;
-#endif
 
     singleStep = debug;
+    engine = InterpEngine;
+    profile = NULL;
+    icache = dcache = NULL;
+    costModel = NULL;
+    hostPerf = NULL;
+    InitDecodeCache();
+    blockCache = new Block *[MemorySize / 4];
+    for (i = 0; i < MemorySize / 4; i++)
+        blockCache[i] = NULL;
+    jit = NULL;
+    lastCompiled = NULL;
+    softTLBEnabled = !::debug->IsEnabled(dbgAddr);
+    FlushSoftTLB();
+#ifdef USE_TLB
+    EnableTLB(TLBSize, TLBSize, RandomReplace, FALSE);
+#endif
     CheckEndian();
 }
 
@@ -80,8 +95,12 @@ Machine::Machine(bool debug) {
 
 Machine::~Machine() {
     delete[] mainMemory;
-    if (tlb != NULL)
-        delete[] tlb;
+    FreeDecodeCache();
+    FreeBlockCache();
+    if (jit != NULL) delete jit;
+    FreeTLB();
+    FreeCaches();
+    if (costModel != NULL) delete costModel;
 }
 
 //----------------------------------------------------------------------
@@ -95,12 +114,23 @@ Machine::~Machine() {
 //----------------------------------------------------------------------
 
 void Machine::RaiseException(ExceptionType which, int badVAddr) {
+    Statistics *stats = kernel->stats;
+    int start = stats->totalTicks;
+    int code;
+
     DEBUG(dbgMach, "Exception: " << exceptionNames[which]);
     registers[BadVAddrReg] = badVAddr;
     DelayedLoad(0, 0);  // finish anything in progress
+    code = registers[2];  // the system call, if it is one
+    if (which == SyscallException) {
+        stats->SyscallEntered(code);
+    }
     kernel->interrupt->setStatus(SystemMode);
     ExceptionHandler(which);  // interrupts are enabled at this point
     kernel->interrupt->setStatus(UserMode);
+    if (which == SyscallException) {
+        stats->SyscallReturned(code, stats->totalTicks - start);
+    }
 }
 
 //----------------------------------------------------------------------
@@ -196,6 +226,41 @@ void Machine::DumpState() {
     cout << "\tLoadV:\t" << registers[LoadValueReg] << "\n";
 }
 
+//----------------------------------------------------------------------
+// Machine::DumpExitState
+// 	Print the CPU state of a user program, and a checksum of the
+//	memory its page table maps, so that runs under different
+//	simulation engines can be compared (see test/sim_check.sh).
+//----------------------------------------------------------------------
+
+void Machine::DumpExitState() {
+    unsigned int sum = 0;
+    char *page;
+
+    DumpState();
+    for (unsigned int vpn = 0; pageTable != NULL && vpn < pageTableSize;
+         vpn++) {
+        if (!pageTable[vpn].valid) continue;
+        page = &mainMemory[pageTable[vpn].physicalPage * PageSize];
+        for (int i = 0; i < PageSize; i++)
+            sum = sum * 31 + (unsigned char)page[i];
+    }
+    cout << "Memory checksum:\t" << sum << "\n";
+}
+
+//----------------------------------------------------------------------
+// Machine::Checkpoint
+// 	Write the user CPU registers and main memory out to a checkpoint,
+//	or read them back in.  What the simulator caches about them (the
+//	decode cache, translated blocks) is checked against memory, or
+//	starts out empty, so it need not be saved.
+//----------------------------------------------------------------------
+
+void Machine::Checkpoint(CheckpointFile *file) {
+    file->Bytes(registers, sizeof(registers));
+    file->Bytes(mainMemory, MemorySize);
+}
+
 //----------------------------------------------------------------------
 // Machine::ReadRegister/WriteRegister
 //   	Fetch or write the contents of a user program register.
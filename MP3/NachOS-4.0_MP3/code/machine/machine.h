@@ -38,7 +38,10 @@ const int PageSize = 128;  // set the page size equal to
 const int NumPhysPages = 128;
 
 const int MemorySize = (NumPhysPages * PageSize);
-const int TLBSize = 4;  // if there is a TLB, make it small
+const int TLBSize = 4;       // if there is a TLB, make it small (this
+                             // is only the default; see "-tlb")
+const int SoftTLBSize = 64;  // translations the simulator keeps on
+                             // the side, to skip Translate (a power of 2)
 
 enum ExceptionType {
     NoException,            // Everything ok!
@@ -57,6 +60,60 @@ enum ExceptionType {
     NumExceptionTypes
 };
 
+// The ways Machine::Run can execute user instructions.  All of them give
+// the same results and the same simulated timing; they only differ in
+// how fast the host gets there.
+
+enum SimEngine {
+    InterpEngine,  // decode and execute one instruction at a time
+    BlockEngine,   // translate basic blocks to threaded code (mipsblock.cc)
+    JitEngine      // and compile the hot ones to host code (mipsjit.cc)
+};
+
+// How the TLB picks the entry to replace, when the kernel writes a new
+// translation into a set that is full (Machine::WriteTLB).
+
+enum TLBPolicy {
+    RandomReplace,  // any entry in the set (like the MIPS "tlbwr")
+    FIFOReplace,    // the entry that was written longest ago
+    LRUReplace,     // the entry that was used longest ago
+    ClockReplace    // the next entry, from a per-set hand, that has
+                    // not been used since the hand last passed it
+};
+
+// The simulator's own cache of recent translations, from a virtual page
+// number to where the page is in mainMemory.  It is not part of the
+// simulated hardware: the kernel never sees it, except that it must call
+// Machine::FlushSoftTLB whenever it changes the page table or the TLB.
+
+class SoftTLBEntry {
+   public:
+    int virtualPage;  // the virtual page, or -1 if the entry is unused
+    char *page;       // where that page is in mainMemory
+    bool writable;    // stores can skip Translate too: the page is
+                      // writable and already marked dirty
+};
+
+// The TLB of a simulated CPU that is not running, when there are
+// several (nachos -smp).  The Machine holds the TLB of the CPU it is
+// simulating at the moment; Machine::SwitchTLB trades it for another.
+// A bank owns the arrays it holds, and frees them when it goes away.
+
+class TLBBank {
+   public:
+    TLBBank();   // an empty bank: no TLB
+    ~TLBBank();  // de-allocate the TLB it holds, if any
+
+    TranslationEntry *tlb;  // as the Machine fields of the same names
+    int *tlbAsid;
+    unsigned *tlbStamp;
+    bool *tlbReferenced;
+    int *tlbHand;
+    unsigned tlbTime;
+    unsigned tlbSeed;
+    int currentAsid;
+};
+
 // User program CPU state.  The full set of MIPS registers, plus a few
 // more because we need to be able to start/stop a user program between
 // any two instructions (thus we need to keep track of things like load
@@ -91,6 +148,13 @@ enum ExceptionType {
 
 class Instruction;
 class Interrupt;
+class Block;
+class Jit;
+class Profile;
+class Cache;
+class CostModel;
+class HostPerf;
+class CheckpointFile;
 
 class Machine {
    public:
@@ -103,6 +167,13 @@ class Machine {
 
     int ReadRegister(int num);  // read the contents of a CPU register
 
+    void DumpExitState();  // print the registers and a checksum of
+                           // the memory of the running program
+
+    void Checkpoint(CheckpointFile *file);
+    // write out, or read in, the registers
+    // and main memory
+
     void WriteRegister(int num, int value);
     // store a value into a CPU register
 
@@ -138,22 +209,125 @@ class Machine {
     TranslationEntry *tlb;  // this pointer should be considered
                             // "read-only" to Nachos kernel code
 
+    // The TLB is split into tlbSize / tlbWays sets of tlbWays entries;
+    // the entries for virtual page "vpn" are in set vpn % number of sets,
+    // at tlb[set * tlbWays] onwards.  Every entry is tagged with the
+    // address space (ASID) that was current when it was written.  If
+    // "tlbTagged" is TRUE, only entries of the current address space
+    // match, so the kernel need not flush the TLB on a context switch.
+    int tlbSize;          // entries in the TLB, 0 if there is none
+    int tlbWays;          // entries in each set
+    TLBPolicy tlbPolicy;  // which entry WriteTLB replaces
+    bool tlbTagged;       // do TLB lookups check the ASID?
+    int currentAsid;      // the address space now running
+
+    void EnableTLB(int size, int ways, TLBPolicy policy, bool tagged);
+    // Translate through a TLB of "size"
+    // entries from now on, rather than
+    // through "pageTable"
+
+    int TLBVictim(int virtualPage);
+    // Pick the TLB entry, in the set for
+    // "virtualPage", that a new translation
+    // should replace: an invalid one if there
+    // is one, otherwise as tlbPolicy says
+
+    void WriteTLB(int i, TranslationEntry *entry);
+    // Copy "entry" into TLB entry "i", for
+    // the current address space
+
+    void FlushTLB(int asid);
+    // Invalidate the TLB entries of address space
+    // "asid", or all of them if "asid" is -1
+
+    void SwitchTLB(TLBBank *save, TLBBank *load);
+    // Move the TLB into "save", and take
+    // the one in "load" instead
+
+    int TLBOwner(int i) { return tlbAsid[i]; }
+    // the ASID entry "i" was written for
+
     TranslationEntry *pageTable;
     unsigned int pageTableSize;
 
+    SimEngine engine;  // how Run executes user instructions
+
+    Profile *profile;  // of the running program, or NULL; when set,
+                       // Run always uses the interpreter, which
+                       // reports each instruction to it
+
+    Cache *icache;  // the instruction and data caches (see cache.h),
+    Cache *dcache;  // or NULL if they are not simulated; if either is
+                    // set, Run always uses the interpreter
+
+    void EnableCaches(Cache *instCache, Cache *dataCache);
+    // Charge instruction fetches to "instCache"
+    // and loads and stores to "dataCache" from
+    // now on; either may be NULL
+
+    CostModel *costModel;  // the cycles each user instruction takes (see
+                           // costmodel.h), or NULL for one UserTick;
+                           // when set, Run always uses the interpreter
+
+    HostPerf *hostPerf;  // the host's counters (-hostperf), which the
+                         // statistics own, or NULL
+
     bool ReadMem(int addr, int size, int *value);
     bool WriteMem(int addr, int size, int value);
     // Read or write 1, 2, or 4 bytes of virtual
     // memory (at addr).  Return FALSE if a
     // correct translation couldn't be found.
+
+    void FlushSoftTLB();
+    // Forget all cached translations; must be
+    // called after any change to the page
+    // table or the TLB, including the use and
+    // dirty bits, or to "pageTable" itself
+
    private:
     // Routines internal to the machine simulation -- DO NOT call these directly
     void DelayedLoad(int nextReg, int nextVal);
     // Do a pending delayed load (modifying a reg)
 
-    void OneInstruction(Instruction *instr);
+    void OneInstruction();
     // Run one instruction of a user program.
 
+    bool ExecuteInstruction(Instruction *instr);
+    // Execute a decoded instruction at the PC.
+    // Return FALSE if it raised an exception.
+
+    void RunBlock();
+    // Run the basic block at the PC, one
+    // simulated tick per instruction.
+
+    void ExecuteBlock(Block *block);
+    // Run the threaded code of "block".
+
+    Block *TranslateBlock(Block *block, int virtAddr, int physAddr);
+    // (Re)translate the basic block at virtAddr.
+
+    void FreeBlockCache();  // de-allocate all translated blocks
+
+    Instruction *FetchInstruction();
+    // Translate the PC and return the decoded
+    // instruction there, decoding it only when
+    // the decode cache has no valid entry.
+
+    void InitDecodeCache();  // allocate and fill the decode cache
+    void FreeDecodeCache();  // de-allocate the decode cache
+
+    char *SoftTranslate(int virtAddr, int size, bool writing) {
+        SoftTLBEntry *entry =
+            &softTLB[((unsigned)virtAddr / PageSize) % SoftTLBSize];
+        if (entry->virtualPage != (int)((unsigned)virtAddr / PageSize) ||
+            (virtAddr & (size - 1)) != 0 || (writing && !entry->writable))
+            return NULL;
+        return entry->page + (unsigned)virtAddr % PageSize;
+    }
+    // Where an aligned access to virtAddr
+    // goes in mainMemory, if the soft TLB
+    // knows; NULL if Translate is needed.
+
     ExceptionType Translate(int virtAddr, int *physAddr, int size,
                             bool writing);
     // Translate an address, and check for
@@ -178,7 +352,36 @@ class Machine {
     int runUntilTime;  // drop back into the debugger when simulated
                        // time reaches this value
 
+    Instruction *decodeCache;  // one decoded instruction per word of
+                               // mainMemory, indexed by physical address
+
+    Block **blockCache;  // the block starting at each word of
+                         // mainMemory, NULL if not translated yet
+
+    Jit *jit;             // compiles blocks for JitEngine, NULL until used
+    Block *lastCompiled;  // whose host code RunBlock last returned from
+
+    int *tlbAsid;         // ASID of each TLB entry
+    unsigned *tlbStamp;   // when each TLB entry was written (FIFO),
+                          // or last used (LRU)
+    bool *tlbReferenced;  // used since the clock hand passed it?
+    int *tlbHand;         // clock hand of each set
+    unsigned tlbTime;     // the clock for tlbStamp
+    unsigned tlbSeed;     // state of RandomReplace's own generator
+
+    void FreeTLB();  // de-allocate the TLB
+
+    void CacheAccess(Cache *cache, int physAddr, bool writing);
+    // Simulate an access through "cache",
+    // and charge the time it takes
+    void FreeCaches();  // de-allocate the caches
+
+    SoftTLBEntry softTLB[SoftTLBSize];  // direct mapped, by virtual page
+    bool softTLBEnabled;  // FALSE while tracing addresses (dbgAddr),
+                          // so that every access is traced
+
     friend class Interrupt;  // calls DelayedLoad()
+    friend class Jit;        // calls ExecuteInstruction()
 };
 
 extern void ExceptionHandler(ExceptionType which);
@@ -196,6 +399,20 @@ extern void ExceptionHandler(ExceptionType which);
 //	   user registers
 //	simulated machine byte ordering:
 //	   contents of main memory
+//
+// The host is taken to be big endian if HOST_IS_BIG_ENDIAN is defined
+// (see Makefile.dep); but if the compiler says which it is, that wins,
+// so a stale setting cannot silently scramble memory.
+
+#ifdef __BYTE_ORDER__
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#ifndef HOST_IS_BIG_ENDIAN
+#define HOST_IS_BIG_ENDIAN
+#endif
+#else
+#undef HOST_IS_BIG_ENDIAN
+#endif
+#endif  // __BYTE_ORDER__
 
 unsigned int WordToHost(unsigned int word);
 unsigned short ShortToHost(unsigned short shortword);
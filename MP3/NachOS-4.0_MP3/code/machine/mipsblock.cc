@@ -0,0 +1,463 @@
+// mipsblock.cc -- run user code a basic block at a time
+//
+//   An alternative to the one-instruction-at-a-time loop in mipssim.cc,
+//   selected with "-sim block".  Basic blocks are translated into
+//   arrays of BlockOps (see mipsblock.h) and run with direct-threaded
+//   dispatch: each op jumps straight to the code for the next one.
+//
+//   The simulated machine cannot tell the difference.  Every
+//   instruction still updates the registers, the delayed load and the
+//   program counters exactly as Machine::ExecuteInstruction does, and
+//   is still followed by one call to Interrupt::OneTick, so interrupts
+//   and context switches happen on the same tick as before.
+//   Instructions that are rare or hard to get right twice (overflow
+//   checks, multiply and divide, the unaligned loads and stores,
+//   syscalls) are simply handed to ExecuteInstruction.
+//
+//   Uses the GCC "labels as values" extension.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "mipsblock.h"
+
+#include "copyright.h"
+#include "debug.h"
+#include "machine.h"
+#include "main.h"
+#include "mipsjit.h"
+
+// The label in Machine::ExecuteBlock for each opcode, filled in the
+// first time a block is translated.
+static void *opHandlers[MaxOpcode + 1];
+static bool opHandlersReady = FALSE;
+
+//----------------------------------------------------------------------
+// Machine::RunBlock
+// 	Run the basic block starting at the PC, translating it first if
+//	needed.  Like one round of the loop in Machine::Run, but for
+//	several instructions.
+//
+//	Blocks are found by the physical address of their first
+//	instruction, which is checked against the PC and the word in
+//	memory; a block that no longer matches is translated again.
+//
+//	Under "-sim jit", a block that has been run often enough is
+//	compiled to host code (mipsjit.cc), which is run instead.  Compiled
+//	blocks are chained to each other only when there is no TLB.
+//----------------------------------------------------------------------
+
+void Machine::RunBlock() {
+    ExceptionType exception;
+    int physicalAddress;
+    Block *block;
+
+    exception = Translate(registers[PCReg], &physicalAddress, 4, FALSE);
+    if (exception != NoException) {
+        RaiseException(exception, registers[PCReg]);
+        kernel->interrupt->OneTick();
+        return;
+    }
+
+    block = blockCache[physicalAddress / 4];
+    if (block == NULL || block->ops[0].pc != registers[PCReg] ||
+        *block->ops[0].word != block->ops[0].value) {
+        block = TranslateBlock(block, registers[PCReg], physicalAddress);
+        blockCache[physicalAddress / 4] = block;
+    }
+
+    if (engine == JitEngine) {
+        if (jit == NULL) jit = new Jit;
+        if (block->code == NULL && ++block->runCount == JitThreshold &&
+            jit->Compile(block, physicalAddress))
+            kernel->stats->numBlocksCompiled++;
+        // With a TLB, each block has to come back here first, so that
+        // its fetch goes through Translate and can miss like it would
+        // under the interpreter; chained blocks would skip that.
+        if (lastCompiled != NULL && tlb == NULL)
+            jit->Chain(lastCompiled, block, physicalAddress);
+        if (block->code != NULL) {
+            lastCompiled = (*block->code)(registers);
+            return;
+        }
+        lastCompiled = NULL;
+    }
+    ExecuteBlock(block);
+}
+
+//----------------------------------------------------------------------
+// Machine::TranslateBlock
+// 	Translate the basic block at virtual address "virtAddr", which
+//	the page table maps to "physAddr".  Reuses "block" if it is not
+//	NULL, otherwise allocates a new one.
+//
+//	A block never crosses a page, since the next page may be mapped
+//	anywhere.  A branch at the end of a page simply leaves its delay
+//	slot to the next block; the program counters carry the state.
+//----------------------------------------------------------------------
+
+Block *Machine::TranslateBlock(Block *block, int virtAddr, int physAddr) {
+    BlockOp ops[MaxBlockOps];
+    BlockOp *op;
+    int numOps = 0;
+    bool delaySlot = FALSE;
+
+    if (!opHandlersReady) {
+        ExecuteBlock(NULL);
+        opHandlersReady = TRUE;
+    }
+
+    for (;;) {
+        op = &ops[numOps++];
+        op->pc = virtAddr;
+        op->word = (unsigned int *)&mainMemory[physAddr];
+        op->value = *op->word;
+        op->instr.value = WordToHost(op->value);
+        op->instr.Decode();
+        op->rs = &registers[(int)op->instr.rs];
+        op->rt = &registers[(int)op->instr.rt];
+        op->rd = &registers[(int)op->instr.rd];
+        op->handler = opHandlers[(int)op->instr.opCode];
+
+        switch (op->instr.opCode) {
+            case OP_ANDI:
+            case OP_ORI:
+            case OP_XORI:
+                op->extra = op->instr.extra & 0xffff;
+                break;
+            case OP_LUI:
+                op->extra = WordShiftLeft(op->instr.extra, 16);
+                break;
+            case OP_BEQ:
+            case OP_BNE:
+            case OP_BLEZ:
+            case OP_BGTZ:
+            case OP_BLTZ:
+            case OP_BGEZ:
+            case OP_J:
+            case OP_JAL:
+                op->extra = IndexToAddr(op->instr.extra);
+                break;
+            default:
+                op->extra = op->instr.extra;
+                break;
+        }
+
+        if (delaySlot) break;  // the block ends after the delay slot
+        switch (op->instr.opCode) {
+            case OP_BEQ:
+            case OP_BNE:
+            case OP_BLEZ:
+            case OP_BGTZ:
+            case OP_BLTZ:
+            case OP_BGEZ:
+            case OP_BLTZAL:
+            case OP_BGEZAL:
+            case OP_J:
+            case OP_JAL:
+            case OP_JR:
+            case OP_JALR:
+                delaySlot = TRUE;
+                break;
+            default:
+                break;
+        }
+        if (!delaySlot && (op->instr.opCode == OP_SYSCALL ||
+                           op->instr.opCode == OP_RES ||
+                           op->instr.opCode == OP_UNIMP))
+            break;  // always traps to the kernel
+
+        virtAddr += 4;
+        physAddr += 4;
+        if ((physAddr % PageSize) == 0 || numOps == MaxBlockOps) break;
+    }
+
+    if (block == NULL) block = new Block;
+    block->Reset();
+    if (block->numOps != numOps) {
+        delete[] block->ops;
+        block->ops = new BlockOp[numOps];
+    }
+    block->numOps = numOps;
+    for (int i = 0; i < numOps; i++)
+        block->ops[i] = ops[i];
+
+    kernel->stats->numBlocksTranslated++;
+    DEBUG(dbgMach, "Translated block at " << ops[0].pc << ", " << numOps
+                                          << " instructions");
+    return block;
+}
+
+//----------------------------------------------------------------------
+// Machine::ExecuteBlock
+// 	Run the instructions of "block", starting with the first, until
+//	control leaves the block: after its last instruction, after a
+//	taken branch, or after an exception.  Called with NULL, only fill
+//	in opHandlers.
+//
+//	Each instruction is executed exactly as in ExecuteInstruction,
+//	then followed by Interrupt::OneTick as in Machine::Run.  A block
+//	is only ever run by the thread whose address space maps it, so it
+//	stays valid even if OneTick switches to another thread and back.
+//
+//	Before each instruction its word in memory is compared with the
+//	one it was translated from, so a program that overwrites its own
+//	code (or the kernel loading a new program into the frame) just
+//	ends the block, and the block at the PC is translated again.
+//----------------------------------------------------------------------
+
+void Machine::ExecuteBlock(Block *block) {
+    BlockOp *op, *end;
+    int pcAfter, tmp, value;
+    int nextLoadReg, nextLoadValue;
+
+    if (block == NULL) {
+        for (int i = 0; i <= MaxOpcode; i++)
+            opHandlers[i] = &&generic;
+        opHandlers[OP_ADDIU] = &&op_addiu;
+        opHandlers[OP_ADDU] = &&op_addu;
+        opHandlers[OP_AND] = &&op_and;
+        opHandlers[OP_ANDI] = &&op_andi;
+        opHandlers[OP_BEQ] = &&op_beq;
+        opHandlers[OP_BGEZ] = &&op_bgez;
+        opHandlers[OP_BGTZ] = &&op_bgtz;
+        opHandlers[OP_BLEZ] = &&op_blez;
+        opHandlers[OP_BLTZ] = &&op_bltz;
+        opHandlers[OP_BNE] = &&op_bne;
+        opHandlers[OP_J] = &&op_j;
+        opHandlers[OP_JAL] = &&op_jal;
+        opHandlers[OP_JALR] = &&op_jalr;
+        opHandlers[OP_JR] = &&op_jr;
+        opHandlers[OP_LB] = &&op_lb;
+        opHandlers[OP_LBU] = &&op_lbu;
+        opHandlers[OP_LH] = &&op_lh;
+        opHandlers[OP_LHU] = &&op_lhu;
+        opHandlers[OP_LUI] = &&op_lui;
+        opHandlers[OP_LW] = &&op_lw;
+        opHandlers[OP_MFHI] = &&op_mfhi;
+        opHandlers[OP_MFLO] = &&op_mflo;
+        opHandlers[OP_MTHI] = &&op_mthi;
+        opHandlers[OP_MTLO] = &&op_mtlo;
+        opHandlers[OP_NOR] = &&op_nor;
+        opHandlers[OP_OR] = &&op_or;
+        opHandlers[OP_ORI] = &&op_ori;
+        opHandlers[OP_SB] = &&op_sb;
+        opHandlers[OP_SH] = &&op_sh;
+        opHandlers[OP_SLL] = &&op_sll;
+        opHandlers[OP_SLLV] = &&op_sllv;
+        opHandlers[OP_SLT] = &&op_slt;
+        opHandlers[OP_SLTI] = &&op_slti;
+        opHandlers[OP_SLTIU] = &&op_sltiu;
+        opHandlers[OP_SLTU] = &&op_sltu;
+        opHandlers[OP_SRA] = &&op_sra;
+        opHandlers[OP_SRAV] = &&op_srav;
+        opHandlers[OP_SRL] = &&op_srl;
+        opHandlers[OP_SRLV] = &&op_srlv;
+        opHandlers[OP_SUBU] = &&op_subu;
+        opHandlers[OP_SW] = &&op_sw;
+        opHandlers[OP_XOR] = &&op_xor;
+        opHandlers[OP_XORI] = &&op_xori;
+        return;
+    }
+
+    op = block->ops;
+    end = op + block->numOps;
+
+next:
+    if (*op->word != op->value) return;  // overwritten since translation
+    pcAfter = registers[NextPCReg] + 4;
+    nextLoadReg = 0;
+    nextLoadValue = 0;
+    goto *op->handler;
+
+op_addiu:
+    *op->rt = WordAdd(*op->rs, op->extra);
+    goto done;
+op_addu:
+    *op->rd = WordAdd(*op->rs, *op->rt);
+    goto done;
+op_and:
+    *op->rd = *op->rs & *op->rt;
+    goto done;
+op_andi:
+    *op->rt = *op->rs & op->extra;
+    goto done;
+op_beq:
+    if (*op->rs == *op->rt) pcAfter = registers[NextPCReg] + op->extra;
+    goto done;
+op_bgez:
+    if (!(*op->rs & SIGN_BIT)) pcAfter = registers[NextPCReg] + op->extra;
+    goto done;
+op_bgtz:
+    if (*op->rs > 0) pcAfter = registers[NextPCReg] + op->extra;
+    goto done;
+op_blez:
+    if (*op->rs <= 0) pcAfter = registers[NextPCReg] + op->extra;
+    goto done;
+op_bltz:
+    if (*op->rs & SIGN_BIT) pcAfter = registers[NextPCReg] + op->extra;
+    goto done;
+op_bne:
+    if (*op->rs != *op->rt) pcAfter = registers[NextPCReg] + op->extra;
+    goto done;
+op_jal:
+    registers[R31] = registers[NextPCReg] + 4;
+op_j:
+    pcAfter = (pcAfter & 0xf0000000) | op->extra;
+    goto done;
+op_jalr:
+    *op->rd = registers[NextPCReg] + 4;
+op_jr:
+    pcAfter = *op->rs;
+    goto done;
+op_lb:
+    if (!ReadMem(WordAdd(*op->rs, op->extra), 1, &value)) goto fault;
+    if (value & 0x80)
+        value |= 0xffffff00;
+    else
+        value &= 0xff;
+    goto load;
+op_lbu:
+    if (!ReadMem(WordAdd(*op->rs, op->extra), 1, &value)) goto fault;
+    value &= 0xff;
+    goto load;
+op_lh:
+    tmp = WordAdd(*op->rs, op->extra);
+    if (tmp & 0x1) {
+        RaiseException(AddressErrorException, tmp);
+        goto fault;
+    }
+    if (!ReadMem(tmp, 2, &value)) goto fault;
+    if (value & 0x8000)
+        value |= 0xffff0000;
+    else
+        value &= 0xffff;
+    goto load;
+op_lhu:
+    tmp = WordAdd(*op->rs, op->extra);
+    if (tmp & 0x1) {
+        RaiseException(AddressErrorException, tmp);
+        goto fault;
+    }
+    if (!ReadMem(tmp, 2, &value)) goto fault;
+    value &= 0xffff;
+    goto load;
+op_lw:
+    tmp = WordAdd(*op->rs, op->extra);
+    if (tmp & 0x3) {
+        RaiseException(AddressErrorException, tmp);
+        goto fault;
+    }
+    if (!ReadMem(tmp, 4, &value)) goto fault;
+load:
+    nextLoadReg = op->instr.rt;
+    nextLoadValue = value;
+    goto done;
+op_lui:
+    *op->rt = op->extra;
+    goto done;
+op_mfhi:
+    *op->rd = registers[HiReg];
+    goto done;
+op_mflo:
+    *op->rd = registers[LoReg];
+    goto done;
+op_mthi:
+    registers[HiReg] = *op->rs;
+    goto done;
+op_mtlo:
+    registers[LoReg] = *op->rs;
+    goto done;
+op_nor:
+    *op->rd = ~(*op->rs | *op->rt);
+    goto done;
+op_or:
+    *op->rd = *op->rs | *op->rt;
+    goto done;
+op_ori:
+    *op->rt = *op->rs | op->extra;
+    goto done;
+op_sb:
+    if (!WriteMem((unsigned)WordAdd(*op->rs, op->extra), 1, *op->rt))
+        goto fault;
+    goto done;
+op_sh:
+    if (!WriteMem((unsigned)WordAdd(*op->rs, op->extra), 2, *op->rt))
+        goto fault;
+    goto done;
+op_sw:
+    if (!WriteMem((unsigned)WordAdd(*op->rs, op->extra), 4, *op->rt))
+        goto fault;
+    goto done;
+op_sll:
+    *op->rd = WordShiftLeft(*op->rt, op->extra);
+    goto done;
+op_sllv:
+    *op->rd = WordShiftLeft(*op->rt, *op->rs & 0x1f);
+    goto done;
+op_slt:
+    *op->rd = (*op->rs < *op->rt) ? 1 : 0;
+    goto done;
+op_slti:
+    *op->rt = (*op->rs < op->extra) ? 1 : 0;
+    goto done;
+op_sltiu:
+    *op->rt = ((unsigned int)*op->rs < (unsigned int)op->extra) ? 1 : 0;
+    goto done;
+op_sltu:
+    *op->rd = ((unsigned int)*op->rs < (unsigned int)*op->rt) ? 1 : 0;
+    goto done;
+op_sra:
+    *op->rd = *op->rt >> op->extra;
+    goto done;
+op_srav:
+    *op->rd = *op->rt >> (*op->rs & 0x1f);
+    goto done;
+op_srl:
+    // ExecuteInstruction shifts a signed int here too, so SRL and SRLV
+    // behave like SRA and SRAV; keep it that way to match.
+    *op->rd = *op->rt >> op->extra;
+    goto done;
+op_srlv:
+    *op->rd = *op->rt >> (*op->rs & 0x1f);
+    goto done;
+op_subu:
+    *op->rd = WordSub(*op->rs, *op->rt);
+    goto done;
+op_xor:
+    *op->rd = *op->rs ^ *op->rt;
+    goto done;
+op_xori:
+    *op->rt = *op->rs ^ op->extra;
+    goto done;
+
+generic:
+    // ExecuteInstruction also does the delayed load and advances the PC
+    if (!ExecuteInstruction(&op->instr)) goto fault;
+    goto ticked;
+
+done:
+    DelayedLoad(nextLoadReg, nextLoadValue);
+    registers[PrevPCReg] = registers[PCReg];
+    registers[PCReg] = registers[NextPCReg];
+    registers[NextPCReg] = pcAfter;
+ticked:
+    kernel->interrupt->OneTick();
+    if (++op == end || registers[PCReg] != op->pc) return;
+    goto next;
+
+fault:
+    kernel->interrupt->OneTick();
+}
+
+//----------------------------------------------------------------------
+// Machine::FreeBlockCache
+// 	De-allocate every translated block, and the cache itself.
+//----------------------------------------------------------------------
+
+void Machine::FreeBlockCache() {
+    for (int i = 0; i < MemorySize / 4; i++)
+        if (blockCache[i] != NULL) delete blockCache[i];
+    delete[] blockCache;
+}
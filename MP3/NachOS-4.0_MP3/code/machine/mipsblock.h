@@ -0,0 +1,86 @@
+// mipsblock.h
+//	Data structures for the basic-block execution engine.
+//
+//	A block is a run of straight-line user code, ending with the
+//	delay slot of the first branch or jump, at a syscall, or at the
+//	end of a page.  Each instruction of the block is translated once
+//	into a BlockOp, which holds the address of the code that executes
+//	it (a label inside Machine::ExecuteBlock, reached by a computed
+//	goto) and pointers to the registers it uses.  Running a block
+//	then needs no address translation, no decoding and no switch.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef MIPSBLOCK_H
+#define MIPSBLOCK_H
+
+#include "copyright.h"
+#include "mipssim.h"
+#include "utility.h"
+
+const int MaxBlockOps = 64;  // longest block translated in one go
+
+// One translated instruction.
+
+class BlockOp {
+   public:
+    void *handler;       // where ExecuteBlock runs this instruction
+    int *rs, *rt, *rd;   // the registers named by the instruction
+    int extra;           // the immediate, already masked, shifted or
+                         // scaled the way the instruction uses it
+    int pc;              // virtual address of the instruction
+    unsigned int *word;  // the instruction in mainMemory
+    unsigned int value;  // what *word held when it was translated
+    Instruction instr;   // decoded instruction, for the instructions
+                         // left to Machine::ExecuteInstruction
+};
+
+// A way out of a block compiled to host code (see mipsjit.cc), which
+// can be pointed straight at the compiled code of the next block.
+
+class BlockExit {
+   public:
+    int pc;               // virtual address the exit leads to
+    int physAddr;         // where that was mapped when the block was
+                          // compiled
+    unsigned char *jump;  // the jump to patch, NULL if already chained
+};
+
+class Block;
+
+// Host code compiled from a block: runs it on "registers" (the
+// Machine's), and returns the block whose code it finally left from.
+typedef Block *(*BlockCode)(int *registers);
+
+// A translated basic block, found through Machine::blockCache by the
+// physical address of its first instruction.
+
+class Block {
+   public:
+    Block() {
+        numOps = 0;
+        ops = NULL;
+        Reset();
+    }
+    ~Block() { delete[] ops; }
+
+    void Reset() {  // forget the profile and any host code
+        runCount = 0;
+        code = NULL;
+        body = NULL;
+        numExits = 0;
+    }
+
+    int numOps;    // number of instructions in the block
+    BlockOp *ops;  // the instructions, in program order
+
+    int runCount;         // times run as threaded code
+    BlockCode code;       // host code for the block, or NULL
+    unsigned char *body;  // where other blocks' code chains into it
+    int numExits;         // exits that may still be chained
+    BlockExit exits[2];
+};
+
+#endif  // MIPSBLOCK_H
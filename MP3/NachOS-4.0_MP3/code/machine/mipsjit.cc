@@ -0,0 +1,619 @@
+// mipsjit.cc -- compile hot basic blocks to host x86 code
+//
+//   The third way of running user code, selected with "-sim jit".
+//   Blocks start out as threaded code (mipsblock.cc); the ones that
+//   have run JitThreshold times are compiled here into x86 code, which
+//   runs straight out of a buffer the host lets us execute.
+//
+//   As with the block engine, the simulated machine cannot tell the
+//   difference.  The code for each instruction works directly on
+//   Machine::registers, in the same order ExecuteInstruction does:
+//   the instruction itself, then the delayed load, then the program
+//   counters.  Then it calls Interrupt::OneTick, and goes on only if
+//   the PC is where the block expects.  Loads, stores, multiply and
+//   divide, syscalls and everything else that can raise an exception
+//   simply call ExecuteInstruction; when that fails the code ticks and
+//   returns, leaving the kernel's exception handler to have run just
+//   as under the interpreter.  Every instruction is first compared
+//   with the word it was compiled from, so code that is overwritten
+//   drops back to RunBlock, which translates it again.
+//
+//   A compiled block that ends with a jump to another block on the
+//   same page is "chained" to it: once both are compiled, the jump
+//   goes straight to the other block's code, without coming back out
+//   to Machine::Run.  Blocks on other pages are never chained, since
+//   only the page the block was entered on is known to be mapped.
+//
+//   The same code generator serves x86 and x86-64 hosts: it only uses
+//   32-bit operations on EAX, ECX, EDX and EBX, which encode the same
+//   way on both, and differs only where pointers and calls are
+//   involved.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "mipsjit.h"
+
+#include <string.h>
+
+#include "copyright.h"
+#include "machine.h"
+#include "main.h"
+#include "sysdep.h"
+
+#if defined(x86) || defined(x86_64)
+#define JIT_HOST  // there is a code generator for this host
+#endif
+
+// The x86 registers the generated code uses.  EBX holds the address of
+// Machine::registers, and survives calls in both host ABIs; the others
+// are scratch.
+enum { EAX = 0, ECX = 1, EDX = 2, EBX = 3 };
+
+// Opcodes of "op r32, r/m32" and "op r/m32, r32"
+enum {
+    OpAdd = 0x03,
+    OpOr = 0x0b,
+    OpAnd = 0x23,
+    OpSub = 0x2b,
+    OpXor = 0x33,
+    OpCmp = 0x3b,
+    OpMovTo = 0x89,
+    OpMovFrom = 0x8b
+};
+
+// The "/digit" of "op r/m32, imm32"
+enum { ExtAdd = 0, ExtOr = 1, ExtAnd = 4, ExtSub = 5, ExtXor = 6, ExtCmp = 7 };
+
+// Condition codes, as in Jcc and SETcc
+enum {
+    CcB = 0x2,
+    CcE = 0x4,
+    CcNE = 0x5,
+    CcL = 0xc,
+    CcGE = 0xd,
+    CcLE = 0xe,
+    CcG = 0xf
+};
+
+const int MaxOpBytes = 192;   // the most host code one instruction needs
+const int MaxEndBytes = 256;  // and the chained exits, fault and return
+
+//----------------------------------------------------------------------
+// Jit::Jit
+// 	Allocate the buffer compiled code goes into.  If the host will not
+//	give us one, every Compile fails.
+//----------------------------------------------------------------------
+
+Jit::Jit() {
+    buffer = AllocExecutableArray(JitBufferSize);
+    used = 0;
+    code = NULL;
+}
+
+//----------------------------------------------------------------------
+// Jit::~Jit
+// 	De-allocate the compiled code.
+//----------------------------------------------------------------------
+
+Jit::~Jit() {
+    if (buffer != NULL) DeallocExecutableArray(buffer, JitBufferSize);
+}
+
+//----------------------------------------------------------------------
+// Jit::Execute, Jit::Tick
+// 	Called from compiled code, to run one instruction through
+//	Machine::ExecuteInstruction (returning FALSE if it raised an
+//	exception), and to advance simulated time by one tick.
+//----------------------------------------------------------------------
+
+int Jit::Execute(BlockOp *op) {
+    return kernel->machine->ExecuteInstruction(&op->instr);
+}
+
+void Jit::Tick() { kernel->interrupt->OneTick(); }
+
+//----------------------------------------------------------------------
+// Jit::Compile
+// 	Write host code for "block", whose first instruction is at
+//	physical address "physAddr".  On success set block->code and
+//	block->body, and the exits that may later be chained.
+//
+//	Space in the buffer is never reused: another thread may be
+//	in the middle of any compiled code, waiting in OneTick to be
+//	switched back to.  When the buffer is full, the rest of the
+//	blocks stay threaded code.
+//----------------------------------------------------------------------
+
+bool Jit::Compile(Block *block, int physAddr) {
+#ifndef JIT_HOST
+    return FALSE;
+#else
+    unsigned char *toExit[2 * MaxBlockOps + 3];
+    unsigned char *toFault[MaxBlockOps];
+    unsigned char *start, *body, *fault;
+    int numToExit = 0, numToFault = 0;
+    BlockOp *op, *last;
+    BlockExit *out;
+    int rs, rt, rd, target;
+    bool native, branch;
+
+    if (buffer == NULL ||
+        used + block->numOps * MaxOpBytes + MaxEndBytes > JitBufferSize)
+        return FALSE;
+    start = code = (unsigned char *)buffer + used;
+
+#ifdef x86_64
+    Byte(0x53);  // push %rbx
+    Byte(0x48);  // mov %rdi,%rbx
+    Byte(0x89);
+    Byte(0xfb);
+#else
+    Byte(0x53);  // push %ebx
+    Byte(0x8b);  // mov 8(%esp),%ebx
+    Byte(0x5c);
+    Byte(0x24);
+    Byte(0x08);
+    Byte(0x83);  // sub $8,%esp, to keep calls 16-byte aligned
+    Byte(0xec);
+    Byte(0x08);
+#endif
+    body = code;
+
+    for (int i = 0; i < block->numOps; i++) {
+        op = &block->ops[i];
+        rs = op->instr.rs;
+        rt = op->instr.rt;
+        rd = op->instr.rd;
+
+        // stop if the instruction was overwritten, as ExecuteBlock does
+        Byte(0xa1);  // mov op->word,%eax
+        memcpy(code, &op->word, sizeof(op->word));
+        code += sizeof(op->word);
+        ImmOp(ExtCmp, EAX, op->value);
+        toExit[numToExit++] = Jump(CcNE);
+
+        native = TRUE;
+        branch = FALSE;
+        switch (op->instr.opCode) {
+            case OP_ADDIU:
+                Load(EAX, rs);
+                ImmOp(ExtAdd, EAX, op->extra);
+                Store(EAX, rt);
+                break;
+            case OP_ADDU:
+                Load(EAX, rs);
+                RegOp(OpAdd, EAX, rt);
+                Store(EAX, rd);
+                break;
+            case OP_AND:
+                Load(EAX, rs);
+                RegOp(OpAnd, EAX, rt);
+                Store(EAX, rd);
+                break;
+            case OP_ANDI:
+                Load(EAX, rs);
+                ImmOp(ExtAnd, EAX, op->extra);
+                Store(EAX, rt);
+                break;
+            case OP_LUI:
+                StoreImm(rt, op->extra);
+                break;
+            case OP_MFHI:
+                Load(EAX, HiReg);
+                Store(EAX, rd);
+                break;
+            case OP_MFLO:
+                Load(EAX, LoReg);
+                Store(EAX, rd);
+                break;
+            case OP_MTHI:
+                Load(EAX, rs);
+                Store(EAX, HiReg);
+                break;
+            case OP_MTLO:
+                Load(EAX, rs);
+                Store(EAX, LoReg);
+                break;
+            case OP_NOR:
+                Load(EAX, rs);
+                RegOp(OpOr, EAX, rt);
+                Byte(0xf7);  // not %eax
+                Byte(0xd0);
+                Store(EAX, rd);
+                break;
+            case OP_OR:
+                Load(EAX, rs);
+                RegOp(OpOr, EAX, rt);
+                Store(EAX, rd);
+                break;
+            case OP_ORI:
+                Load(EAX, rs);
+                ImmOp(ExtOr, EAX, op->extra);
+                Store(EAX, rt);
+                break;
+            case OP_SLL:
+                Load(EAX, rt);
+                Byte(0xc1);  // shl $extra,%eax
+                Byte(0xe0);
+                Byte(op->extra);
+                Store(EAX, rd);
+                break;
+            case OP_SRA:
+            case OP_SRL:  // arithmetic, as in ExecuteInstruction
+                Load(EAX, rt);
+                Byte(0xc1);  // sar $extra,%eax
+                Byte(0xf8);
+                Byte(op->extra);
+                Store(EAX, rd);
+                break;
+            case OP_SLLV:
+                Load(ECX, rs);  // the host also uses only the low 5 bits
+                Load(EAX, rt);
+                Byte(0xd3);  // shl %cl,%eax
+                Byte(0xe0);
+                Store(EAX, rd);
+                break;
+            case OP_SRAV:
+            case OP_SRLV:
+                Load(ECX, rs);
+                Load(EAX, rt);
+                Byte(0xd3);  // sar %cl,%eax
+                Byte(0xf8);
+                Store(EAX, rd);
+                break;
+            case OP_SLT:
+                Load(EAX, rs);
+                RegOp(OpCmp, EAX, rt);
+                SetIf(CcL);
+                Store(EAX, rd);
+                break;
+            case OP_SLTI:
+                Load(EAX, rs);
+                ImmOp(ExtCmp, EAX, op->extra);
+                SetIf(CcL);
+                Store(EAX, rt);
+                break;
+            case OP_SLTIU:
+                Load(EAX, rs);
+                ImmOp(ExtCmp, EAX, op->extra);
+                SetIf(CcB);
+                Store(EAX, rt);
+                break;
+            case OP_SLTU:
+                Load(EAX, rs);
+                RegOp(OpCmp, EAX, rt);
+                SetIf(CcB);
+                Store(EAX, rd);
+                break;
+            case OP_SUBU:
+                Load(EAX, rs);
+                RegOp(OpSub, EAX, rt);
+                Store(EAX, rd);
+                break;
+            case OP_XOR:
+                Load(EAX, rs);
+                RegOp(OpXor, EAX, rt);
+                Store(EAX, rd);
+                break;
+            case OP_XORI:
+                Load(EAX, rs);
+                ImmOp(ExtXor, EAX, op->extra);
+                Store(EAX, rt);
+                break;
+
+            // Branches and jumps leave the new NextPC in ECX
+            case OP_BEQ:
+            case OP_BNE:
+                Load(ECX, NextPCReg);
+                ImmOp(ExtAdd, ECX, 4);
+                Load(EAX, rs);
+                RegOp(OpCmp, EAX, rt);
+                Branch(op->instr.opCode == OP_BEQ ? CcNE : CcE, op->extra);
+                branch = TRUE;
+                break;
+            case OP_BLEZ:
+            case OP_BGTZ:
+            case OP_BLTZ:
+            case OP_BGEZ:
+                Load(ECX, NextPCReg);
+                ImmOp(ExtAdd, ECX, 4);
+                Load(EAX, rs);
+                Byte(0x85);  // test %eax,%eax
+                Byte(0xc0);
+                switch (op->instr.opCode) {
+                    case OP_BLEZ:
+                        Branch(CcG, op->extra);
+                        break;
+                    case OP_BGTZ:
+                        Branch(CcLE, op->extra);
+                        break;
+                    case OP_BLTZ:
+                        Branch(CcGE, op->extra);
+                        break;
+                    default:
+                        Branch(CcL, op->extra);
+                        break;
+                }
+                branch = TRUE;
+                break;
+            case OP_JAL:
+                Load(EAX, NextPCReg);
+                ImmOp(ExtAdd, EAX, 4);
+                Store(EAX, R31);
+                // fall through
+            case OP_J:
+                Load(ECX, NextPCReg);
+                ImmOp(ExtAdd, ECX, 4);
+                ImmOp(ExtAnd, ECX, 0xf0000000);
+                ImmOp(ExtOr, ECX, op->extra);
+                branch = TRUE;
+                break;
+            case OP_JALR:
+                Load(EAX, NextPCReg);
+                ImmOp(ExtAdd, EAX, 4);
+                Store(EAX, rd);
+                // fall through
+            case OP_JR:
+                Load(ECX, rs);
+                branch = TRUE;
+                break;
+
+            default:
+                // ExecuteInstruction also does the delayed load and
+                // advances the PC
+                Call((void *)Execute, op);
+                Byte(0x85);  // test %eax,%eax
+                Byte(0xc0);
+                toFault[numToFault++] = Jump(CcE);
+                native = FALSE;
+                break;
+        }
+
+        if (native) {
+            // DelayedLoad(0, 0)
+            Load(EAX, LoadReg);
+            Load(EDX, LoadValueReg);
+            Byte(0x89);  // mov %edx,(%ebx,%eax,4)
+            Byte(0x14);
+            Byte(0x83);
+            StoreImm(LoadReg, 0);
+            StoreImm(LoadValueReg, 0);
+            StoreImm(0, 0);
+
+            Load(EAX, PCReg);
+            Store(EAX, PrevPCReg);
+            Load(EAX, NextPCReg);
+            Store(EAX, PCReg);
+            if (!branch) {
+                ImmOp(ExtAdd, EAX, 4);
+                Store(EAX, NextPCReg);
+            } else {
+                Store(ECX, NextPCReg);
+            }
+        }
+
+        Call((void *)Tick, NULL);
+        if (i + 1 < block->numOps) {
+            Byte(0x81);  // cmpl $pc,PCReg
+            Byte(0xbb);
+            Word(PCReg * 4);
+            Word(op[1].pc);
+            toExit[numToExit++] = Jump(CcNE);
+        }
+    }
+
+    // The blocks control can go to next: the one after the last
+    // instruction, and the target of a branch or jump just before it.
+    // Those on this page are given a jump to patch when they are
+    // compiled too.
+    last = &block->ops[block->numOps - 1];
+    block->numExits = 0;
+    Load(EAX, PCReg);
+    for (int i = 0; i < 2; i++) {
+        if (i == 0) {
+            target = last->pc + 4;
+        } else if (block->numOps < 2) {
+            break;
+        } else {
+            op = last - 1;
+            switch (op->instr.opCode) {
+                case OP_BEQ:
+                case OP_BNE:
+                case OP_BLEZ:
+                case OP_BGTZ:
+                case OP_BLTZ:
+                case OP_BGEZ:
+                    target = op->pc + 4 + op->extra;
+                    break;
+                case OP_J:
+                case OP_JAL:
+                    target = ((op->pc + 8) & 0xf0000000) | op->extra;
+                    break;
+                default:
+                    continue;
+            }
+        }
+        if (divRoundDown(target, PageSize) !=
+            divRoundDown(block->ops[0].pc, PageSize))
+            continue;
+
+        out = &block->exits[block->numExits++];
+        out->pc = target;
+        out->physAddr = physAddr + (target - block->ops[0].pc);
+        ImmOp(ExtCmp, EAX, target);
+        Byte(0x70 | CcNE);  // jne over the jmp
+        Byte(5);
+        out->jump = toExit[numToExit++] = Jump(-1);
+    }
+    if (numToFault > 0) {  // the instruction raised an exception
+        toExit[numToExit++] = Jump(-1);
+        fault = code;
+        Call((void *)Tick, NULL);
+        for (int i = 0; i < numToFault; i++)
+            Patch(toFault[i], fault);
+    }
+    for (int i = 0; i < numToExit; i++)
+        Patch(toExit[i], code);
+    Return(block);
+
+    used = code - (unsigned char *)buffer;
+    block->code = (BlockCode)start;
+    block->body = body;
+    return TRUE;
+#endif
+}
+
+//----------------------------------------------------------------------
+// Jit::Chain
+// 	Control just went from the compiled code of "from" to the block
+//	"to", at physical address "physAddr".  If "from" has an exit
+//	there, and "to" is compiled, patch the exit to go straight to
+//	the code for "to".  The physical address makes sure both blocks
+//	belong to the same address space.
+//----------------------------------------------------------------------
+
+void Jit::Chain(Block *from, Block *to, int physAddr) {
+    BlockExit *out;
+
+    if (to->code == NULL) return;
+    for (int i = 0; i < from->numExits; i++) {
+        out = &from->exits[i];
+        if (out->jump != NULL && out->pc == to->ops[0].pc &&
+            out->physAddr == physAddr) {
+            Patch(out->jump, to->body);
+            out->jump = NULL;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// Emitting host instructions.  All of them are written at "code".
+//
+//	Machine::registers is addressed as disp32(%ebx), which means
+//	disp32(%rbx) on x86-64, where %rbx holds the full pointer.
+//----------------------------------------------------------------------
+
+void Jit::Byte(int b) { *code++ = (unsigned char)b; }
+
+void Jit::Word(int w) {
+    memcpy(code, &w, 4);
+    code += 4;
+}
+
+// "opcode" between host register "reg" and registers[r]
+void Jit::RegOp(int opcode, int reg, int r) {
+    Byte(opcode);
+    Byte(0x80 | (reg << 3) | EBX);
+    Word(r * 4);
+}
+
+void Jit::Load(int reg, int r) { RegOp(OpMovFrom, reg, r); }
+
+void Jit::Store(int reg, int r) { RegOp(OpMovTo, reg, r); }
+
+void Jit::StoreImm(int r, int value) {
+    Byte(0xc7);  // movl $value,registers[r]
+    Byte(0x83);
+    Word(r * 4);
+    Word(value);
+}
+
+// "op $value,%reg", the op given by its "/digit"
+void Jit::ImmOp(int ext, int reg, int value) {
+    Byte(0x81);
+    Byte(0xc0 | (ext << 3) | reg);
+    Word(value);
+}
+
+void Jit::SetIf(int cc) {
+    Byte(0x0f);  // setcc %al
+    Byte(0x90 | cc);
+    Byte(0xc0);
+    Byte(0x0f);  // movzbl %al,%eax
+    Byte(0xb6);
+    Byte(0xc0);
+}
+
+// Unless condition "skip" holds, set ECX to NextPC + "offset"
+void Jit::Branch(int skip, int offset) {
+    Byte(0x70 | skip);  // jcc over the next 12 bytes
+    Byte(12);
+    Load(ECX, NextPCReg);
+    ImmOp(ExtAdd, ECX, offset);
+}
+
+// Call "func", with "arg" as its only argument unless it is NULL.
+// The stack is 16-byte aligned at the call on both hosts.
+void Jit::Call(void *func, void *arg) {
+#ifdef x86_64
+    if (arg != NULL) {
+        Byte(0x48);  // movabs $arg,%rdi
+        Byte(0xbf);
+        memcpy(code, &arg, 8);
+        code += 8;
+    }
+    Byte(0x48);  // movabs $func,%rax
+    Byte(0xb8);
+    memcpy(code, &func, 8);
+    code += 8;
+    Byte(0xff);  // call *%rax
+    Byte(0xd0);
+#else
+    if (arg != NULL) {
+        Byte(0x83);  // sub $12,%esp
+        Byte(0xec);
+        Byte(0x0c);
+        Byte(0x68);  // push $arg
+        Word((int)arg);
+    }
+    Byte(0xb8);  // mov $func,%eax
+    Word((int)func);
+    Byte(0xff);  // call *%eax
+    Byte(0xd0);
+    if (arg != NULL) {
+        Byte(0x83);  // add $16,%esp
+        Byte(0xc4);
+        Byte(0x10);
+    }
+#endif
+}
+
+// Jump if condition "cc" holds, or always if "cc" is -1.  Return where
+// the displacement goes, for Patch.
+unsigned char *Jit::Jump(int cc) {
+    if (cc < 0) {
+        Byte(0xe9);
+    } else {
+        Byte(0x0f);
+        Byte(0x80 | cc);
+    }
+    Word(0);
+    return code - 4;
+}
+
+void Jit::Patch(unsigned char *jump, unsigned char *target) {
+    int offset = target - (jump + 4);
+
+    memcpy(jump, &offset, 4);
+}
+
+// Undo the prologue in Compile, and return "block"
+void Jit::Return(Block *block) {
+#ifdef x86_64
+    Byte(0x48);  // movabs $block,%rax
+    Byte(0xb8);
+    memcpy(code, &block, 8);
+    code += 8;
+    Byte(0x5b);  // pop %rbx
+#else
+    Byte(0xb8);  // mov $block,%eax
+    Word((int)block);
+    Byte(0x83);  // add $8,%esp
+    Byte(0xc4);
+    Byte(0x08);
+    Byte(0x5b);  // pop %ebx
+#endif
+    Byte(0xc3);  // ret
+}
@@ -0,0 +1,66 @@
+// mipsjit.h
+//	Data structures for compiling hot basic blocks to host code.
+//
+//	With "-sim jit", Machine::RunBlock counts how often each block
+//	is run, and once a block has run JitThreshold times it is handed
+//	to the Jit, which writes x86 code for it into a buffer the host
+//	can execute.  From then on RunBlock calls that code instead of
+//	Machine::ExecuteBlock.  Only x86 and x86-64 hosts are supported;
+//	elsewhere Compile always fails and blocks stay threaded code.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef MIPSJIT_H
+#define MIPSJIT_H
+
+#include "copyright.h"
+#include "mipsblock.h"
+
+const int JitThreshold = 50;                // runs before a block is compiled
+const int JitBufferSize = 8 * 1024 * 1024;  // bytes of host code, in all
+
+class Jit {
+   public:
+    Jit();   // allocate the code buffer
+    ~Jit();  // and give it back
+
+    bool Compile(Block *block, int physAddr);
+    // Write host code for "block", which
+    // starts at "physAddr".  Return FALSE
+    // if there is no room left, or no
+    // code generator for this host.
+
+    void Chain(Block *from, Block *to, int physAddr);
+    // If "from" has an exit to "to", at
+    // "physAddr", make it jump straight
+    // into the code for "to".
+
+   private:
+    // Helpers called from the generated code
+    static int Execute(BlockOp *op);  // run an instruction the slow way
+    static void Tick();               // advance simulated time
+
+    // Emit host instructions at "code"
+    void Byte(int b);
+    void Word(int w);
+    void Load(int reg, int r);                // reg = registers[r]
+    void Store(int reg, int r);               // registers[r] = reg
+    void RegOp(int opcode, int reg, int r);   // reg op= registers[r]
+    void StoreImm(int r, int value);          // registers[r] = value
+    void ImmOp(int ext, int reg, int value);  // reg op= value
+    void SetIf(int cc);                       // eax = "cc" ? 1 : 0
+    void Branch(int skip, int offset);        // unless "skip", branch
+    void Call(void *func, void *arg);         // func(arg), into eax
+    unsigned char *Jump(int cc);              // jump on "cc", or always
+                                              // if -1, to be patched
+    void Patch(unsigned char *jump, unsigned char *target);
+    void Return(Block *block);  // leave the code, returning block
+
+    char *buffer;         // host code of all the compiled blocks
+    int used;             // bytes of buffer already written
+    unsigned char *code;  // where the next host instruction goes
+};
+
+#endif  // MIPSJIT_H
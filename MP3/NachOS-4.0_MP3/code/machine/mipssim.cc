@@ -17,32 +17,16 @@
 #include "mipssim.h"
 
 #include "copyright.h"
+#include "costmodel.h"
 #include "debug.h"
+#include "hostperf.h"
 #include "machine.h"
 #include "main.h"
+#include "profile.h"
+#include "trace.h"
 
 static void Mult(int a, int b, bool signedArith, int *hiPtr, int *loPtr);
 
-// The following class defines an instruction, represented in both
-// 	undecoded binary form
-//      decoded to identify
-//	    operation to do
-//	    registers to act on
-//	    any immediate operand value
-
-class Instruction {
-   public:
-    void Decode();  // decode the binary representation of the instruction
-
-    unsigned int value;  // binary representation of the instruction
-
-    char opCode;      // Type of instruction.  This is NOT the same as the
-                      // opcode field from the instruction: see defs in mips.h
-    char rs, rt, rd;  // Three registers from instruction.
-    int extra;        // Immediate or target or shamt field or offset.
-                      // Immediates are sign-extended.
-};
-
 //----------------------------------------------------------------------
 // Machine::Run
 // 	Simulate the execution of a user-level program on Nachos.
@@ -50,20 +34,39 @@ class Instruction {
 //
 //	This routine is re-entrant, in that it can be called multiple
 //	times concurrently -- one for each thread executing user code.
+//
+//	With -hostperf, the host's time for each instruction, or each
+//	block, is counted in the "interp" or "block" region.
 //----------------------------------------------------------------------
 void Machine::Run() {
-    Instruction *instr = new Instruction;  // storage for decoded instruction
-    if (debug->IsEnabled('m')) {
+    HostPerf *perf = hostPerf;
+    HostRegion outer = HostOther;
+
+    if (DEBUG_ENABLED(dbgMach)) {
         cout << "Starting program in thread: "
              << kernel->currentThread->getName();
         cout << ", at time: " << kernel->stats->totalTicks << "\n";
     }
     kernel->interrupt->setStatus(UserMode);
     for (;;) {
+        // The block and JIT engines skip the per-instruction debugging
+        // output, the debugger, the profiler, the caches and the cost
+        // model, so leave those to the interpreter.
+        if (engine != InterpEngine && !singleStep && !DEBUG_ENABLED(dbgMach) &&
+            !DEBUG_ENABLED(dbgTraCode) && !DEBUG_ENABLED(dbgAddr) &&
+            profile == NULL && icache == NULL && dcache == NULL &&
+            costModel == NULL) {
+            if (perf != NULL) outer = perf->Enter(HostBlock);
+            RunBlock();
+            if (perf != NULL) perf->Leave(outer);
+            continue;
+        }
         DEBUG(dbgTraCode, "In Machine::Run(), into OneInstruction "
                               << "== Tick " << kernel->stats->totalTicks
                               << " ==");
-        OneInstruction(instr);
+        if (perf != NULL) outer = perf->Enter(HostInterp);
+        OneInstruction();
+        if (perf != NULL) perf->Leave(outer);
         DEBUG(dbgTraCode, "In Machine::Run(), return from OneInstruction  "
                               << "== Tick " << kernel->stats->totalTicks
                               << " ==");
@@ -121,34 +124,65 @@ static int TypeToReg(RegType reg, Instruction *instr) {
 //	leaving.  This allows the Nachos kernel to control our behavior
 //	by controlling the contents of memory, the translation table,
 //	and the register set.
+//
+//	The one exception is the decode cache (see FetchInstruction), which
+//	is safe to share because each entry is checked against the word
+//	currently in memory before it is used.
+//
+//	If the program is being profiled, the instruction is counted once
+//	it completes; one that raises an exception (other than a syscall)
+//	is counted when it is retried.  Likewise, with a cost model, the
+//	cycles of an instruction beyond the one UserTick are charged once
+//	it completes.
+//----------------------------------------------------------------------
+
+void Machine::OneInstruction() {
+    Instruction *instr;
+
+    // Fetch instruction
+    instr = FetchInstruction();
+    if (instr == NULL) return;  // exception occurred
+
+    TRACE(dbgMach, TraceInstruction, registers[PCReg], instr->opCode,
+          TypeToReg(opStrings[instr->opCode].args[0], instr),
+          TypeToReg(opStrings[instr->opCode].args[1], instr),
+          TypeToReg(opStrings[instr->opCode].args[2], instr));
+
+    Profile *programProfile = profile;  // a syscall may switch to
+    Instruction executed = *instr;      // another program, which
+    int pc = registers[PCReg];          // may reuse *instr
+    bool completed = ExecuteInstruction(instr);
+
+    if (programProfile != NULL && (completed || executed.opCode == OP_SYSCALL))
+        programProfile->Execute(pc, &executed);
+    if (completed && costModel != NULL) {
+        bool taken = registers[NextPCReg] != WordAdd(registers[PCReg], 4);
+        int extra = costModel->Cycles(&executed, taken) - UserTick;
+
+        kernel->stats->totalTicks += extra;  // OneTick charges the rest
+        kernel->stats->userTicks += extra;
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::ExecuteInstruction
+// 	Execute one decoded instruction, whose address is in the PC.
+//	Returns FALSE if an exception was raised, in which case the
+//	program counters are left for the exception handler to adjust.
+//
+//	Shared by OneInstruction and the block engine (mipsblock.cc), so
+//	both have exactly the same semantics for every instruction.
 //----------------------------------------------------------------------
 
-void Machine::OneInstruction(Instruction *instr) {
+bool Machine::ExecuteInstruction(Instruction *instr) {
 #ifdef SIM_FIX
     int byte;  // described in Kane for LWL,LWR,...
 #endif
 
-    int raw;
     int nextLoadReg = 0;
     int nextLoadValue = 0;  // record delayed load operation, to apply
                             // in the future
 
-    // Fetch instruction
-    if (!ReadMem(registers[PCReg], 4, &raw)) return;  // exception occurred
-    instr->value = raw;
-    instr->Decode();
-
-    if (debug->IsEnabled('m')) {
-        struct OpString *str = &opStrings[instr->opCode];
-        char buf[80];
-
-        ASSERT(instr->opCode <= MaxOpcode);
-        cout << "At PC = " << registers[PCReg];
-        sprintf(buf, str->format, TypeToReg(str->args[0], instr),
-                TypeToReg(str->args[1], instr), TypeToReg(str->args[2], instr));
-        cout << "\t" << buf << "\n";
-    }
-
     // Compute next pc, but don't install in case there's an error or branch.
     int pcAfter = registers[NextPCReg] + 4;
     int sum, diff, tmp, value;
@@ -157,31 +191,32 @@ void Machine::OneInstruction(Instruction *instr) {
     // Execute the instruction (cf. Kane's book)
     switch (instr->opCode) {
         case OP_ADD:
-            sum = registers[instr->rs] + registers[instr->rt];
+            sum = WordAdd(registers[instr->rs], registers[instr->rt]);
             if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
                 ((registers[instr->rs] ^ sum) & SIGN_BIT)) {
                 RaiseException(OverflowException, 0);
-                return;
+                return FALSE;
             }
             registers[instr->rd] = sum;
             break;
 
         case OP_ADDI:
-            sum = registers[instr->rs] + instr->extra;
+            sum = WordAdd(registers[instr->rs], instr->extra);
             if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
                 ((instr->extra ^ sum) & SIGN_BIT)) {
                 RaiseException(OverflowException, 0);
-                return;
+                return FALSE;
             }
             registers[instr->rt] = sum;
             break;
 
         case OP_ADDIU:
-            registers[instr->rt] = registers[instr->rs] + instr->extra;
+            registers[instr->rt] = WordAdd(registers[instr->rs], instr->extra);
             break;
 
         case OP_ADDU:
-            registers[instr->rd] = registers[instr->rs] + registers[instr->rt];
+            registers[instr->rd] =
+                WordAdd(registers[instr->rs], registers[instr->rt]);
             break;
 
         case OP_AND:
@@ -231,6 +266,12 @@ void Machine::OneInstruction(Instruction *instr) {
             if (registers[instr->rt] == 0) {
                 registers[LoReg] = 0;
                 registers[HiReg] = 0;
+            } else if (registers[instr->rs] == (int)SIGN_BIT &&
+                       registers[instr->rt] == -1) {
+                // The one quotient that does not fit: the hardware
+                // wraps it around, but C++ need not.
+                registers[LoReg] = registers[instr->rs];
+                registers[HiReg] = 0;
             } else {
                 registers[LoReg] = registers[instr->rs] / registers[instr->rt];
                 registers[HiReg] = registers[instr->rs] % registers[instr->rt];
@@ -265,8 +306,8 @@ void Machine::OneInstruction(Instruction *instr) {
 
         case OP_LB:
         case OP_LBU:
-            tmp = registers[instr->rs] + instr->extra;
-            if (!ReadMem(tmp, 1, &value)) return;
+            tmp = WordAdd(registers[instr->rs], instr->extra);
+            if (!ReadMem(tmp, 1, &value)) return FALSE;
 
             if ((value & 0x80) && (instr->opCode == OP_LB))
                 value |= 0xffffff00;
@@ -278,12 +319,12 @@ void Machine::OneInstruction(Instruction *instr) {
 
         case OP_LH:
         case OP_LHU:
-            tmp = registers[instr->rs] + instr->extra;
+            tmp = WordAdd(registers[instr->rs], instr->extra);
             if (tmp & 0x1) {
                 RaiseException(AddressErrorException, tmp);
-                return;
+                return FALSE;
             }
-            if (!ReadMem(tmp, 2, &value)) return;
+            if (!ReadMem(tmp, 2, &value)) return FALSE;
 
             if ((value & 0x8000) && (instr->opCode == OP_LH))
                 value |= 0xffff0000;
@@ -296,22 +337,22 @@ void Machine::OneInstruction(Instruction *instr) {
         case OP_LUI:
             DEBUG(dbgMach,
                   "Executing: LUI r" << instr->rt << ", " << instr->extra);
-            registers[instr->rt] = instr->extra << 16;
+            registers[instr->rt] = WordShiftLeft(instr->extra, 16);
             break;
 
         case OP_LW:
-            tmp = registers[instr->rs] + instr->extra;
+            tmp = WordAdd(registers[instr->rs], instr->extra);
             if (tmp & 0x3) {
                 RaiseException(AddressErrorException, tmp);
-                return;
+                return FALSE;
             }
-            if (!ReadMem(tmp, 4, &value)) return;
+            if (!ReadMem(tmp, 4, &value)) return FALSE;
             nextLoadReg = instr->rt;
             nextLoadValue = value;
             break;
 
         case OP_LWL:
-            tmp = registers[instr->rs] + instr->extra;
+            tmp = WordAdd(registers[instr->rs], instr->extra);
 
 #ifdef SIM_FIX
             // The only difference between this code and the BIG ENDIAN code
@@ -324,14 +365,14 @@ void Machine::OneInstruction(Instruction *instr) {
             byte = tmp & 0x3;
             // DEBUG('P', "Addr 0x%X\n",tmp-byte);
 
-            if (!ReadMem(tmp - byte, 4, &value)) return;
+            if (!ReadMem(tmp - byte, 4, &value)) return FALSE;
 #else
             // ReadMem assumes all 4 byte requests are aligned on an even
             // word boundary.  Also, the little endian/big endian swap code
             // would fail (I think) if the other cases are ever exercised.
             ASSERT((tmp & 0x3) == 0);
 
-            if (!ReadMem(tmp, 4, &value)) return;
+            if (!ReadMem(tmp, 4, &value)) return FALSE;
 #endif
 
             if (registers[LoadReg] == instr->rt)
@@ -348,20 +389,23 @@ void Machine::OneInstruction(Instruction *instr) {
                     nextLoadValue = value;
                     break;
                 case 1:
-                    nextLoadValue = (nextLoadValue & 0xff) | (value << 8);
+                    nextLoadValue =
+                        (nextLoadValue & 0xff) | WordShiftLeft(value, 8);
                     break;
                 case 2:
-                    nextLoadValue = (nextLoadValue & 0xffff) | (value << 16);
+                    nextLoadValue =
+                        (nextLoadValue & 0xffff) | WordShiftLeft(value, 16);
                     break;
                 case 3:
-                    nextLoadValue = (nextLoadValue & 0xffffff) | (value << 24);
+                    nextLoadValue =
+                        (nextLoadValue & 0xffffff) | WordShiftLeft(value, 24);
                     break;
             }
             nextLoadReg = instr->rt;
             break;
 
         case OP_LWR:
-            tmp = registers[instr->rs] + instr->extra;
+            tmp = WordAdd(registers[instr->rs], instr->extra);
 
 #ifdef SIM_FIX
             // The only difference between this code and the BIG ENDIAN code
@@ -374,14 +418,14 @@ void Machine::OneInstruction(Instruction *instr) {
             byte = tmp & 0x3;
             // DEBUG('P', "Addr 0x%X\n",tmp-byte);
 
-            if (!ReadMem(tmp - byte, 4, &value)) return;
+            if (!ReadMem(tmp - byte, 4, &value)) return FALSE;
 #else
             // ReadMem assumes all 4 byte requests are aligned on an even
             // word boundary.  Also, the little endian/big endian swap code
             // would fail (I think) if the other cases are ever exercised.
             ASSERT((tmp & 0x3) == 0);
 
-            if (!ReadMem(tmp, 4, &value)) return;
+            if (!ReadMem(tmp, 4, &value)) return FALSE;
 #endif
 
             if (registers[LoadReg] == instr->rt)
@@ -455,24 +499,25 @@ void Machine::OneInstruction(Instruction *instr) {
             break;
 
         case OP_SB:
-            if (!WriteMem((unsigned)(registers[instr->rs] + instr->extra), 1,
-                          registers[instr->rt]))
-                return;
+            if (!WriteMem((unsigned)WordAdd(registers[instr->rs], instr->extra),
+                          1, registers[instr->rt]))
+                return FALSE;
             break;
 
         case OP_SH:
-            if (!WriteMem((unsigned)(registers[instr->rs] + instr->extra), 2,
-                          registers[instr->rt]))
-                return;
+            if (!WriteMem((unsigned)WordAdd(registers[instr->rs], instr->extra),
+                          2, registers[instr->rt]))
+                return FALSE;
             break;
 
         case OP_SLL:
-            registers[instr->rd] = registers[instr->rt] << instr->extra;
+            registers[instr->rd] =
+                WordShiftLeft(registers[instr->rt], instr->extra);
             break;
 
         case OP_SLLV:
-            registers[instr->rd] = registers[instr->rt]
-                                   << (registers[instr->rs] & 0x1f);
+            registers[instr->rd] = WordShiftLeft(registers[instr->rt],
+                                                 registers[instr->rs] & 0x1f);
             break;
 
         case OP_SLT:
@@ -529,27 +574,28 @@ void Machine::OneInstruction(Instruction *instr) {
             break;
 
         case OP_SUB:
-            diff = registers[instr->rs] - registers[instr->rt];
+            diff = WordSub(registers[instr->rs], registers[instr->rt]);
             if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
                 ((registers[instr->rs] ^ diff) & SIGN_BIT)) {
                 RaiseException(OverflowException, 0);
-                return;
+                return FALSE;
             }
             registers[instr->rd] = diff;
             break;
 
         case OP_SUBU:
-            registers[instr->rd] = registers[instr->rs] - registers[instr->rt];
+            registers[instr->rd] =
+                WordSub(registers[instr->rs], registers[instr->rt]);
             break;
 
         case OP_SW:
-            if (!WriteMem((unsigned)(registers[instr->rs] + instr->extra), 4,
-                          registers[instr->rt]))
-                return;
+            if (!WriteMem((unsigned)WordAdd(registers[instr->rs], instr->extra),
+                          4, registers[instr->rt]))
+                return FALSE;
             break;
 
         case OP_SWL:
-            tmp = registers[instr->rs] + instr->extra;
+            tmp = WordAdd(registers[instr->rs], instr->extra);
 
 #ifdef SIM_FIX
             // The only difference between this code and the BIG ENDIAN code
@@ -560,7 +606,7 @@ void Machine::OneInstruction(Instruction *instr) {
 
             byte = tmp & 0x3;
             // DEBUG('P', "Addr 0x%X\n",tmp-byte);
-            if (!ReadMem(tmp - byte, 4, &value)) return;
+            if (!ReadMem(tmp - byte, 4, &value)) return FALSE;
 
             // DEBUG('P', "Value 0x%X\n",value);
 #else
@@ -569,7 +615,7 @@ void Machine::OneInstruction(Instruction *instr) {
             // fail (I think) if the other cases are ever exercised.
             ASSERT((tmp & 0x3) == 0);
 
-            if (!ReadMem((tmp & ~0x3), 4, &value)) return;
+            if (!ReadMem((tmp & ~0x3), 4, &value)) return FALSE;
 #endif
 
 #ifdef SIM_FIX
@@ -595,23 +641,23 @@ void Machine::OneInstruction(Instruction *instr) {
                     break;
             }
 #ifndef SIM_FIX
-            if (!WriteMem((tmp & ~0x3), 4, value)) return;
+            if (!WriteMem((tmp & ~0x3), 4, value)) return FALSE;
 #else
             // DEBUG('P', "Value 0x%X\n",value);
 
-            if (!WriteMem((tmp - byte), 4, value)) return;
+            if (!WriteMem((tmp - byte), 4, value)) return FALSE;
 #endif  // SIM_FIX
             break;
 
         case OP_SWR:
-            tmp = registers[instr->rs] + instr->extra;
+            tmp = WordAdd(registers[instr->rs], instr->extra);
 
 #ifndef SIM_FIX
             // The little endian/big endian swap code would
             // fail (I think) if the other cases are ever exercised.
             ASSERT((tmp & 0x3) == 0);
 
-            if (!ReadMem((tmp & ~0x3), 4, &value)) return;
+            if (!ReadMem((tmp & ~0x3), 4, &value)) return FALSE;
 #else
             // The only difference between this code and the BIG ENDIAN code
             // is that the ReadMem call is guaranteed an aligned access as
@@ -623,7 +669,7 @@ void Machine::OneInstruction(Instruction *instr) {
             byte = tmp & 0x3;
             // DEBUG('P', "Addr 0x%X\n",tmp-byte);
 
-            if (!ReadMem(tmp - byte, 4, &value)) return;
+            if (!ReadMem(tmp - byte, 4, &value)) return FALSE;
             // DEBUG('P', "Value 0x%X\n",value);
 #endif  // SIM_FIX
 
@@ -634,13 +680,16 @@ void Machine::OneInstruction(Instruction *instr) {
 #endif  // SIM_FIX
             {
                 case 0:
-                    value = (value & 0xffffff) | (registers[instr->rt] << 24);
+                    value = (value & 0xffffff) |
+                            WordShiftLeft(registers[instr->rt], 24);
                     break;
                 case 1:
-                    value = (value & 0xffff) | (registers[instr->rt] << 16);
+                    value = (value & 0xffff) |
+                            WordShiftLeft(registers[instr->rt], 16);
                     break;
                 case 2:
-                    value = (value & 0xff) | (registers[instr->rt] << 8);
+                    value = (value & 0xff) |
+                            WordShiftLeft(registers[instr->rt], 8);
                     break;
                 case 3:
                     value = registers[instr->rt];
@@ -648,11 +697,11 @@ void Machine::OneInstruction(Instruction *instr) {
             }
 
 #ifndef SIM_FIX
-            if (!WriteMem((tmp & ~0x3), 4, value)) return;
+            if (!WriteMem((tmp & ~0x3), 4, value)) return FALSE;
 #else
             // DEBUG('P', "Value 0x%X\n",value);
 
-            if (!WriteMem((tmp - byte), 4, value)) return;
+            if (!WriteMem((tmp - byte), 4, value)) return FALSE;
 #endif  // SIM_FIX
 
             break;
@@ -663,7 +712,7 @@ void Machine::OneInstruction(Instruction *instr) {
                   "RaiseException(SyscallException, 0), "
                       << kernel->stats->totalTicks);
             RaiseException(SyscallException, 0);
-            return;
+            return FALSE;
 
         case OP_XOR:
             registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
@@ -677,7 +726,7 @@ void Machine::OneInstruction(Instruction *instr) {
         case OP_RES:
         case OP_UNIMP:
             RaiseException(IllegalInstrException, 0);
-            return;
+            return FALSE;
 
         default:
             ASSERT(FALSE);
@@ -693,8 +742,67 @@ void Machine::OneInstruction(Instruction *instr) {
                                               // are jumping into lala-land
     registers[PCReg] = registers[NextPCReg];
     registers[NextPCReg] = pcAfter;
+    return TRUE;
 }
 
+//----------------------------------------------------------------------
+// Machine::FetchInstruction
+// 	Fetch and decode the instruction at the PC.  Returns NULL, after
+//	raising the exception, if the PC can't be translated.
+//
+//	Decoded instructions are cached by physical address, one entry
+//	per word of main memory.  Each entry keeps the raw word it was
+//	decoded from, and is only used if that still equals the word in
+//	memory.  So there is nothing to invalidate explicitly: a store by
+//	the user program, the kernel loading a new program into a reused
+//	frame, or a page table change that maps the PC somewhere else all
+//	just make the next fetch miss.  Delayed loads and the SIM_FIX
+//	partial-word code are untouched, since only decoding is cached.
+//----------------------------------------------------------------------
+
+Instruction *Machine::FetchInstruction() {
+    ExceptionType exception;
+    int physicalAddress;
+    unsigned int raw;
+    Instruction *instr;
+
+    exception = Translate(registers[PCReg], &physicalAddress, 4, FALSE);
+    if (exception != NoException) {
+        RaiseException(exception, registers[PCReg]);
+        return NULL;
+    }
+    if (icache != NULL) CacheAccess(icache, physicalAddress, FALSE);
+    memcpy(&raw, &mainMemory[physicalAddress], 4);
+    raw = WordToHost(raw);
+
+    instr = &decodeCache[physicalAddress / 4];
+    if (instr->value == raw) {
+        kernel->stats->numDecodeHits++;
+    } else {
+        instr->value = raw;
+        instr->Decode();
+        kernel->stats->numDecodeMisses++;
+    }
+    return instr;
+}
+
+//----------------------------------------------------------------------
+// Machine::InitDecodeCache, Machine::FreeDecodeCache
+// 	Allocate the decode cache and decode every entry from a zero word,
+//	matching the zeroed main memory, so that an entry's fields always
+//	agree with its "value".
+//----------------------------------------------------------------------
+
+void Machine::InitDecodeCache() {
+    decodeCache = new Instruction[MemorySize / 4];
+    for (int i = 0; i < MemorySize / 4; i++) {
+        decodeCache[i].value = 0;
+        decodeCache[i].Decode();
+    }
+}
+
+void Machine::FreeDecodeCache() { delete[] decodeCache; }
+
 //----------------------------------------------------------------------
 // Machine::DelayedLoad
 // 	Simulate effects of a delayed load.
@@ -760,55 +868,14 @@ void Instruction::Decode() {
 //----------------------------------------------------------------------
 
 static void Mult(int a, int b, bool signedArith, int *hiPtr, int *loPtr) {
-    if ((a == 0) || (b == 0)) {
-        *hiPtr = *loPtr = 0;
-        return;
-    }
-
-    // Compute the sign of the result, then make everything positive
-    // so unsigned computation can be done in the main loop.
-    bool negative = FALSE;
-    if (signedArith) {
-        if (a < 0) {
-            negative = !negative;
-            a = -a;
-        }
-        if (b < 0) {
-            negative = !negative;
-            b = -b;
-        }
-    }
-
-    // Compute the result in unsigned arithmetic (check a's bits one at
-    // a time, and add in a shifted value of b).
-    unsigned int bLo = b;
-    unsigned int bHi = 0;
-    unsigned int lo = 0;
-    unsigned int hi = 0;
-    for (int i = 0; i < 32; i++) {
-        if (a & 1) {
-            lo += bLo;
-            if (lo < bLo)  // Carry out of the low bits?
-                hi += 1;
-            hi += bHi;
-            if ((a & 0xfffffffe) == 0) break;
-        }
-        bHi <<= 1;
-        if (bLo & 0x80000000) bHi |= 1;
+    unsigned long long product;
 
-        bLo <<= 1;
-        a >>= 1;
-    }
-
-    // If the result is supposed to be negative, compute the two's
-    // complement of the double-word result.
-    if (negative) {
-        hi = ~hi;
-        lo = ~lo;
-        lo++;
-        if (lo == 0) hi++;
-    }
+    // The 64-bit product of two 32-bit numbers cannot overflow.
+    if (signedArith)
+        product = (unsigned long long)((long long)a * (long long)b);
+    else
+        product = (unsigned long long)(unsigned int)a * (unsigned int)b;
 
-    *hiPtr = (int)hi;
-    *loPtr = (int)lo;
+    *hiPtr = (int)(unsigned int)(product >> 32);
+    *loPtr = (int)(unsigned int)product;
 }
@@ -91,7 +91,35 @@
  * Miscellaneous definitions:
  */
 
-#define IndexToAddr(x) ((x) << 2)
+// MIPS arithmetic wraps around at 32 bits.  In C++, signed overflow and
+// shifting a negative number left are undefined, and an optimizing
+// compiler may assume they never happen; so the simulator does both on
+// unsigned ints, which do wrap, and converts the result back.
+#define WordAdd(a, b) ((int)((unsigned int)(a) + (unsigned int)(b)))
+#define WordSub(a, b) ((int)((unsigned int)(a) - (unsigned int)(b)))
+#define WordShiftLeft(x, n) ((int)((unsigned int)(x) << (n)))
+
+#define IndexToAddr(x) WordShiftLeft(x, 2)
+
+// The following class defines an instruction, represented in both
+// 	undecoded binary form
+//      decoded to identify
+//	    operation to do
+//	    registers to act on
+//	    any immediate operand value
+
+class Instruction {
+   public:
+    void Decode();  // decode the binary representation of the instruction
+
+    unsigned int value;  // binary representation of the instruction
+
+    char opCode;      // Type of instruction.  This is NOT the same as the
+                      // opcode field from the instruction: see defs in mips.h
+    char rs, rt, rd;  // Three registers from instruction.
+    int extra;        // Immediate or target or shamt field or offset.
+                      // Immediates are sign-extended.
+};
 
 #define SIGN_BIT 0x80000000
 #define R31 31
@@ -11,6 +11,7 @@
 #include "network.h"
 
 #include "copyright.h"
+#include "intlog.h"
 #include "main.h"
 
 //-----------------------------------------------------------------------
@@ -25,6 +26,7 @@ NetworkInput::NetworkInput(CallBackObj *toCall) {
     callWhenAvail = toCall;
     packetAvail = FALSE;
     inHdr.length = 0;
+    kernel->interrupt->Register(this, NetworkRecvInt);
 
     sock = OpenSocket();
     sprintf(sockName, "SOCKET_%d", kernel->hostName);
@@ -54,20 +56,38 @@ NetworkInput::~NetworkInput() {
 //      First check to make sure packet is available & there's space to
 //	pull it in.  Then invoke the "callBack" registered by whoever
 //	wants the packet.
+//
+//	With -record, whether a packet was found, and the packet, are
+//	logged; with -replay, they are taken from the log instead, and
+//	the socket is not looked at.
 //-----------------------------------------------------------------------
 
 void NetworkInput::CallBack() {
+    InterruptLog *log = kernel->interruptLog;
+    bool found;
+
     // schedule the next time to poll for a packet
     kernel->interrupt->Schedule(this, NetworkTime, NetworkRecvInt);
 
     if (inHdr.length != 0)  // do nothing if packet is already buffered
         return;
-    if (!PollSocket(sock))  // do nothing if no packet to be read
+    if (log == NULL || log->IsRecording()) {
+        found = PollSocket(sock);
+    }
+    if (log != NULL) {
+        log->Bytes(&found, sizeof(bool));
+    }
+    if (!found)  // do nothing if no packet to be read
         return;
 
     // otherwise, read packet in
     char *buffer = new char[MaxWireSize];
-    ReadFromSocket(sock, buffer, MaxWireSize);
+    if (log == NULL || log->IsRecording()) {
+        ReadFromSocket(sock, buffer, MaxWireSize);
+    }
+    if (log != NULL) {
+        log->Bytes(buffer, MaxWireSize);
+    }
 
     // divide packet into header and data
     inHdr = *(PacketHeader *)buffer;
@@ -118,6 +138,7 @@ NetworkOutput::NetworkOutput(double reliability, CallBackObj *toCall) {
     callWhenDone = toCall;
     sendBusy = FALSE;
     sock = OpenSocket();
+    kernel->interrupt->Register(this, NetworkSendInt);
 }
 
 //-----------------------------------------------------------------------
@@ -137,6 +158,7 @@ NetworkOutput::~NetworkOutput() {
 void NetworkOutput::CallBack() {
     sendBusy = FALSE;
     kernel->stats->numPacketsSent++;
+    kernel->stats->network.Finished();
     callWhenDone->CallBack();
 }
 
@@ -159,6 +181,7 @@ void NetworkOutput::Send(PacketHeader hdr, char *data) {
            (hdr.length <= MaxPacketSize) && (hdr.from == kernel->hostName));
     DEBUG(dbgNet, "Sending to addr " << hdr.to << ", length " << hdr.length);
 
+    kernel->stats->network.Started();
     kernel->interrupt->Schedule(this, NetworkTime, NetworkSendInt);
 
     if (RandomNumber() % 100 >= chanceToWork * 100) {  // emulate a lost packet
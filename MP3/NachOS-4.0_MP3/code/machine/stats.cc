@@ -7,10 +7,88 @@
 // All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
+#include <sstream>  // first, as utility.h #defines min and max
+
 #include "stats.h"
 
+#include "cache.h"
+#include "checkpoint.h"
 #include "copyright.h"
 #include "debug.h"
+#include "hostperf.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// ThreadStats::ThreadStats
+// 	Start keeping track of a thread that has just been created, and
+//	has not been put on the ready list yet.
+//----------------------------------------------------------------------
+
+ThreadStats::ThreadStats(char *threadName, int threadID) {
+    name = threadName;
+    id = threadID;
+    userTicks = systemTicks = readyTicks = waitTicks = 0;
+    since = userStart = systemStart = 0;
+    instructions = instructionsStart = 0;
+    icacheMisses = dcacheMisses = 0;
+    blocked = finished = FALSE;
+}
+
+//----------------------------------------------------------------------
+// SyscallStats::SyscallStats, DeviceStats::DeviceStats
+// 	Initialize the counters to zero.
+//----------------------------------------------------------------------
+
+SyscallStats::SyscallStats() {
+    numCalls = numReturns = totalTicks = maxTicks = 0;
+    for (int i = 0; i < NumLatencyBuckets; i++) {
+        histogram[i] = 0;
+    }
+}
+
+DeviceStats::DeviceStats() {
+    numRequests = queueTicks = serviceTicks = startTime = 0;
+}
+
+//----------------------------------------------------------------------
+// SyscallStats::Returned
+// 	Count a return from the system call, and add its latency to
+//	the histogram.
+//----------------------------------------------------------------------
+
+void SyscallStats::Returned(int ticks) {
+    int bucket = 0;
+
+    numReturns++;
+    totalTicks += ticks;
+    if (ticks > maxTicks) {
+        maxTicks = ticks;
+    }
+    for (; ticks > 0 && bucket < NumLatencyBuckets - 1; ticks >>= 1) {
+        bucket++;
+    }
+    histogram[bucket]++;
+}
+
+//----------------------------------------------------------------------
+// DeviceStats::Queued, Started, Finished
+// 	Account for a device request: "Queued" when the request that
+//	was made at "when" gets hold of the device, "Started" when the
+//	device starts on it, "Finished" when the device interrupts.
+//----------------------------------------------------------------------
+
+void DeviceStats::Queued(int when) {
+    queueTicks += kernel->stats->totalTicks - when;
+}
+
+void DeviceStats::Started() {
+    numRequests++;
+    startTime = kernel->stats->totalTicks;
+}
+
+void DeviceStats::Finished() {
+    serviceTicks += kernel->stats->totalTicks - startTime;
+}
 
 //----------------------------------------------------------------------
 // Statistics::Statistics
@@ -19,9 +97,59 @@
 
 Statistics::Statistics() {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
+    numUserInstructions = 0;
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numTLBHits = numTLBMisses = numTLBFlushes = 0;
+    numDecodeHits = numDecodeMisses = numBlocksTranslated = 0;
+    numBlocksCompiled = 0;
+    hostStartTime = HostTime();
+    hostStartInstructions = 0;
+    hostPerf = NULL;
+    threads = new List<ThreadStats *>;
+    running = NULL;
+    jsonFileNo = -1;
+    jsonInterval = nextJsonTime = 0;
+}
+
+//----------------------------------------------------------------------
+// Statistics::~Statistics
+// 	De-allocate the thread records, and close the JSON file and the
+//	host's counters.
+//----------------------------------------------------------------------
+
+Statistics::~Statistics() {
+    while (!threads->IsEmpty()) {
+        delete threads->RemoveFront();
+    }
+    delete threads;
+    if (jsonFileNo >= 0) {
+        Close(jsonFileNo);
+    }
+    delete hostPerf;
+}
+
+//----------------------------------------------------------------------
+// Cpi
+// 	Return the cycles (user ticks) per instruction, or 0 if no
+//	instructions have been executed.
+//----------------------------------------------------------------------
+
+static double
+Cpi(int ticks, int instructions) {
+    return instructions > 0 ? (double)ticks / instructions : 0.0;
+}
+
+//----------------------------------------------------------------------
+// Utilization
+// 	Return "busy" as a percentage of "total" ticks, or 0 if no time
+//	has passed.
+//----------------------------------------------------------------------
+
+static double
+Utilization(int busy, int total) {
+    return total > 0 ? 100.0 * busy / total : 0.0;
 }
 
 //----------------------------------------------------------------------
@@ -31,6 +159,8 @@ Statistics::Statistics() {
 //----------------------------------------------------------------------
 
 void Statistics::Print() {
+    Machine *machine = kernel->machine;
+
     cout << "Ticks: total " << totalTicks << ", idle " << idleTicks;
     cout << ", system " << systemTicks << ", user " << userTicks << "\n";
     cout << "Disk I/O: reads " << numDiskReads;
@@ -38,6 +168,459 @@ void Statistics::Print() {
     cout << "Console I/O: reads " << numConsoleCharsRead;
     cout << ", writes " << numConsoleCharsWritten << "\n";
     cout << "Paging: faults " << numPageFaults << "\n";
+    if (numTLBHits + numTLBMisses > 0) {
+        cout << "TLB: hits " << numTLBHits << ", misses " << numTLBMisses;
+        cout << " (" << 100.0 * numTLBHits / (numTLBHits + numTLBMisses)
+             << "% hit), flushes " << numTLBFlushes << "\n";
+    }
+    if (machine->icache != NULL) machine->icache->Print();
+    if (machine->dcache != NULL) machine->dcache->Print();
+    if (machine->icache != NULL || machine->dcache != NULL) {
+        ListIterator<ThreadStats *> iter(threads);
+
+        for (; !iter.IsDone(); iter.Next()) {
+            ThreadStats *thread = iter.Item();
+
+            cout << "Cache misses, thread " << thread->name << " ("
+                 << thread->id << "): instruction " << thread->icacheMisses
+                 << ", data " << thread->dcacheMisses << "\n";
+        }
+    }
+    if (machine->costModel != NULL || machine->icache != NULL ||
+        machine->dcache != NULL) {
+        ListIterator<ThreadStats *> iter(threads);
+
+        cout << "User instructions: " << numUserInstructions << " (CPI "
+             << Cpi(userTicks, numUserInstructions) << ")\n";
+        for (; !iter.IsDone(); iter.Next()) {
+            ThreadStats *thread = iter.Item();
+            int user = thread->userTicks, instructions = thread->instructions;
+
+            if (thread == running) {
+                user += userTicks - thread->userStart;
+                instructions += numUserInstructions - thread->instructionsStart;
+            }
+            cout << "User instructions, thread " << thread->name << " ("
+                 << thread->id << "): " << instructions << " (CPI "
+                 << Cpi(user, instructions) << ")\n";
+        }
+    }
+    if (kernel->numCpus > 1) {
+        for (int i = 0; i < kernel->numCpus; i++) {
+            Cpu *cpu = kernel->cpus[i];
+
+            cout << "CPU " << i << ": busy " << cpu->busyTicks << " ticks ("
+                 << Utilization(cpu->busyTicks, totalTicks)
+                 << "%), threads run " << cpu->dispatches << ", migrations "
+                 << cpu->migrations << "\n";
+        }
+    }
     cout << "Network I/O: packets received " << numPacketsRecvd;
     cout << ", sent " << numPacketsSent << "\n";
 }
+
+//----------------------------------------------------------------------
+// Statistics::PrintSimulator
+// 	Print how well the decoded-instruction cache worked and how many
+//	user instructions the host simulated per second, and with
+//	-hostperf, what the host's counters counted for each.  This goes
+//	to stderr, independent of the debug flags, so that it never
+//	changes the output a test compares against.
+//----------------------------------------------------------------------
+
+void Statistics::PrintSimulator() {
+    double fetches = (double)numDecodeHits + numDecodeMisses;
+    double elapsed = HostTime() - hostStartTime;
+
+    cerr << "Simulator: decode cache hits " << numDecodeHits;
+    cerr << ", misses " << numDecodeMisses;
+    cerr << " (" << (fetches > 0 ? 100.0 * numDecodeHits / fetches : 0.0)
+         << "% hit)";
+    cerr << ", blocks translated " << numBlocksTranslated;
+    cerr << ", compiled " << numBlocksCompiled;
+    cerr << ", host "
+         << (elapsed > 0 ? (numUserInstructions - hostStartInstructions) /
+                               elapsed
+                         : 0.0)
+         << " instructions/sec\n";
+    if (hostPerf != NULL) {
+        hostPerf->Print(numUserInstructions - hostStartInstructions);
+    }
+}
+
+//----------------------------------------------------------------------
+// Statistics::NewThread
+// 	Start keeping track of a newly created thread.  Returns its
+//	record, which the thread keeps so that the scheduler can update it.
+//----------------------------------------------------------------------
+
+ThreadStats *Statistics::NewThread(char *name, int id) {
+    ThreadStats *thread = new ThreadStats(name, id);
+
+    threads->Append(thread);
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// Statistics::FindThread
+// 	Return the record of the thread numbered "id" that has not
+//	finished yet (there may be others with the same number, that
+//	have), or NULL if there is none.
+//----------------------------------------------------------------------
+
+ThreadStats *Statistics::FindThread(int id) {
+    ListIterator<ThreadStats *> iterator(threads);
+
+    for (; !iterator.IsDone(); iterator.Next()) {
+        if (iterator.Item()->id == id && !iterator.Item()->finished) {
+            return iterator.Item();
+        }
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// Statistics::Checkpoint
+// 	Write out the statistics, including the record of every thread
+//	that ever ran, or read them back in, in place of those collected
+//	so far.  The threads then find their records with FindThread.
+//----------------------------------------------------------------------
+
+void Statistics::Checkpoint(CheckpointFile *file) {
+    int numThreads = threads->NumInList();
+    int runningIndex = -1;
+
+    file->Int(&totalTicks);
+    file->Int(&idleTicks);
+    file->Int(&systemTicks);
+    file->Int(&userTicks);
+    file->Int(&numUserInstructions);
+    file->Int(&numDiskReads);
+    file->Int(&numDiskWrites);
+    file->Int(&numConsoleCharsRead);
+    file->Int(&numConsoleCharsWritten);
+    file->Int(&numPageFaults);
+    file->Int(&numTLBHits);
+    file->Int(&numTLBMisses);
+    file->Int(&numTLBFlushes);
+    file->Int(&numPacketsSent);
+    file->Int(&numPacketsRecvd);
+    file->Bytes(syscalls, sizeof(syscalls));
+    file->Bytes(&disk, sizeof(disk));
+    file->Bytes(&console, sizeof(console));
+    file->Bytes(&network, sizeof(network));
+    if (!file->IsWriting()) {
+        hostStartInstructions = numUserInstructions;
+    }
+
+    file->Int(&numThreads);
+    if (file->IsWriting()) {
+        ListIterator<ThreadStats *> iterator(threads);
+
+        for (int i = 0; !iterator.IsDone(); iterator.Next(), i++) {
+            if (iterator.Item() == running) {
+                runningIndex = i;
+            }
+        }
+    } else {
+        while (!threads->IsEmpty()) {
+            delete threads->RemoveFront();
+        }
+        for (int i = 0; i < numThreads; i++) {
+            threads->Append(new ThreadStats(NULL, 0));
+        }
+    }
+    file->Int(&runningIndex);
+
+    ListIterator<ThreadStats *> iterator(threads);
+
+    running = NULL;
+    for (int i = 0; !iterator.IsDone(); iterator.Next(), i++) {
+        ThreadStats *thread = iterator.Item();
+
+        file->String(&thread->name);
+        file->Int(&thread->id);
+        file->Int(&thread->userTicks);
+        file->Int(&thread->systemTicks);
+        file->Int(&thread->readyTicks);
+        file->Int(&thread->waitTicks);
+        file->Int(&thread->since);
+        file->Bool(&thread->blocked);
+        file->Bool(&thread->finished);
+        file->Int(&thread->userStart);
+        file->Int(&thread->systemStart);
+        file->Int(&thread->instructions);
+        file->Int(&thread->instructionsStart);
+        file->Int(&thread->icacheMisses);
+        file->Int(&thread->dcacheMisses);
+        if (i == runningIndex) {
+            running = thread;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// Statistics::ThreadReady
+// 	A thread is being put on the ready list.  If it was blocked,
+//	charge it for the time it waited.
+//----------------------------------------------------------------------
+
+void Statistics::ThreadReady(ThreadStats *thread, bool wasBlocked) {
+    if (wasBlocked) {
+        thread->waitTicks += totalTicks - thread->since;
+    }
+    thread->since = totalTicks;
+    thread->blocked = FALSE;
+}
+
+//----------------------------------------------------------------------
+// Statistics::ThreadBlocked
+// 	The running thread is going to sleep, or if "finishing", is done.
+//----------------------------------------------------------------------
+
+void Statistics::ThreadBlocked(ThreadStats *thread, bool finishing) {
+    thread->since = totalTicks;
+    thread->blocked = TRUE;
+    thread->finished = finishing;
+}
+
+//----------------------------------------------------------------------
+// Statistics::SwitchThread
+// 	The CPU is being switched to "next".  Charge the thread that has
+//	been running with the user and system time since it was switched
+//	to, and "next" with the time it spent on the ready list.
+//----------------------------------------------------------------------
+
+void Statistics::SwitchThread(ThreadStats *next) {
+    next->readyTicks += totalTicks - next->since;
+    ResumeThread(next);
+}
+
+//----------------------------------------------------------------------
+// Statistics::ResumeThread
+// 	With -smp, the host is being switched to "next", which has been
+//	running all along on another CPU: charge the thread that has been
+//	running as SwitchThread does, but "next" was never ready.
+//----------------------------------------------------------------------
+
+void Statistics::ResumeThread(ThreadStats *next) {
+    if (running != NULL) {
+        running->userTicks += userTicks - running->userStart;
+        running->systemTicks += systemTicks - running->systemStart;
+        running->instructions +=
+            numUserInstructions - running->instructionsStart;
+    }
+    next->userStart = userTicks;
+    next->systemStart = systemTicks;
+    next->instructionsStart = numUserInstructions;
+    running = next;
+}
+
+//----------------------------------------------------------------------
+// Statistics::SyscallEntered, SyscallReturned
+// 	Count a trap into the kernel for system call "code", and its
+//	return to user code "ticks" later.  Codes too big to keep track
+//	of are ignored.
+//----------------------------------------------------------------------
+
+void Statistics::SyscallEntered(int code) {
+    if (code >= 0 && code < MaxSyscallStats) {
+        syscalls[code].numCalls++;
+    }
+}
+
+void Statistics::SyscallReturned(int code, int ticks) {
+    if (code >= 0 && code < MaxSyscallStats) {
+        syscalls[code].Returned(ticks);
+    }
+}
+
+//----------------------------------------------------------------------
+// Statistics::OpenJson
+// 	Arrange for the statistics to be written to "fileName" in JSON,
+//	at Halt and, if "interval" is not 0, on the first timer interrupt
+//	after every "interval" ticks.  The file has one JSON object per
+//	line, one for each snapshot; the last has "final": true.
+//----------------------------------------------------------------------
+
+void Statistics::OpenJson(char *fileName, int interval) {
+    jsonFileNo = OpenForWrite(fileName);
+    ASSERT(jsonFileNo >= 0);
+    jsonInterval = interval;
+    nextJsonTime = totalTicks + interval;
+}
+
+//----------------------------------------------------------------------
+// JsonString
+// 	Write "str" to "out" as a JSON string.
+//----------------------------------------------------------------------
+
+static void
+JsonString(ostream &out, char *str) {
+    out << '"';
+    for (; *str != '\0'; str++) {
+        if (*str == '"' || *str == '\\') {
+            out << '\\' << *str;
+        } else if ((unsigned char)*str < ' ') {
+            out << ' ';
+        } else {
+            out << *str;
+        }
+    }
+    out << '"';
+}
+
+//----------------------------------------------------------------------
+// JsonDevice
+// 	Write the statistics for one device to "out", as the members
+//	of a JSON object (without the braces).
+//----------------------------------------------------------------------
+
+static void
+JsonDevice(ostream &out, DeviceStats *device) {
+    out << "\"requests\": " << device->numRequests;
+    out << ", \"queueTicks\": " << device->queueTicks;
+    out << ", \"serviceTicks\": " << device->serviceTicks;
+}
+
+//----------------------------------------------------------------------
+// JsonCache
+// 	Write the statistics for a cache to "out", as a member "name" of
+//	the enclosing JSON object (with a leading comma), if there is one.
+//----------------------------------------------------------------------
+
+static void
+JsonCache(ostream &out, char *name, Cache *cache) {
+    if (cache == NULL) {
+        return;
+    }
+    out << ", \"" << name << "\": {\"hits\": " << cache->numHits
+        << ", \"misses\": " << cache->numMisses
+        << ", \"writebacks\": " << cache->numWritebacks << "}";
+}
+
+//----------------------------------------------------------------------
+// Statistics::WriteJson
+// 	Write a snapshot of the statistics to the JSON file, as one line.
+//	The times of the running thread, and of those that are ready or
+//	blocked, include the time since they were last charged.
+//
+//	"final" is TRUE for the snapshot written at Halt.
+//----------------------------------------------------------------------
+
+void Statistics::WriteJson(bool final) {
+    ostringstream out;
+    ListIterator<ThreadStats *> iter(threads);
+    bool first = TRUE;
+    int i, j;
+
+    if (jsonFileNo < 0) {
+        return;
+    }
+    while (nextJsonTime <= totalTicks && jsonInterval > 0) {
+        nextJsonTime += jsonInterval;
+    }
+
+    out << "{\"time\": " << totalTicks << ", \"final\": "
+        << (final ? "true" : "false");
+    out << ", \"ticks\": {\"total\": " << totalTicks
+        << ", \"idle\": " << idleTicks << ", \"system\": " << systemTicks
+        << ", \"user\": " << userTicks << "}";
+    out << ", \"instructions\": " << numUserInstructions
+        << ", \"cpi\": " << Cpi(userTicks, numUserInstructions);
+
+    out << ", \"threads\": [";
+    for (; !iter.IsDone(); iter.Next()) {
+        ThreadStats *thread = iter.Item();
+        int user = thread->userTicks, system = thread->systemTicks;
+        int ready = thread->readyTicks, wait = thread->waitTicks;
+        int instructions = thread->instructions;
+        char *state;
+
+        if (thread == running) {
+            user += userTicks - thread->userStart;
+            system += systemTicks - thread->systemStart;
+            instructions += numUserInstructions - thread->instructionsStart;
+            state = "running";
+        } else if (thread->finished) {
+            state = "finished";
+        } else if (thread->blocked) {
+            wait += totalTicks - thread->since;
+            state = "blocked";
+        } else {
+            ready += totalTicks - thread->since;
+            state = "ready";
+        }
+        out << (first ? "" : ", ") << "{\"id\": " << thread->id
+            << ", \"name\": ";
+        JsonString(out, thread->name);
+        out << ", \"state\": \"" << state << "\", \"user\": " << user
+            << ", \"system\": " << system << ", \"ready\": " << ready
+            << ", \"wait\": " << wait << ", \"instructions\": " << instructions
+            << ", \"cpi\": " << Cpi(user, instructions)
+            << ", \"icacheMisses\": " << thread->icacheMisses
+            << ", \"dcacheMisses\": " << thread->dcacheMisses << "}";
+        first = FALSE;
+    }
+    out << "]";
+
+    if (kernel->numCpus > 1) {
+        out << ", \"cpus\": [";
+        for (i = 0; i < kernel->numCpus; i++) {
+            Cpu *cpu = kernel->cpus[i];
+
+            out << (i == 0 ? "" : ", ") << "{\"id\": " << i
+                << ", \"busy\": " << cpu->busyTicks << ", \"utilization\": "
+                << Utilization(cpu->busyTicks, totalTicks)
+                << ", \"dispatches\": " << cpu->dispatches
+                << ", \"migrations\": " << cpu->migrations << "}";
+        }
+        out << "]";
+    }
+
+    out << ", \"syscalls\": [";
+    first = TRUE;
+    for (i = 0; i < MaxSyscallStats; i++) {
+        SyscallStats *call = &syscalls[i];
+
+        if (call->numCalls == 0) {
+            continue;
+        }
+        out << (first ? "" : ", ") << "{\"code\": " << i
+            << ", \"calls\": " << call->numCalls
+            << ", \"returns\": " << call->numReturns
+            << ", \"totalTicks\": " << call->totalTicks
+            << ", \"maxTicks\": " << call->maxTicks << ", \"histogram\": [";
+        for (j = 0; j < NumLatencyBuckets; j++) {
+            out << (j == 0 ? "" : ", ") << call->histogram[j];
+        }
+        out << "]}";
+        first = FALSE;
+    }
+    out << "]";
+
+    out << ", \"devices\": {\"disk\": {";
+    JsonDevice(out, &disk);
+    out << ", \"reads\": " << numDiskReads << ", \"writes\": " << numDiskWrites;
+    out << "}, \"console\": {";
+    JsonDevice(out, &console);
+    out << ", \"charsRead\": " << numConsoleCharsRead
+        << ", \"charsWritten\": " << numConsoleCharsWritten;
+    out << "}, \"network\": {";
+    JsonDevice(out, &network);
+    out << ", \"packetsSent\": " << numPacketsSent
+        << ", \"packetsReceived\": " << numPacketsRecvd << "}}";
+
+    out << ", \"paging\": {\"faults\": " << numPageFaults << "}";
+    out << ", \"tlb\": {\"hits\": " << numTLBHits
+        << ", \"misses\": " << numTLBMisses
+        << ", \"flushes\": " << numTLBFlushes << "}";
+    JsonCache(out, "icache", kernel->machine->icache);
+    JsonCache(out, "dcache", kernel->machine->dcache);
+    out << ", \"simulator\": {\"decodeHits\": " << numDecodeHits
+        << ", \"decodeMisses\": " << numDecodeMisses
+        << ", \"blocksTranslated\": " << numBlocksTranslated
+        << ", \"blocksCompiled\": " << numBlocksCompiled << "}}\n";
+
+    WriteFile(jsonFileNo, (char *)out.str().c_str(), out.str().length());
+}
@@ -12,6 +12,84 @@
 #define STATS_H
 
 #include "copyright.h"
+#include "list.h"
+
+class CheckpointFile;
+class HostPerf;
+
+// Time a thread has spent in each state, kept up to date by the
+// scheduler through Statistics::ThreadReady, ThreadBlocked and
+// SwitchThread.  The records outlive their threads, so that the
+// final statistics cover every thread that ever ran.
+
+class ThreadStats {
+   public:
+    ThreadStats(char *threadName, int threadID);
+
+    char *name;       // the thread's name and ID
+    int id;
+    int userTicks;    // time running user code
+    int systemTicks;  // time running in the kernel
+    int readyTicks;   // time on the ready list
+    int waitTicks;    // time blocked
+
+    int since;        // when it last became ready or blocked
+    bool blocked;     // TRUE if it is blocked now
+    bool finished;    // TRUE once it has called Finish
+    int userStart;    // Statistics::userTicks and systemTicks when
+    int systemStart;  // the thread was last switched to
+
+    int instructions;       // user instructions executed
+    int instructionsStart;  // Statistics::numUserInstructions when
+                            // the thread was last switched to
+
+    int icacheMisses;  // misses in the simulated caches, while the
+    int dcacheMisses;  // thread was running (see machine/cache.h)
+};
+
+// Latency histograms have a bucket for each power of two: bucket i
+// counts latencies of 2^(i-1) up to 2^i - 1 ticks, and bucket 0 the
+// latencies of 0.  The last bucket also takes everything longer.
+
+const int NumLatencyBuckets = 20;
+
+// Calls to each system call, and how long they took (from the trap
+// to the return to user code).  Calls that never return (Exit, Halt)
+// are counted, but have no latency.
+
+const int MaxSyscallStats = 128;  // system call codes counted
+
+class SyscallStats {
+   public:
+    SyscallStats();  // initialize everything to zero
+
+    int numCalls;     // traps into the kernel
+    int numReturns;   // returns from the kernel back to user code
+    int totalTicks;   // time taken by all of the returns
+    int maxTicks;     // by the slowest one
+    int histogram[NumLatencyBuckets];
+
+    void Returned(int ticks);  // a call has returned after "ticks"
+};
+
+// Requests served by a device.  The queue delay is the time a request
+// waited for the device to be free (the synchronous interface's lock);
+// the service time runs from the device starting on the request to
+// its completion interrupt.
+
+class DeviceStats {
+   public:
+    DeviceStats();  // initialize everything to zero
+
+    int numRequests;   // requests started
+    int queueTicks;    // total time requests waited to be started
+    int serviceTicks;  // total time taken to serve them
+    int startTime;     // when the current request was started
+
+    void Queued(int when);  // a request queued at "when" is next
+    void Started();         // the device starts on a request
+    void Finished();        // and interrupts when it is done
+};
 
 // The following class defines the statistics that are to be kept
 // about Nachos behavior -- how much time (ticks) elapsed, how
@@ -26,19 +104,82 @@ class Statistics {
     int systemTicks;  // Time spent executing system code
     int userTicks;    // Time spent executing user code
                       // (this is also equal to # of
-                      // user instructions executed)
+                      // user instructions executed, unless
+                      // caches or a cost model are simulated)
+    int numUserInstructions;  // user instructions executed (including
+                              // those retried after an exception)
 
     int numDiskReads;            // number of disk read requests
     int numDiskWrites;           // number of disk write requests
     int numConsoleCharsRead;     // number of characters read from the keyboard
     int numConsoleCharsWritten;  // number of characters written to the display
     int numPageFaults;           // number of virtual memory page faults
+    int numTLBHits;              // translations found in the TLB
+    int numTLBMisses;            // translations not found (TLB faults)
+    int numTLBFlushes;           // times the kernel flushed the TLB
     int numPacketsSent;          // number of packets sent over the network
     int numPacketsRecvd;         // number of packets received over the network
 
-    Statistics();  // initialize everything to zero
+    int numDecodeHits;        // instruction fetches found in the decode cache
+    int numDecodeMisses;      // instruction fetches that had to be decoded
+    int numBlocksTranslated;  // basic blocks translated by the block engine
+    int numBlocksCompiled;    // and compiled to host code by the JIT
+    double hostStartTime;     // host wall-clock time when Nachos started
+    int hostStartInstructions;  // numUserInstructions then (not 0, if
+                                // restored from a checkpoint)
+    HostPerf *hostPerf;         // the host's counters (-hostperf), or NULL
+
+    List<ThreadStats *> *threads;            // every thread created
+    ThreadStats *running;                    // the one running now
+    SyscallStats syscalls[MaxSyscallStats];  // indexed by system call code
+    DeviceStats disk;                        // disk reads and writes
+    DeviceStats console;                     // characters displayed
+    DeviceStats network;                     // packets sent
+
+    Statistics();   // initialize everything to zero
+    ~Statistics();  // close the JSON file, if any
+
+    void Print();           // print collected statistics
+    void PrintSimulator();  // print decode cache and host speed, and
+                            // the host's counters, on stderr
+
+    ThreadStats *NewThread(char *name, int id);  // start keeping track
+                                                 // of a new thread
+    ThreadStats *FindThread(int id);  // the record of thread "id", if it
+                                      // has not finished
+    void ThreadReady(ThreadStats *thread, bool wasBlocked);
+    // "thread" is put on the ready list,
+    // having been blocked if "wasBlocked"
+    void ThreadBlocked(ThreadStats *thread, bool finishing);
+    // "thread" goes to sleep, for good if
+    // "finishing"
+    void SwitchThread(ThreadStats *next);  // "next" starts running
+    void ResumeThread(ThreadStats *next);  // "next" goes on running,
+                                           // on another CPU (-smp)
+
+    void SyscallEntered(int code);              // a system call trapped in
+    void SyscallReturned(int code, int ticks);  // and returned after "ticks"
+
+    void OpenJson(char *fileName, int interval);
+    // write the statistics to "fileName" at
+    // Halt, and every "interval" ticks (if
+    // not 0) until then
+    void CheckJson() {
+        if (jsonFileNo >= 0 && jsonInterval > 0 && totalTicks >= nextJsonTime) {
+            WriteJson(FALSE);
+        }
+    }
+    // called on each timer interrupt
+    void WriteJson(bool final);  // write out one snapshot
+
+    void Checkpoint(CheckpointFile *file);
+    // write out, or read in, everything but
+    // the host time and the JSON file
 
-    void Print();  // print collected statistics
+   private:
+    int jsonFileNo;    // where to write the JSON snapshots, or -1
+    int jsonInterval;  // ticks between snapshots, or 0 for just at Halt
+    int nextJsonTime;  // when the next one is due
 };
 
 // Constants used to reflect the relative time an operation would
@@ -40,6 +40,7 @@ Timer::Timer(bool doRandom, CallBackObj *toCall) {
     randomize = doRandom;
     callPeriodically = toCall;
     disable = FALSE;
+    kernel->interrupt->Register(this, TimerInt);
     SetInterrupt();
 }
 
@@ -0,0 +1,127 @@
+// trace.cc
+//	Routines to log trace records of the machine emulation, and to
+//	print them as text.
+//
+//	Making a record only copies a few integers into a buffer; all
+//	the formatting is left to Print, which runs either right away
+//	(when there is no trace file) or much later, from -tracedump.
+//	The trace file is just the records, in host byte order.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "trace.h"
+
+#include "copyright.h"
+#include "interrupt.h"
+#include "mipssim.h"
+#include "sysdep.h"
+
+//----------------------------------------------------------------------
+// Trace::Trace
+// 	Initialize the trace.
+//
+//	"fileName" -- the file to write records to, or NULL to print
+//		each record as text as soon as it is made
+//----------------------------------------------------------------------
+
+Trace::Trace(char *fileName) {
+    if (fileName == NULL) {
+        fileNo = -1;
+        buffer = new TraceRecord[1];
+    } else {
+        fileNo = OpenForWrite(fileName);
+        ASSERT(fileNo >= 0);
+        buffer = new TraceRecord[TraceBufferSize];
+    }
+    numBuffered = 0;
+}
+
+//----------------------------------------------------------------------
+// Trace::~Trace
+// 	Write out the records still in the buffer, and close the file.
+//----------------------------------------------------------------------
+
+Trace::~Trace() {
+    Flush();
+    if (fileNo >= 0) Close(fileNo);
+    delete[] buffer;
+}
+
+//----------------------------------------------------------------------
+// Trace::Flush
+// 	Write the buffered records to the trace file in one go, or print
+//	them if there is no file.
+//----------------------------------------------------------------------
+
+void Trace::Flush() {
+    if (fileNo < 0) {
+        for (int i = 0; i < numBuffered; i++) {
+            Print(&buffer[i], TRUE);
+        }
+    } else if (numBuffered > 0) {
+        WriteFile(fileNo, (char *)buffer, numBuffered * sizeof(TraceRecord));
+    }
+    numBuffered = 0;
+}
+
+//----------------------------------------------------------------------
+// Trace::Print
+// 	Print a trace record exactly as the DEBUG message (or, for
+//	instructions, the "-d m" output) it stands for.
+//
+//	"record" -- the record to print
+//	"live" -- if TRUE, print it where the message would have gone:
+//		stdout for instructions, stderr for everything else
+//----------------------------------------------------------------------
+
+void Trace::Print(TraceRecord *record, bool live) {
+    ostream &out = (live && record->event != TraceInstruction) ? cerr : cout;
+    int *arg = record->arg;
+    char buf[80];
+
+    switch (record->event) {
+        case TraceInstruction:
+            ASSERT(arg[1] >= 0 && arg[1] <= MaxOpcode);
+            out << "At PC = " << arg[0];
+            sprintf(buf, opStrings[arg[1]].format, arg[2], arg[3], arg[4]);
+            out << "\t" << buf << "\n";
+            break;
+
+        case TraceTick:
+            out << "== Tick " << arg[0] << " ==\n";
+            break;
+
+        case TraceSchedule:
+            out << "Scheduling interrupt handler the " << intTypeNames[arg[0]]
+                << " at time = " << arg[1] << "\n";
+            break;
+
+        case TraceInterrupt:
+            out << "Invoking interrupt handler for the \n";
+            out << intTypeNames[arg[0]] << " at time " << arg[1] << "\n";
+            break;
+
+        default:
+            out << "Unknown trace event " << record->event << "\n";
+    }
+}
+
+//----------------------------------------------------------------------
+// Trace::Decode
+// 	Print every record in a trace file, in order, on stdout.
+//
+//	"fileName" -- the trace file, as written by "-trace"
+//----------------------------------------------------------------------
+
+void Trace::Decode(char *fileName) {
+    int fileNo = OpenForReadWrite(fileName, TRUE);
+    TraceRecord record;
+
+    while (ReadPartial(fileNo, (char *)&record, sizeof(record)) ==
+           sizeof(record)) {
+        Print(&record, FALSE);
+    }
+    Close(fileNo);
+}
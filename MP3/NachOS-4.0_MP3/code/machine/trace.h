@@ -0,0 +1,95 @@
+// trace.h
+//	Data structures for tracing the machine emulation cheaply.
+//
+//	The debugging messages that would be printed on every simulated
+//	instruction or tick (the "m" and "i" flags) are logged through
+//	TRACE as small binary records instead of being formatted on the
+//	spot.  By default each record is printed as soon as it is made,
+//	in the same text as before.  With "-trace <file>" the records
+//	are collected in a buffer and written to the file whenever it
+//	fills; "nachos -tracedump <file>" prints such a file as text.
+//
+//	If Nachos is compiled with -DNO_DEBUG, DEBUG_ENABLED is always
+//	FALSE, so TRACE (like DEBUG) compiles to nothing at all.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "copyright.h"
+#include "debug.h"
+
+// The events that can be traced, and their arguments.
+enum TraceEvent {
+    TraceInstruction,  // pc, opcode, and its three printed operands
+    TraceTick,         // the time
+    TraceSchedule,     // interrupt type, when it is due
+    TraceInterrupt     // interrupt type, when it was due
+};
+
+const int TraceArgs = 5;            // arguments in a record
+const int TraceBufferSize = 16384;  // records written to the file at once
+
+// One trace record, as written to the trace file.
+
+class TraceRecord {
+   public:
+    int event;            // a TraceEvent
+    int arg[TraceArgs];   // what happened; unused arguments are 0
+};
+
+// The following class collects trace records, and either prints
+// them right away or writes them to a trace file.
+
+class Trace {
+   public:
+    Trace(char *fileName);  // log to "fileName", or print each record
+                            // as text right away if it is NULL
+    ~Trace();               // write out anything still in the buffer
+
+    void Record(int event, int a0 = 0, int a1 = 0, int a2 = 0, int a3 = 0,
+                int a4 = 0) {
+        TraceRecord *record = &buffer[numBuffered++];
+        record->event = event;
+        record->arg[0] = a0;
+        record->arg[1] = a1;
+        record->arg[2] = a2;
+        record->arg[3] = a3;
+        record->arg[4] = a4;
+        if (numBuffered == TraceBufferSize || fileNo < 0) Flush();
+    }
+    // Log an event
+
+    void Flush();  // write out (or print) the buffered records
+
+    static void Print(TraceRecord *record, bool live);
+    // Print a record in the text of the DEBUG
+    // message it replaces; "live" sends it to
+    // the stream that message went to, rather
+    // than stdout
+
+    static void Decode(char *fileName);
+    // Print every record in a trace file
+
+   private:
+    int fileNo;            // the trace file, or -1 to print records
+    TraceRecord *buffer;   // records not yet written out
+    int numBuffered;       // how many
+};
+
+extern THREAD_LOCAL Trace *trace;
+
+//----------------------------------------------------------------------
+// TRACE
+//      If flag is enabled, log an event: TRACE(flag, event, args...).
+//----------------------------------------------------------------------
+#define TRACE(flag, ...)               \
+    if (!DEBUG_ENABLED(flag)) {        \
+    } else {                           \
+        trace->Record(__VA_ARGS__);    \
+    }
+
+#endif  // TRACE_H
@@ -13,6 +13,8 @@
 //	to find an entry with the same virtual page #.  If found,
 //	this entry is used for the translation.
 //	If not, it traps to software with an exception.
+//	The size, associativity and replacement policy of the TLB
+//	are chosen when it is enabled (see Machine::EnableTLB).
 //
 //	In practice, the TLB is much smaller than the amount of physical
 //	memory (16 entries is common on a machine that has 1000's of
@@ -30,6 +32,7 @@
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
+#include "hostperf.h"
 #include "main.h"
 
 // Routines for converting Words and Short Words to and from the
@@ -38,7 +41,7 @@
 
 unsigned int WordToHost(unsigned int word) {
 #ifdef HOST_IS_BIG_ENDIAN
-    register unsigned long result;
+    unsigned int result;
     result = (word >> 24) & 0x000000ff;
     result |= (word >> 8) & 0x0000ff00;
     result |= (word << 8) & 0x00ff0000;
@@ -51,7 +54,7 @@ unsigned int WordToHost(unsigned int word) {
 
 unsigned short ShortToHost(unsigned short shortword) {
 #ifdef HOST_IS_BIG_ENDIAN
-    register unsigned short result;
+    unsigned short result;
     result = (shortword << 8) & 0xff00;
     result |= (shortword >> 8) & 0x00ff;
     return result;
@@ -81,30 +84,42 @@ unsigned short ShortToMachine(unsigned short shortword) {
 
 bool Machine::ReadMem(int addr, int size, int *value) {
     int data;
+    unsigned short halfword;
+    unsigned int word;
     ExceptionType exception;
     int physicalAddress;
+    char *hostAddress;
 
     DEBUG(dbgAddr, "Reading VA " << addr << ", size " << size);
 
-    exception = Translate(addr, &physicalAddress, size, FALSE);
-    if (exception != NoException) {
-        RaiseException(exception, addr);
-        return FALSE;
+    hostAddress = SoftTranslate(addr, size, FALSE);
+    if (hostAddress == NULL) {
+        exception = Translate(addr, &physicalAddress, size, FALSE);
+        if (exception != NoException) {
+            RaiseException(exception, addr);
+            return FALSE;
+        }
+        hostAddress = &mainMemory[physicalAddress];
     }
+    if (dcache != NULL) CacheAccess(dcache, hostAddress - mainMemory, FALSE);
+
+    // Copy halfwords and words in and out of main memory, rather than
+    // go through short and int pointers: the optimizer may assume that
+    // those never refer to the same bytes, and reorder the accesses.
     switch (size) {
         case 1:
-            data = mainMemory[physicalAddress];
+            data = *hostAddress;
             *value = data;
             break;
 
         case 2:
-            data = *(unsigned short *)&mainMemory[physicalAddress];
-            *value = ShortToHost(data);
+            memcpy(&halfword, hostAddress, 2);
+            *value = ShortToHost(halfword);
             break;
 
         case 4:
-            data = *(unsigned int *)&mainMemory[physicalAddress];
-            *value = WordToHost(data);
+            memcpy(&word, hostAddress, 4);
+            *value = WordToHost(word);
             break;
 
         default:
@@ -129,30 +144,39 @@ bool Machine::ReadMem(int addr, int size, int *value) {
 //----------------------------------------------------------------------
 
 bool Machine::WriteMem(int addr, int size, int value) {
+    unsigned short halfword;
+    unsigned int word;
     ExceptionType exception;
     int physicalAddress;
+    char *hostAddress;
 
     DEBUG(dbgAddr,
           "Writing VA " << addr << ", size " << size << ", value " << value);
 
-    exception = Translate(addr, &physicalAddress, size, TRUE);
-    if (exception != NoException) {
-        RaiseException(exception, addr);
-        return FALSE;
+    hostAddress = SoftTranslate(addr, size, TRUE);
+    if (hostAddress == NULL) {
+        exception = Translate(addr, &physicalAddress, size, TRUE);
+        if (exception != NoException) {
+            RaiseException(exception, addr);
+            return FALSE;
+        }
+        hostAddress = &mainMemory[physicalAddress];
     }
+    if (dcache != NULL) CacheAccess(dcache, hostAddress - mainMemory, TRUE);
+
     switch (size) {
         case 1:
-            mainMemory[physicalAddress] = (unsigned char)(value & 0xff);
+            *hostAddress = (unsigned char)(value & 0xff);
             break;
 
         case 2:
-            *(unsigned short *)&mainMemory[physicalAddress] =
-                ShortToMachine((unsigned short)(value & 0xffff));
+            halfword = ShortToMachine((unsigned short)(value & 0xffff));
+            memcpy(hostAddress, &halfword, 2);
             break;
 
         case 4:
-            *(unsigned int *)&mainMemory[physicalAddress] =
-                WordToMachine((unsigned int)value);
+            word = WordToMachine((unsigned int)value);
+            memcpy(hostAddress, &word, 4);
             break;
 
         default:
@@ -175,14 +199,39 @@ bool Machine::WriteMem(int addr, int size, int value) {
 //	"physAddr" -- the place to store the physical address
 //	"size" -- the amount of memory being read or written
 // 	"writing" -- if TRUE, check the "read-only" bit in the TLB
+//
+//	Successful translations are remembered in the soft TLB, so that
+//	the next access to the same page can skip all this.  Only pages
+//	whose use bit is set get in, and only pages whose dirty bit is
+//	set can be written without coming back here, so the bits the
+//	kernel sees are the same as if every access had been checked.
+//
+//	With -hostperf, the host's time for it is counted in the
+//	"translate" region, as Interrupt::OneTick does for "tick".
 //----------------------------------------------------------------------
 
 ExceptionType Machine::Translate(int virtAddr, int *physAddr, int size,
                                  bool writing) {
-    int i;
+    int i, set;
     unsigned int vpn, offset;
     TranslationEntry *entry;
     unsigned int pageFrame;
+    SoftTLBEntry *cached;
+    char *hostAddress;
+
+    if (hostPerf != NULL && hostPerf->Entering(HostTranslate)) {
+        HostRegion outer = hostPerf->Enter(HostTranslate);
+        ExceptionType exception = Translate(virtAddr, physAddr, size, writing);
+
+        hostPerf->Leave(outer);
+        return exception;
+    }
+
+    hostAddress = SoftTranslate(virtAddr, size, writing);
+    if (hostAddress != NULL) {
+        *physAddr = hostAddress - mainMemory;
+        return NoException;
+    }
 
     DEBUG(dbgAddr,
           "\tTranslate " << virtAddr << (writing ? " , write" : " , read"));
@@ -214,17 +263,23 @@ ExceptionType Machine::Translate(int virtAddr, int *physAddr, int size,
         }
         entry = &pageTable[vpn];
     } else {
-        for (entry = NULL, i = 0; i < TLBSize; i++)
-            if (tlb[i].valid && (tlb[i].virtualPage == ((int)vpn))) {
+        set = (vpn % (tlbSize / tlbWays)) * tlbWays;
+        for (entry = NULL, i = set; i < set + tlbWays; i++)
+            if (tlb[i].valid && (tlb[i].virtualPage == ((int)vpn)) &&
+                (!tlbTagged || tlbAsid[i] == currentAsid)) {
                 entry = &tlb[i];  // FOUND!
                 break;
             }
         if (entry == NULL) {  // not found
             DEBUG(dbgAddr, "Invalid TLB entry for this virtual page!");
+            kernel->stats->numTLBMisses++;
             return PageFaultException;  // really, this is a TLB fault,
                                         // the page may be in memory,
                                         // but not in the TLB
         }
+        kernel->stats->numTLBHits++;
+        tlbReferenced[i] = TRUE;
+        if (tlbPolicy == LRUReplace) tlbStamp[i] = ++tlbTime;
     }
 
     if (entry->readOnly && writing) {  // trying to write to a read-only page
@@ -244,5 +299,222 @@ ExceptionType Machine::Translate(int virtAddr, int *physAddr, int size,
     *physAddr = pageFrame * PageSize + offset;
     ASSERT((*physAddr >= 0) && ((*physAddr + size) <= MemorySize));
     DEBUG(dbgAddr, "phys addr = " << *physAddr);
+
+    if (softTLBEnabled) {
+        cached = &softTLB[vpn % SoftTLBSize];
+        cached->virtualPage = vpn;
+        cached->page = &mainMemory[pageFrame * PageSize];
+        cached->writable = !entry->readOnly && entry->dirty;
+    }
     return NoException;
 }
+
+//----------------------------------------------------------------------
+// Machine::FlushSoftTLB
+// 	Forget every translation in the soft TLB.  Called when the kernel
+//	switches address spaces (AddrSpace::RestoreState); a kernel that
+//	edits page table or TLB entries in place, say to clear the use
+//	bits, must call it too.
+//----------------------------------------------------------------------
+
+void Machine::FlushSoftTLB() {
+    for (int i = 0; i < SoftTLBSize; i++) {
+        softTLB[i].virtualPage = -1;
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::EnableTLB
+// 	Translate through a TLB from now on, instead of the page table.
+//	The TLB starts out empty; the kernel fills it on each TLB miss
+//	(a PageFaultException), with WriteTLB.
+//
+//	The soft TLB is turned off: it would hide accesses from the TLB
+//	and its replacement policy, and the point of simulating a TLB is
+//	to see how it does.
+//
+//	"size" -- the number of entries
+//	"ways" -- the number of entries in each set; "size" for a fully
+//		associative TLB.  At least 2, so that an instruction's own
+//		page and the page it loads or stores can both be in the
+//		TLB at once; with one way they could keep replacing each
+//		other, and the instruction would never complete.
+//	"policy" -- which entry in a full set to replace
+//	"tagged" -- if TRUE, match entries against currentAsid
+//----------------------------------------------------------------------
+
+void Machine::EnableTLB(int size, int ways, TLBPolicy policy, bool tagged) {
+    ASSERT(size > 0 && ways >= 2 && size % ways == 0);
+
+    FreeTLB();
+    tlb = new TranslationEntry[size];
+    tlbAsid = new int[size];
+    tlbStamp = new unsigned[size];
+    tlbReferenced = new bool[size];
+    tlbHand = new int[size / ways];
+    tlbSize = size;
+    tlbWays = ways;
+    tlbPolicy = policy;
+    tlbTagged = tagged;
+    tlbTime = 0;
+    tlbSeed = 1;
+    for (int i = 0; i < size; i++) {
+        tlb[i].valid = FALSE;
+        tlbAsid[i] = -1;
+        tlbStamp[i] = 0;
+        tlbReferenced[i] = FALSE;
+    }
+    for (int i = 0; i < size / ways; i++) {
+        tlbHand[i] = 0;
+    }
+
+    softTLBEnabled = FALSE;
+    FlushSoftTLB();
+}
+
+//----------------------------------------------------------------------
+// Machine::FreeTLB
+// 	De-allocate the TLB, if there is one.
+//----------------------------------------------------------------------
+
+void Machine::FreeTLB() {
+    if (tlb == NULL) return;
+    delete[] tlb;
+    delete[] tlbAsid;
+    delete[] tlbStamp;
+    delete[] tlbReferenced;
+    delete[] tlbHand;
+    tlb = NULL;
+    tlbSize = 0;
+}
+
+//----------------------------------------------------------------------
+// Machine::TLBVictim
+// 	Return the index of the TLB entry that a translation for
+//	"virtualPage" should go into.  That is an invalid entry in its
+//	set, if there is one; otherwise tlbPolicy decides.  The kernel
+//	can look at the old entry (to save its use and dirty bits)
+//	before calling WriteTLB.
+//----------------------------------------------------------------------
+
+int Machine::TLBVictim(int virtualPage) {
+    int set = ((unsigned)virtualPage % (tlbSize / tlbWays)) * tlbWays;
+    int i, victim;
+
+    for (i = set; i < set + tlbWays; i++) {
+        if (!tlb[i].valid) return i;
+    }
+
+    switch (tlbPolicy) {
+        case RandomReplace:
+            tlbSeed = tlbSeed * 1103515245 + 12345;
+            return set + (tlbSeed >> 16) % tlbWays;
+
+        case FIFOReplace:
+        case LRUReplace:  // oldest stamp, from writing or from use
+            victim = set;
+            for (i = set + 1; i < set + tlbWays; i++) {
+                if (tlbStamp[i] < tlbStamp[victim]) victim = i;
+            }
+            return victim;
+
+        case ClockReplace:
+            for (;;) {
+                victim = set + tlbHand[set / tlbWays];
+                tlbHand[set / tlbWays] = (tlbHand[set / tlbWays] + 1) % tlbWays;
+                if (!tlbReferenced[victim]) return victim;
+                tlbReferenced[victim] = FALSE;
+            }
+
+        default:
+            ASSERTNOTREACHED();
+    }
+    return set;
+}
+
+//----------------------------------------------------------------------
+// Machine::WriteTLB
+// 	Copy a translation into TLB entry "i", tagged with the current
+//	address space.  This is the only way the TLB policies find out
+//	about new entries, so the kernel should use it rather than
+//	writing to "tlb" directly.
+//----------------------------------------------------------------------
+
+void Machine::WriteTLB(int i, TranslationEntry *entry) {
+    ASSERT(i >= 0 && i < tlbSize);
+    tlb[i] = *entry;
+    tlbAsid[i] = currentAsid;
+    tlbStamp[i] = ++tlbTime;
+    tlbReferenced[i] = TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushTLB
+// 	Invalidate the TLB entries of address space "asid", or every
+//	entry if "asid" is -1.  Anything the kernel wants from the old
+//	entries (the use and dirty bits) it has to save first.
+//----------------------------------------------------------------------
+
+void Machine::FlushTLB(int asid) {
+    for (int i = 0; i < tlbSize; i++) {
+        if (asid == -1 || tlbAsid[i] == asid) {
+            tlb[i].valid = FALSE;
+        }
+    }
+    kernel->stats->numTLBFlushes++;
+}
+
+//----------------------------------------------------------------------
+// TLBBank::TLBBank, TLBBank::~TLBBank
+// 	Start with no TLB; on the way out, free the one held, if any.
+//----------------------------------------------------------------------
+
+TLBBank::TLBBank() {
+    tlb = NULL;
+    tlbAsid = tlbHand = NULL;
+    tlbStamp = NULL;
+    tlbReferenced = NULL;
+    tlbTime = 0;
+    tlbSeed = 1;
+    currentAsid = 0;
+}
+
+TLBBank::~TLBBank() {
+    if (tlb == NULL) return;
+    delete[] tlb;
+    delete[] tlbAsid;
+    delete[] tlbStamp;
+    delete[] tlbReferenced;
+    delete[] tlbHand;
+}
+
+//----------------------------------------------------------------------
+// Machine::SwitchTLB
+// 	Another simulated CPU is taking over: put the TLB of the one
+//	that was running, with its replacement state and address space,
+//	into "save", and load the TLB of the new one from "load".  The
+//	size, associativity and policy are the same for every CPU.
+//----------------------------------------------------------------------
+
+void Machine::SwitchTLB(TLBBank *save, TLBBank *load) {
+    ASSERT(save != load);
+    save->tlb = tlb;
+    save->tlbAsid = tlbAsid;
+    save->tlbStamp = tlbStamp;
+    save->tlbReferenced = tlbReferenced;
+    save->tlbHand = tlbHand;
+    save->tlbTime = tlbTime;
+    save->tlbSeed = tlbSeed;
+    save->currentAsid = currentAsid;
+
+    tlb = load->tlb;
+    tlbAsid = load->tlbAsid;
+    tlbStamp = load->tlbStamp;
+    tlbReferenced = load->tlbReferenced;
+    tlbHand = load->tlbHand;
+    tlbTime = load->tlbTime;
+    tlbSeed = load->tlbSeed;
+    currentAsid = load->currentAsid;
+    load->tlb = NULL;  // the Machine owns it now
+    FlushSoftTLB();
+}
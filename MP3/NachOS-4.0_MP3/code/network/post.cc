@@ -280,6 +280,7 @@ PostOfficeOutput::~PostOfficeOutput() {
 void PostOfficeOutput::Send(PacketHeader pktHdr, MailHeader mailHdr, char *data) {
     char *buffer = new char[MaxPacketSize];  // space to hold concatenated
                                              // mailHdr + data
+    int queued;
 
     if (debug->IsEnabled('n')) {
         cout << "Post send: ";
@@ -296,8 +297,10 @@ void PostOfficeOutput::Send(PacketHeader pktHdr, MailHeader mailHdr, char *data)
     bcopy((char *)&mailHdr, buffer, sizeof(MailHeader));
     bcopy(data, buffer + sizeof(MailHeader), mailHdr.length);
 
+    queued = kernel->stats->totalTicks;
     sendLock->Acquire();  // only one message can be sent
                           // to the network at any one time
+    kernel->stats->network.Queued(queued);
     network->Send(pktHdr, buffer);
     messageSent->P();  // wait for interrupt to tell us
                        // ok to send the next message
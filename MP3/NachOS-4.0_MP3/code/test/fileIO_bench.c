@@ -0,0 +1,49 @@
+/* fileIO_bench.c
+ *	Benchmark for large Read and Write system calls: write a 4 KB
+ *	buffer ROUNDS times to a file, read it back ROUNDS times, and
+ *	check what was read.  The buffers start part way into a page and
+ *	span many, so each call copies across page boundaries.
+ *
+ *	Time it on the host, e.g. "time ../build.linux/nachos -e fileIO_bench".
+ *	It prints the bytes written, the bytes read, and the number of
+ *	bytes read back wrong, which should be 0.
+ */
+
+#include "syscall.h"
+
+#define SIZE 4096
+#define ROUNDS 512
+
+char pad1[3];
+char src[SIZE]; /* too big for the user stack */
+char pad2[5];
+char dst[SIZE];
+
+int main(void) {
+    OpenFileId fid;
+    int i, total, wrong;
+
+    for (i = 0; i < SIZE; i++) src[i] = i * 7;
+
+    if (Create("bench.test") != 1) MSG("Failed on creating file");
+    fid = Open("bench.test");
+    if (fid < 0) MSG("Failed on opening file");
+    total = 0;
+    for (i = 0; i < ROUNDS; i++) total += Write(src, SIZE, fid);
+    PrintInt(total);
+    Close(fid);
+
+    fid = Open("bench.test");
+    if (fid < 0) MSG("Failed on opening file");
+    total = 0;
+    for (i = 0; i < ROUNDS; i++) total += Read(dst, SIZE, fid);
+    PrintInt(total);
+    Close(fid);
+
+    wrong = 0;
+    for (i = 0; i < SIZE; i++) {
+        if (dst[i] != src[i]) wrong++;
+    }
+    PrintInt(wrong);
+    Halt();
+}
@@ -0,0 +1,82 @@
+#!/bin/bash
+
+# Run each test program under the debugging build (nachos) and the
+# optimized one (nachos.release, from "make release"), on every
+# engine, and compare what they print, the registers and memory at
+# Exit (-d x) and the tick counts.  The host speed line is the only
+# thing allowed to differ.  Then time both builds, and report how
+# much faster the release one is.
+
+programs=("halt" "add" "LotOfAdd" "matmult" "sort" "hw3t1" "hw3t2" "hw3t3")
+engines=("interp" "block" "jit")
+
+DEBUG_NACHOS=../build.linux/nachos
+RELEASE_NACHOS=../build.linux/nachos.release
+TIMEOUT="timeout 60s"
+
+for nachos in "$DEBUG_NACHOS" "$RELEASE_NACHOS"; do
+    if [ ! -x "$nachos" ]; then
+        echo "$nachos not built; run \"make nachos release\" in build.linux."
+        exit 1
+    fi
+done
+
+mkdir -p .tmp
+
+for program in "${programs[@]}"; do
+    if [ ! -f "$program" ]; then
+        echo "$program not built, skipped."
+        continue
+    fi
+    for engine in "${engines[@]}"; do
+        $TIMEOUT $DEBUG_NACHOS -e "$program" -ee -d x -sim "$engine" 2>&1 |
+            grep -v "^Simulator:" > ".tmp/$program.$engine.debug"
+        $TIMEOUT $RELEASE_NACHOS -e "$program" -ee -d x -sim "$engine" 2>&1 |
+            grep -v "^Simulator:" > ".tmp/$program.$engine.release"
+        diff ".tmp/$program.$engine.debug" ".tmp/$program.$engine.release"
+
+        if [ $? -eq 0 ]; then
+            echo -e "\e[92m$program ($engine) Succeed.\e[0m"
+        else
+            echo -e "\e[91m$program ($engine) Failed.\e[0m"
+        fi
+    done
+done
+
+rm -r .tmp
+
+# Time every program on every engine, a few times over, under each
+# build; the best of the runs is the least disturbed by the host.
+
+RUNS=3
+
+total_time() {
+    local nachos=$1 best total=0 start end elapsed
+    for program in "${programs[@]}"; do
+        [ -f "$program" ] || continue
+        for engine in "${engines[@]}"; do
+            best=
+            for ((run = 0; run < RUNS; run++)); do
+                start=$(date +%s%N)
+                $TIMEOUT $nachos -e "$program" -ee -sim "$engine" > /dev/null 2>&1
+                end=$(date +%s%N)
+                elapsed=$(((end - start) / 1000))
+                if [ -z "$best" ] || [ $elapsed -lt $best ]; then
+                    best=$elapsed
+                fi
+            done
+            total=$((total + best))
+        done
+    done
+    echo $total
+}
+
+debug_time=$(total_time $DEBUG_NACHOS)
+release_time=$(total_time $RELEASE_NACHOS)
+
+echo "debug:   $((debug_time / 1000)) ms"
+echo "release: $((release_time / 1000)) ms"
+if [ $release_time -gt 0 ]; then
+    speedup=$((debug_time * 100 / release_time))
+    printf "speedup: %d.%02dx\n" $((speedup / 100)) $((speedup % 100))
+fi
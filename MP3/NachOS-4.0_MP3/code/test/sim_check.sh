@@ -0,0 +1,64 @@
+#!/bin/bash
+
+# Run each test program under the interpreter and under the JIT, and
+# compare what they print, the registers and memory at Exit (-d x) and
+# the tick counts.  The host speed line is the only thing allowed to
+# differ, and under a TLB the hit count.
+
+programs=("halt" "add" "LotOfAdd" "matmult" "sort" "hw3t1" "hw3t2" "hw3t3")
+engines=("block" "jit")
+
+TIMEOUT="timeout 60s"
+
+mkdir -p .tmp
+
+for program in "${programs[@]}"; do
+    if [ ! -f "$program" ]; then
+        echo "$program not built, skipped."
+        continue
+    fi
+    $TIMEOUT ../build.linux/nachos -e "$program" -ee -d x -sim interp 2>&1 |
+        grep -v "^Simulator:" > ".tmp/$program.interp"
+    for engine in "${engines[@]}"; do
+        $TIMEOUT ../build.linux/nachos -e "$program" -ee -d x -sim "$engine" 2>&1 |
+            grep -v "^Simulator:" > ".tmp/$program.$engine"
+        diff ".tmp/$program.interp" ".tmp/$program.$engine"
+
+        if [ $? -eq 0 ]; then
+            echo -e "\e[92m$program ($engine) Succeed.\e[0m"
+        else
+            echo -e "\e[91m$program ($engine) Failed.\e[0m"
+        fi
+    done
+done
+
+# Several programs sharing a small TLB.  Each block fetches its
+# instructions through the TLB once rather than once per instruction,
+# so only the hits may differ; the misses must not.
+tlb_programs=("sort" "matmult")
+tlb_args="-tlb 8"
+tlb_ready=1
+for program in "${tlb_programs[@]}"; do
+    if [ ! -f "$program" ]; then
+        echo "$program not built, TLB check skipped."
+        tlb_ready=0
+    fi
+    tlb_args="$tlb_args -e $program"
+done
+if [ $tlb_ready -eq 1 ]; then
+    $TIMEOUT ../build.linux/nachos $tlb_args -ee -sim interp 2>&1 |
+        grep -v "^Simulator:" | sed "s/hits [0-9]*, //; s/ ([0-9.]*% hit)//" > .tmp/tlb.interp
+    for engine in "${engines[@]}"; do
+        $TIMEOUT ../build.linux/nachos $tlb_args -ee -sim "$engine" 2>&1 |
+            grep -v "^Simulator:" | sed "s/hits [0-9]*, //; s/ ([0-9.]*% hit)//" > ".tmp/tlb.$engine"
+        diff .tmp/tlb.interp ".tmp/tlb.$engine"
+
+        if [ $? -eq 0 ]; then
+            echo -e "\e[92m$tlb_args ($engine) Succeed.\e[0m"
+        else
+            echo -e "\e[91m$tlb_args ($engine) Failed.\e[0m"
+        fi
+    done
+fi
+
+rm -r .tmp
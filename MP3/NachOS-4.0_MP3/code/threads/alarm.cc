@@ -37,13 +37,45 @@ Alarm::Alarm(bool doRandom) { timer = new Timer(doRandom, this); }
 //	if the interrupted thread called Yield at the point it is
 //	was interrupted.
 //
+//	With -smp, every CPU takes the interrupt, each at the end of its
+//	turn in the round (see Interrupt::CpuTick), so here we just note
+//	that it is pending.
+//----------------------------------------------------------------------
+
+void Alarm::CallBack() {
+    kernel->stats->CheckJson();  // a periodic -stats-json snapshot
+    if (kernel->numCpus > 1) {
+        for (int i = 0; i < kernel->numCpus; i++) {
+            kernel->cpus[i]->timerPending = TRUE;
+        }
+        return;
+    }
+    TimeSlice();
+}
+
+//----------------------------------------------------------------------
+// Alarm::TimeSlice
+//	The timer interrupt, as taken by the running CPU: balance the
+//	ready queues between CPUs, sample the profile, and age the
+//	waiting threads, asking for a context switch if that makes
+//	another thread more deserving of the CPU.
+//
 //	For now, just provide time-slicing.  Only need to time slice
 //      if we're currently running something (in other words, not idle).
 //----------------------------------------------------------------------
 
-void Alarm::CallBack() {
+void Alarm::TimeSlice() {
     Interrupt *interrupt = kernel->interrupt;
     MachineStatus status = interrupt->getStatus();
+
+    if (kernel->numCpus > 1) {
+        kernel->Balance();
+    }
+    if (status != IdleMode && kernel->currentThread->space != NULL &&
+        kernel->currentThread->space->profile != NULL) {
+        kernel->currentThread->space->profile->Sample(
+            kernel->machine->ReadRegister(PCReg), status == SystemMode);
+    }
     /* Aging and check preemption */
 
     if (status != IdleMode &&
@@ -32,6 +32,8 @@ class Alarm : public CallBackObj {
     void WaitUntil(int x);  // suspend execution until time > now + x
                             // this method is not yet implemented
 
+    void TimeSlice();  // the running CPU takes the timer interrupt
+
    private:
     Timer *timer;  // the hardware timer device
 
@@ -0,0 +1,198 @@
+// batch.cc
+//	Routines to run a batch of simulations in one process, several
+//	at a time.  See batch.h for the job file, and what the jobs share.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "batch.h"
+
+#include <pthread.h>
+#include <setjmp.h>
+
+#include "copyright.h"
+#include "debug.h"
+#include "main.h"
+#include "sysdep.h"
+
+static char *jobFileName;
+static char **jobs;  // the flags of each simulation, from the job file
+static int numJobLines;
+static int nextJob;  // the next one to run, shared by the host threads
+static pthread_mutex_t nextJobLock = PTHREAD_MUTEX_INITIALIZER;
+
+// where cout goes on this host thread: stdout, or the output file of
+// the job it is running
+static THREAD_LOCAL int jobOutputFileNo = 1;
+
+// The following class sends cout to the output file of the job that is
+// writing, so that the statistics and other messages Nachos prints
+// end up with the rest of its output.  It does not buffer anything, so
+// the host threads share no state through it.
+
+class JobOutput : public streambuf {
+   protected:
+    int overflow(int c) {
+        if (c != EOF) {
+            char ch = c;
+
+            WriteFile(jobOutputFileNo, &ch, 1);
+        }
+        return c;
+    }
+    streamsize xsputn(const char *s, streamsize n) {
+        WriteFile(jobOutputFileNo, (char *)s, n);
+        return n;
+    }
+};
+
+//----------------------------------------------------------------------
+// ReadJobs
+// 	Read the job file into "jobs", one entry for each line that has
+//	something on it besides a comment.
+//----------------------------------------------------------------------
+
+static void ReadJobs() {
+    int fileNo = OpenForReadWrite(jobFileName, FALSE);
+    char *text, *line, *next;
+    int size;
+
+    if (fileNo < 0) {
+        cerr << "Cannot read the job file " << jobFileName << "\n";
+        ASSERT(FALSE);
+    }
+    Lseek(fileNo, 0, 2);
+    size = Tell(fileNo);
+    Lseek(fileNo, 0, 0);
+    text = new char[size + 1];
+    Read(fileNo, text, size);
+    text[size] = '\0';
+    Close(fileNo);
+
+    jobs = new char *[size / 2 + 1];  // no more lines than that
+    numJobLines = 0;
+    for (line = text; *line != '\0'; line = next) {
+        char *comment;
+
+        next = strchr(line, '\n');
+        if (next != NULL) {
+            *next++ = '\0';
+        } else {
+            next = line + strlen(line);
+        }
+        comment = strchr(line, '#');
+        if (comment != NULL) *comment = '\0';
+        if (strspn(line, " \t\r") < strlen(line)) {
+            jobs[numJobLines++] = line;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// RunJob
+// 	Run simulation number "jobNo" (from 1), with the flags "flags",
+//	on this host thread, sending its output to its own file.
+//	Returns once it has halted, and its kernel has been deleted.
+//----------------------------------------------------------------------
+
+static void RunJob(int jobNo, char *flags) {
+    int maxArgs = strlen(flags) / 2 + 4;
+    char **argv = new char *[maxArgs];
+    char *line = new char[strlen(flags) + 1];
+    char jobName[16], *outputName, *rest;
+    jmp_buf returnTo;
+    int argc = 0;
+
+    // the command line: "nachos -m <jobNo> <flags>"
+    sprintf(jobName, "%d", jobNo);
+    argv[argc++] = "nachos";
+    argv[argc++] = "-m";
+    argv[argc++] = jobName;
+    strcpy(line, flags);
+    for (char *arg = strtok_r(line, " \t\r", &rest); arg != NULL;
+         arg = strtok_r(NULL, " \t\r", &rest)) {
+        argv[argc++] = arg;
+    }
+    argv[argc] = NULL;
+
+    outputName = new char[strlen(jobFileName) + 32];
+    sprintf(outputName, "%s.%d.out", jobFileName, jobNo);
+    jobOutputFileNo = OpenForWrite(outputName);
+
+    RandomInit(1);  // as in a Nachos process of its own
+    kernel = NULL;
+    if (setjmp(returnTo) == 0) {
+        RunNachos(argc, argv, &returnTo, jobOutputFileNo);
+        // returns only if it never started a kernel, as for -tracedump
+    }
+    // the simulation has halted, and we are back on our own stack
+    delete kernel;
+    kernel = NULL;
+    delete debug;
+    debug = NULL;
+
+    Close(jobOutputFileNo);
+    jobOutputFileNo = 1;
+    delete[] outputName;
+    delete[] line;
+    delete[] argv;
+}
+
+//----------------------------------------------------------------------
+// RunJobs
+// 	The body of each host thread: run the next job in the file, until
+//	there are none left.
+//----------------------------------------------------------------------
+
+static void *RunJobs(void *unused) {
+    for (;;) {
+        int job;
+
+        pthread_mutex_lock(&nextJobLock);
+        job = nextJob++;
+        pthread_mutex_unlock(&nextJobLock);
+        if (job >= numJobLines) {
+            return NULL;
+        }
+        RunJob(job + 1, jobs[job]);
+    }
+}
+
+//----------------------------------------------------------------------
+// RunBatch
+// 	Run every simulation in the job file "jobFile", "numJobs" at a
+//	time, each on a host thread of its own, and report how long it
+//	took.
+//----------------------------------------------------------------------
+
+int RunBatch(char *jobFile, int numJobs) {
+    pthread_t *hostThreads = new pthread_t[numJobs];
+    streambuf *stdoutBuf = cout.rdbuf();
+    JobOutput jobOutput;
+    double start = HostTime();
+    double seconds;
+
+    jobFileName = jobFile;
+    ReadJobs();
+    nextJob = 0;
+
+    cout.flush();
+    cout.rdbuf(&jobOutput);
+    for (int i = 0; i < numJobs; i++) {
+        int error = pthread_create(&hostThreads[i], NULL, RunJobs, NULL);
+
+        ASSERT(error == 0);
+    }
+    for (int i = 0; i < numJobs; i++) {
+        pthread_join(hostThreads[i], NULL);
+    }
+    cout.rdbuf(stdoutBuf);
+
+    seconds = HostTime() - start;
+    cerr << "Batch: " << numJobLines << " simulations, " << numJobs
+         << " at a time, " << seconds << " s (" << numJobLines / seconds
+         << " per second)\n";
+    delete[] hostThreads;
+    return 0;
+}
@@ -0,0 +1,46 @@
+// batch.h
+//	Run many simulations in one process (nachos -batch), several at
+//	a time, each on a host thread of its own.
+//
+//	The job file has the flags of one simulation on each line, as
+//	they would be given to nachos; anything after a "#" is a comment.
+//	For example:
+//
+//		-e ../test/matmult -ee
+//		-e ../test/sort -ee -smp 2
+//		-e ../test/matmult -ee -cost r3000.cost	# slower memory
+//
+//	The n-th simulation in the file (from 1, not counting blank lines)
+//	is run as "nachos -m n <flags>", and whatever it writes to stdout
+//	(console output without -co, and the statistics) goes to
+//	<job file>.n.out instead.  -jobs sets how many run at once; each
+//	host thread takes the next one once its simulation halts.
+//
+//	This works because every global variable a simulation uses --
+//	kernel, debug, trace, and the few statics below them -- is kept
+//	per host thread (THREAD_LOCAL, in sysdep.h), and a halting
+//	simulation returns to the host thread that started it (see
+//	Kernel::ReturnToHost) rather than exiting.  What a job still
+//	shares with the others:
+//	    cerr, so -d output of jobs run at once is interleaved;
+//	    stdin, so a job that reads the console needs -ci;
+//	    the files it writes, such as -stats-json, -trace and -prof
+//		output, which need a name of their own for each job;
+//	    the process: an ASSERT that fails in any job aborts them all.
+//	Threads that are still blocked or ready when a job halts are
+//	never deleted, as when Nachos exits.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "copyright.h"
+
+// Run the simulations in "jobFile", "numJobs" at a time; returns the
+// exit status for Nachos
+extern int RunBatch(char *jobFile, int numJobs);
+
+#endif  // BATCH_H
@@ -0,0 +1,250 @@
+// checkpoint.cc
+//	Routines to save the state of a simulation to a checkpoint file,
+//	and to start a simulation from one.  See checkpoint.h for when a
+//	checkpoint can be taken, and what is in it.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "checkpoint.h"
+
+#include "copyright.h"
+#include "debug.h"
+#include "main.h"
+#include "synchdisk.h"
+#include "sysdep.h"
+
+// marks the start and the end of a checkpoint file
+const int CheckpointMagic = 0x4e434b50;  // "NCKP"
+const int CheckpointEnd = 0x454e4421;
+
+//----------------------------------------------------------------------
+// CheckpointFile::CheckpointFile
+// 	Set up to write a checkpoint, or to read one.  The whole file is
+//	kept in memory: written out at the end, or read in right away.
+//
+//	"fileName" -- the checkpoint file
+//	"writing" -- TRUE to create it, FALSE to read it
+//----------------------------------------------------------------------
+
+CheckpointFile::CheckpointFile(char *fileName, bool writing) {
+    name = fileName;
+    this->writing = writing;
+    if (writing) {
+        fileNo = OpenForWrite(fileName);
+        size = 0;
+        room = 64 * 1024;
+        buffer = new char[room];
+    } else {
+        fileNo = OpenForReadWrite(fileName, FALSE);
+        if (fileNo < 0) {
+            cerr << "Cannot read the checkpoint " << fileName << "\n";
+            ASSERT(FALSE);
+        }
+        Lseek(fileNo, 0, 2);
+        size = Tell(fileNo);
+        Lseek(fileNo, 0, 0);
+        buffer = new char[size];
+        Read(fileNo, buffer, size);
+    }
+    position = 0;
+    Check(CheckpointMagic);
+}
+
+//----------------------------------------------------------------------
+// CheckpointFile::~CheckpointFile
+// 	Finish the checkpoint: write it out, or check that all of it
+//	has been read.
+//----------------------------------------------------------------------
+
+CheckpointFile::~CheckpointFile() {
+    Check(CheckpointEnd);
+    if (writing) {
+        WriteFile(fileNo, buffer, size);
+    }
+    Close(fileNo);
+    delete[] buffer;
+}
+
+//----------------------------------------------------------------------
+// CheckpointFile::Bytes
+// 	Write out "count" bytes from "data", or read them into it.
+//----------------------------------------------------------------------
+
+void CheckpointFile::Bytes(void *data, int count) {
+    if (writing) {
+        if (size + count > room) {
+            char *bigger;
+
+            while (size + count > room) {
+                room *= 2;
+            }
+            bigger = new char[room];
+            bcopy(buffer, bigger, size);
+            delete[] buffer;
+            buffer = bigger;
+        }
+        bcopy(data, buffer + size, count);
+        size += count;
+    } else {
+        if (position + count > size) {
+            cerr << "The checkpoint " << name << " is cut short\n";
+            ASSERT(FALSE);
+        }
+        bcopy(buffer + position, data, count);
+        position += count;
+    }
+}
+
+//----------------------------------------------------------------------
+// CheckpointFile::Int, Bool, Float
+// 	Write out, or read in, a single value.
+//----------------------------------------------------------------------
+
+void CheckpointFile::Int(int *value) { Bytes(value, sizeof(int)); }
+
+void CheckpointFile::Bool(bool *value) { Bytes(value, sizeof(bool)); }
+
+void CheckpointFile::Float(float *value) { Bytes(value, sizeof(float)); }
+
+//----------------------------------------------------------------------
+// CheckpointFile::String
+// 	Write out a string, or read one in, into a new array.
+//----------------------------------------------------------------------
+
+void CheckpointFile::String(char **value) {
+    int length = writing ? strlen(*value) : 0;
+
+    Int(&length);
+    if (!writing) {
+        *value = new char[length + 1];
+        (*value)[length] = '\0';
+    }
+    Bytes(*value, length);
+}
+
+//----------------------------------------------------------------------
+// CheckpointFile::Check
+// 	Write out a marker word, or make sure the same word is read back,
+//	so that a file that is not a checkpoint, or was written by a
+//	different Nachos, is caught.
+//----------------------------------------------------------------------
+
+void CheckpointFile::Check(int word) {
+    int found = word;
+
+    Int(&found);
+    if (found != word) {
+        cerr << name << " is not a checkpoint written by this Nachos\n";
+        ASSERT(FALSE);
+    }
+}
+
+//----------------------------------------------------------------------
+// Kernel::CanCheckpoint
+// 	Return TRUE if a checkpoint can be taken now: the running thread
+//	is in user code (as it is whenever we are called), no thread is
+//	blocked, and every thread on the ready list either has not
+//	started yet or was preempted from user code -- so that each of
+//	them can be started again from its user registers.
+//----------------------------------------------------------------------
+
+bool Kernel::CanCheckpoint() {
+    ListIterator<ThreadStats *> records(stats->threads);
+    int alive = 0;
+
+    for (; !records.IsDone(); records.Next()) {
+        if (!records.Item()->finished) {
+            alive++;
+        }
+    }
+    if (alive != 1 + scheduler->NumReady()) {
+        return FALSE;  // some thread is blocked
+    }
+    return scheduler->AllResumable();
+}
+
+//----------------------------------------------------------------------
+// Kernel::CheckpointIfDue
+// 	Called after each user instruction's tick while -checkpoint is
+//	waiting to be done: once its time has come, and a checkpoint can
+//	be taken, write it out.  Only one is taken.
+//----------------------------------------------------------------------
+
+void Kernel::CheckpointIfDue() {
+    if (stats->totalTicks < checkpointTick || !CanCheckpoint()) {
+        return;
+    }
+
+    CheckpointFile *file = new CheckpointFile(checkpointFile, TRUE);
+
+    Checkpoint(file);
+    delete file;
+    cerr << "Checkpoint written to " << checkpointFile << " at tick "
+         << stats->totalTicks << "\n";
+    checkpointFile = NULL;
+}
+
+//----------------------------------------------------------------------
+// Kernel::Restore
+// 	Start from the checkpoint given with -restore, instead of running
+//	the programs given with -e: read the state back in, and go on
+//	running the thread that was running.  The host thread's own
+//	Thread takes its place.  Never returns.
+//----------------------------------------------------------------------
+
+void Kernel::Restore() {
+    CheckpointFile *file = new CheckpointFile(restoreFile, FALSE);
+
+    Checkpoint(file);
+    delete file;
+    DEBUG(dbgThread, "Restored " << restoreFile << " at tick "
+                                 << stats->totalTicks << ", running "
+                                 << currentThread->getName());
+
+    currentThread->space->RestoreState();  // its registers are the machine's
+    machine->Run();  // never returns
+    ASSERTNOTREACHED();
+}
+
+//----------------------------------------------------------------------
+// Kernel::Checkpoint
+// 	Write the state of the kernel, and of the machine, out to "file",
+//	or read it back in: the kernel's own, then that of each part in
+//	turn.  When reading, the kernel has just been initialized, and
+//	the current thread is the host thread's own.
+//----------------------------------------------------------------------
+
+void Kernel::Checkpoint(CheckpointFile *file) {
+    bool wasRandom = randomSlice;
+    unsigned seed;
+    int drawn;
+
+    file->Bool(&wasRandom);
+    if (wasRandom != randomSlice) {
+        cerr << "The checkpoint was taken " << (wasRandom ? "with" : "without")
+             << " -rs: restore it the same way\n";
+        ASSERT(FALSE);
+    }
+    file->Bool(&execExit);
+    file->Int(&execRunningNum);
+    file->Int(&threadNum);
+    file->Int(&NumFreeFrame);
+    file->Bytes(frameTable, sizeof(frameTable));
+    if (file->IsWriting()) {
+        RandomPosition(&seed, &drawn);
+    }
+    file->Bytes(&seed, sizeof(seed));
+    file->Int(&drawn);
+    if (!file->IsWriting()) {
+        RandomRestore(seed, drawn);
+    }
+
+    stats->Checkpoint(file);  // first: the threads look up their records
+    machine->Checkpoint(file);
+    interrupt->Checkpoint(file);
+    currentThread->Checkpoint(file);
+    scheduler->Checkpoint(file);
+    synchDisk->Checkpoint(file);
+}
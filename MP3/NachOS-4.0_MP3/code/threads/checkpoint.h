@@ -0,0 +1,74 @@
+// checkpoint.h
+//	Data structures for saving the state of a simulation to a file,
+//	and starting another run from it (nachos -checkpoint, -restore).
+//
+//	"nachos -checkpoint <file> <tick> ..." runs as usual, and at the
+//	first point at or after simulated time <tick> where it can, saves
+//	the state of the machine and of the kernel to <file>.  Then
+//	"nachos -restore <file> ..." starts from there, instead of
+//	loading and running the programs given with -e or -ep, and goes
+//	on exactly as the first run did from that point.
+//
+//	The state of each thread's kernel code lives on a host stack,
+//	which cannot be saved.  So a checkpoint is only taken while every
+//	thread is in user code: between two user instructions, with no
+//	thread blocked, and every ready thread either not started yet,
+//	or preempted by the timer.  Each of those is then restarted from
+//	its saved user registers.  What is saved:
+//	    the machine's registers and main memory;
+//	    the page table of each thread, its registers, scheduling
+//		state and statistics, and the order of the ready queues;
+//	    the pending interrupts, the clock and all other statistics;
+//	    the contents of the disk, and where the pseudo-random
+//		number generator is.
+//	What is not: console input that has not been read yet, and files
+//	the programs have open (these are host files).  The -smp, -tlb,
+//	-icache, -dcache, -cost, -prof and -stats-json flags are not
+//	allowed with either flag, as their state is not saved.  Any other
+//	flags that change the simulation, such as -rs, must be given to
+//	both runs alike.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "copyright.h"
+#include "utility.h"
+
+// The following class is a checkpoint file, being written or read.
+// Each part of the simulation saves and restores itself with one
+// routine, Checkpoint(CheckpointFile *), which calls the routines
+// below for each thing it keeps: so the same code both writes and
+// reads it, in the same order.
+
+class CheckpointFile {
+   public:
+    CheckpointFile(char *fileName, bool writing);
+    // Create "fileName" to write a checkpoint
+    // to, or open it to read one from
+    ~CheckpointFile();  // check the end of the file, and close it
+
+    bool IsWriting() { return writing; }
+
+    void Int(int *value);      // write out, or read in, one value
+    void Bool(bool *value);
+    void Float(float *value);
+    void Bytes(void *data, int count);
+    void String(char **value);  // reading gives a new copy of the string
+
+   private:
+    int fileNo;    // UNIX file number of the checkpoint
+    char *name;    // its name, for error messages
+    bool writing;  // TRUE if it is being written
+    char *buffer;  // the whole checkpoint, as written or read so far
+    int size;      // bytes in it
+    int room;      // bytes it has room for, when writing
+    int position;  // bytes read so far, when reading
+
+    void Check(int word);  // write or check a marker word
+};
+
+#endif  // CHECKPOINT_H
@@ -0,0 +1,258 @@
+// cpu.cc
+//	Routines to run several simulated CPUs on the one host thread,
+//	taking turns.  See cpu.h for how the CPUs are interleaved.
+//
+//	These routines assume that interrupts are already disabled.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "cpu.h"
+
+#include "copyright.h"
+#include "debug.h"
+#include "main.h"
+#include "switch.h"
+
+//----------------------------------------------------------------------
+// Cpu::Cpu
+// 	Initialize an idle CPU.
+//
+//	"cpuId" -- its number, from 0
+//	"readyQueues" -- the scheduler that keeps its ready threads
+//----------------------------------------------------------------------
+
+Cpu::Cpu(int cpuId, Scheduler *readyQueues) {
+    id = cpuId;
+    currentThread = NULL;
+    scheduler = readyQueues;
+    sliceTicks = 0;
+    timerPending = FALSE;
+    busyTicks = dispatches = migrations = 0;
+}
+
+//----------------------------------------------------------------------
+// Cpu::~Cpu
+// 	De-allocate the CPU's scheduler.  Its TLB, if it has one parked,
+//	goes with the TLBBank.
+//----------------------------------------------------------------------
+
+Cpu::~Cpu() { delete scheduler; }
+
+//----------------------------------------------------------------------
+// Cpu::Runs
+// 	Note that "thread" has been given this CPU, counting it as a
+//	migration if it last ran on another one.
+//----------------------------------------------------------------------
+
+void Cpu::Runs(Thread *thread) {
+    if (thread->cpuId != -1 && thread->cpuId != id) {
+        migrations++;
+        DEBUG(dbgThread, "Thread " << thread->getName() << " migrates from CPU "
+                                   << thread->cpuId << " to CPU " << id);
+    }
+    thread->cpuId = id;
+    currentThread = thread;
+    dispatches++;
+}
+
+//----------------------------------------------------------------------
+// Kernel::NextCpu
+// 	The running CPU has had its turn, or has gone idle: give the host
+//	to the next CPU that has something to do.  Every time the turn
+//	passes CPU 0 again, a round is over and the clock moves on.  An
+//	idle CPU looks for a ready thread, its own or another CPU's; if
+//	none of them has anything to do, the clock skips ahead to the
+//	next interrupt, as on a uniprocessor.
+//
+//	Returns once it is the turn of the calling thread again -- on
+//	whatever CPU that thread is now running.
+//----------------------------------------------------------------------
+
+void Kernel::NextCpu() {
+    int next = cpu->id;
+    int idle = 0;  // CPUs in a row that had nothing to do
+
+    ASSERT(interrupt->getLevel() == IntOff);
+    for (;;) {
+        next = (next + 1) % numCpus;
+        if (next == 0) {
+            interrupt->EndRound();
+        }
+
+        Cpu *nextCpu = cpus[next];
+        Thread *thread = nextCpu->currentThread;
+
+        if (thread != NULL) {
+            stats->ResumeThread(thread->threadStats);
+            SwitchCpu(nextCpu, thread);
+            return;
+        }
+        thread = FindNextToRun(nextCpu);
+        if (thread != NULL) {
+            Dispatch(nextCpu, thread);
+            return;
+        }
+        if (++idle == numCpus) {
+            interrupt->Idle();  // no one to run, wait for an interrupt
+            idle = 0;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// Kernel::IdleCpu
+// 	The current thread is going to sleep, or if "finishing", is done,
+//	and its CPU has nothing else to run: leave the CPU idle and let
+//	the others go on.  Returns when the thread has been woken up and
+//	given a CPU again.
+//----------------------------------------------------------------------
+
+void Kernel::IdleCpu(bool finishing) {
+    ASSERT(currentThread->getStatus() == BLOCKED);
+    DEBUG(dbgThread, "CPU " << cpu->id << " goes idle");
+
+    if (finishing) {
+        scheduler->DestroyLater(currentThread);
+    }
+    cpu->currentThread = NULL;
+    cpu->sliceTicks = 0;
+    NextCpu();
+}
+
+//----------------------------------------------------------------------
+// Kernel::FindNextToRun
+// 	Return the next thread for "forCpu" to run: the first on its own
+//	ready queues, or failing that, one taken from the CPU that has
+//	the most threads waiting.  Returns NULL if no thread is ready.
+//----------------------------------------------------------------------
+
+Thread *Kernel::FindNextToRun(Cpu *forCpu) {
+    Thread *thread = forCpu->scheduler->FindNextToRun();
+
+    if (thread == NULL) {
+        Cpu *busiest = BusiestCpu();
+
+        if (busiest != NULL) {
+            thread = busiest->scheduler->FindNextToRun();
+        }
+    }
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// Kernel::Balance
+// 	Called on each timer interrupt of the running CPU.  If it has no
+//	threads waiting, while another CPU has more than one, move one
+//	of those over, so that it does not wait behind the others.
+//----------------------------------------------------------------------
+
+void Kernel::Balance() {
+    Cpu *busiest = BusiestCpu();
+
+    if (scheduler->NumReady() == 0 && busiest != NULL &&
+        busiest->scheduler->NumReady() > 1) {
+        scheduler->ReadyToRun(busiest->scheduler->FindNextToRun());
+    }
+}
+
+//----------------------------------------------------------------------
+// Kernel::BusiestCpu
+// 	Return the CPU with the most threads ready to run (the lowest
+//	numbered, if there is a tie), or NULL if no thread is ready.
+//----------------------------------------------------------------------
+
+Cpu *Kernel::BusiestCpu() {
+    Cpu *busiest = NULL;
+    int most = 0;
+
+    for (int i = 0; i < numCpus; i++) {
+        int waiting = cpus[i]->scheduler->NumReady();
+
+        if (waiting > most) {
+            busiest = cpus[i];
+            most = waiting;
+        }
+    }
+    return busiest;
+}
+
+//----------------------------------------------------------------------
+// Kernel::Dispatch
+// 	Start "thread", which was ready to run, on the idle CPU "toCpu".
+//----------------------------------------------------------------------
+
+void Kernel::Dispatch(Cpu *toCpu, Thread *thread) {
+    DEBUG(dbgThread,
+          "CPU " << toCpu->id << " starts running: " << thread->getName());
+    toCpu->Runs(thread);
+    toCpu->sliceTicks = 0;
+    toCpu->timerPending = FALSE;
+    thread->setStatus(RUNNING);
+    thread->TimeUpdate_ToRun(stats->totalTicks);
+    stats->SwitchThread(thread->threadStats);
+    SwitchCpu(toCpu, thread);
+}
+
+//----------------------------------------------------------------------
+// Kernel::SwitchCpu
+// 	Hand the host over to "toCpu", which is to run "nextThread".
+//	As in Scheduler::Run, the user state of the thread that has been
+//	running is saved, and restored once it gets to run again; what
+//	is added is switching to the TLB of "toCpu".
+//
+//	"nextThread" may be waiting in Scheduler::Run or in here, or not
+//	have started yet; it need not be a different thread, if it has
+//	just been woken up again.
+//----------------------------------------------------------------------
+
+void Kernel::SwitchCpu(Cpu *toCpu, Thread *nextThread) {
+    Thread *oldThread = currentThread;
+
+    if (oldThread->space != NULL) {  // if this thread is a user program,
+        oldThread->SaveUserState();  // save the user's CPU registers
+        oldThread->space->SaveState();
+    }
+    oldThread->CheckOverflow();
+
+    if (toCpu != cpu) {
+        machine->SwitchTLB(&cpu->tlb, &toCpu->tlb);
+        cpu = toCpu;
+        scheduler = toCpu->scheduler;
+    }
+    currentThread = nextThread;
+    if (nextThread != oldThread) {
+        SWITCH(oldThread, nextThread);
+        if (halted) {  // a batch job halted while we were switched out
+            ReturnToHost();
+        }
+        // we're back, running oldThread, on kernel->cpu
+        ASSERT(interrupt->getLevel() == IntOff);
+        scheduler->CheckToBeDestroyed();
+    }
+
+    if (oldThread->space != NULL) {
+        oldThread->RestoreUserState();
+        oldThread->space->RestoreState();
+    }
+}
+
+//----------------------------------------------------------------------
+// Kernel::FlushTLBs
+// 	Invalidate the entries of address space "asid" in the TLB of
+//	every CPU, not just the running one (a "TLB shootdown"), so that
+//	none of them is left with translations for an address space that
+//	has gone away.
+//----------------------------------------------------------------------
+
+void Kernel::FlushTLBs(int asid) {
+    for (int i = 0; i < numCpus; i++) {
+        if (cpus[i] != cpu) {
+            machine->SwitchTLB(&cpu->tlb, &cpus[i]->tlb);
+            machine->FlushTLB(asid);
+            machine->SwitchTLB(&cpus[i]->tlb, &cpu->tlb);
+        }
+    }
+    machine->FlushTLB(asid);
+}
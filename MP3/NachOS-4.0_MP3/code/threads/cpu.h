@@ -0,0 +1,64 @@
+// cpu.h
+//	Data structures for simulating a shared-memory multiprocessor
+//	(nachos -smp).
+//
+//	There is still only one host thread, so the simulated CPUs take
+//	turns: in each round, every CPU that has a thread runs it for
+//	kernel->cpuQuantum ticks, and the simulated clock stands still
+//	until the round is over.  Then the clock moves on by the quantum,
+//	and any interrupts that are due fire.  So N busy CPUs get N times
+//	the work done in the same simulated time, and with the same
+//	command line the interleaving is always the same.
+//
+//	A CPU switch happens only where the clock would tick -- after a
+//	user instruction, or when the kernel re-enables interrupts --
+//	which is never while interrupts are disabled.  So disabling
+//	interrupts still gives mutual exclusion in the kernel: on every
+//	CPU, not just the one doing it, as if the kernel held one big lock.
+//
+//	Each CPU has its own ready queues, and its own TLB; the user
+//	registers of a thread are saved in the thread whenever its CPU
+//	stops running, as on a context switch.  A thread that is woken up
+//	goes on the ready queues of the CPU that woke it.  A CPU with an
+//	empty queue takes a thread from the CPU with the most waiting:
+//	when it runs out of work, and on each timer interrupt.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef CPU_H
+#define CPU_H
+
+#include "copyright.h"
+#include "machine.h"
+#include "scheduler.h"
+#include "thread.h"
+
+// The following class defines one simulated CPU.  With a single CPU,
+// there is one of these, but only the thread and scheduler fields
+// are used.
+
+class Cpu {
+   public:
+    Cpu(int cpuId, Scheduler *readyQueues);
+    // CPU number "cpuId", scheduling from
+    // "readyQueues"
+    ~Cpu();  // de-allocate its scheduler and TLB
+
+    void Runs(Thread *thread);  // "thread" is now running on this CPU
+
+    int id;
+    Thread *currentThread;  // running on this CPU, or NULL if it is idle
+    Scheduler *scheduler;   // its ready queues
+    TLBBank tlb;            // its TLB, while another CPU is running
+
+    int sliceTicks;     // ticks it has run for in this round
+    bool timerPending;  // the timer has interrupted since it last ran
+
+    int busyTicks;   // ticks spent running threads
+    int dispatches;  // threads started running on it
+    int migrations;  // of those, threads that last ran on another CPU
+};
+
+#endif  // CPU_H
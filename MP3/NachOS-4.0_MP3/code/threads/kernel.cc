@@ -8,7 +8,10 @@
 #include "kernel.h"
 
 #include "copyright.h"
+#include "costmodel.h"
 #include "debug.h"
+#include "hostperf.h"
+#include "intlog.h"
 #include "libtest.h"
 #include "main.h"
 #include "post.h"
@@ -17,7 +20,9 @@
 #include "synchconsole.h"
 #include "synchdisk.h"
 #include "synchlist.h"
+#include "switch.h"
 #include "sysdep.h"
+#include "trace.h"
 
 //----------------------------------------------------------------------
 // Kernel::Kernel
@@ -28,12 +33,40 @@
 Kernel::Kernel(int argc, char **argv) {
     randomSlice = FALSE;
     debugUserProg = FALSE;
+    simEngine = InterpEngine;
+    tlbSize = tlbWays = 0;
+    tlbPolicy = RandomReplace;
+    tlbTagged = FALSE;
+    icacheSize = dcacheSize = 0;  // default is no caches
+    cacheLineSize = 16;
+    cacheWays = 1;
+    cacheWritePolicy = WriteBack;
+    cacheHitTicks = 0;
+    cacheMissTicks = 10;
+    costModelFile = NULL;   // default is one tick per instruction
+    numCpus = 1;            // default is a uniprocessor
+    cpuQuantum = 10;
+    statsJsonFile = NULL;    // default is no JSON statistics
+    statsInterval = 10000;
+    profileInterval = 0;     // default is no profiling
+    hostPerfRegions = NULL;  // default is not to count host cycles
     execExit = FALSE;
+    execRunningNum = 0;
+    execfileNum = threadNum = 0;
     consoleIn = NULL;   // default is stdin
     consoleOut = NULL;  // default is stdout
-    frameTable[NumPhysPages] = {0};
+    for (int i = 0; i < NumPhysPages; i++) frameTable[i] = 0;
+    for (int i = 0; i < MaxAddrSpaces; i++) asidOwner[i] = NULL;
+    outputFileNo = 1;  // default is stdout
+    returnTo = NULL;   // default is to exit at Halt
+    halted = FALSE;
+    checkpointFile = NULL;  // default is no checkpoint
+    checkpointTick = 0;
+    restoreFile = NULL;
+    recordFile = replayFile = NULL;  // default is no interrupt log
+    interruptLog = NULL;
     NumFreeFrame = NumPhysPages;
-    threadPriority[10] = {0};
+    for (int i = 0; i < 10; i++) threadPriority[i] = 0;
 #ifndef FILESYS_STUB
     formatFlag = FALSE;
 #endif
@@ -55,6 +88,128 @@ Kernel::Kernel(int argc, char **argv) {
             i++;
         } else if (strcmp(argv[i], "-s") == 0) {
             debugUserProg = TRUE;
+        } else if (strcmp(argv[i], "-sim") == 0) {
+            ASSERT(i + 1 < argc);
+            if (strcmp(argv[i + 1], "block") == 0) {
+                simEngine = BlockEngine;
+            } else if (strcmp(argv[i + 1], "jit") == 0) {
+                simEngine = JitEngine;
+            } else {
+                ASSERT(strcmp(argv[i + 1], "interp") == 0);
+                simEngine = InterpEngine;
+            }
+            i++;
+        } else if (strcmp(argv[i], "-tlb") == 0) {
+            ASSERT(i + 1 < argc);
+            tlbSize = atoi(argv[i + 1]);
+            ASSERT(tlbSize > 0);
+            i++;
+        } else if (strcmp(argv[i], "-tlbways") == 0) {
+            ASSERT(i + 1 < argc);
+            tlbWays = atoi(argv[i + 1]);
+            ASSERT(tlbWays > 0);
+            i++;
+        } else if (strcmp(argv[i], "-tlbpolicy") == 0) {
+            ASSERT(i + 1 < argc);
+            if (strcmp(argv[i + 1], "fifo") == 0) {
+                tlbPolicy = FIFOReplace;
+            } else if (strcmp(argv[i + 1], "lru") == 0) {
+                tlbPolicy = LRUReplace;
+            } else if (strcmp(argv[i + 1], "clock") == 0) {
+                tlbPolicy = ClockReplace;
+            } else {
+                ASSERT(strcmp(argv[i + 1], "random") == 0);
+                tlbPolicy = RandomReplace;
+            }
+            i++;
+        } else if (strcmp(argv[i], "-asid") == 0) {
+            tlbTagged = TRUE;
+        } else if (strcmp(argv[i], "-icache") == 0) {
+            ASSERT(i + 1 < argc);
+            icacheSize = atoi(argv[i + 1]);
+            ASSERT(icacheSize > 0);
+            i++;
+        } else if (strcmp(argv[i], "-dcache") == 0) {
+            ASSERT(i + 1 < argc);
+            dcacheSize = atoi(argv[i + 1]);
+            ASSERT(dcacheSize > 0);
+            i++;
+        } else if (strcmp(argv[i], "-cacheline") == 0) {
+            ASSERT(i + 1 < argc);
+            cacheLineSize = atoi(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-cacheways") == 0) {
+            ASSERT(i + 1 < argc);
+            cacheWays = atoi(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-cachewrite") == 0) {
+            ASSERT(i + 1 < argc);
+            if (strcmp(argv[i + 1], "through") == 0) {
+                cacheWritePolicy = WriteThrough;
+            } else {
+                ASSERT(strcmp(argv[i + 1], "back") == 0);
+                cacheWritePolicy = WriteBack;
+            }
+            i++;
+        } else if (strcmp(argv[i], "-cachehit") == 0) {
+            ASSERT(i + 1 < argc);
+            cacheHitTicks = atoi(argv[i + 1]);
+            ASSERT(cacheHitTicks >= 0);
+            i++;
+        } else if (strcmp(argv[i], "-cachemiss") == 0) {
+            ASSERT(i + 1 < argc);
+            cacheMissTicks = atoi(argv[i + 1]);
+            ASSERT(cacheMissTicks >= 0);
+            i++;
+        } else if (strcmp(argv[i], "-cost") == 0) {
+            ASSERT(i + 1 < argc);
+            costModelFile = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "-smp") == 0) {
+            ASSERT(i + 1 < argc);
+            numCpus = atoi(argv[i + 1]);
+            ASSERT(numCpus >= 1);
+            i++;
+        } else if (strcmp(argv[i], "-smpquantum") == 0) {
+            ASSERT(i + 1 < argc);
+            cpuQuantum = atoi(argv[i + 1]);
+            ASSERT(cpuQuantum > 0);
+            i++;
+        } else if (strcmp(argv[i], "-stats-json") == 0) {
+            ASSERT(i + 1 < argc);
+            statsJsonFile = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "-stats-interval") == 0) {
+            ASSERT(i + 1 < argc);
+            statsInterval = atoi(argv[i + 1]);
+            ASSERT(statsInterval >= 0);
+            i++;
+        } else if (strcmp(argv[i], "-prof") == 0) {
+            ASSERT(i + 1 < argc);
+            profileInterval = atoi(argv[i + 1]);
+            ASSERT(profileInterval > 0);
+            i++;
+        } else if (strcmp(argv[i], "-hostperf") == 0) {
+            ASSERT(i + 1 < argc);
+            hostPerfRegions = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "-checkpoint") == 0) {
+            ASSERT(i + 2 < argc);
+            checkpointFile = argv[i + 1];
+            checkpointTick = atoi(argv[i + 2]);
+            i += 2;
+        } else if (strcmp(argv[i], "-restore") == 0) {
+            ASSERT(i + 1 < argc);
+            restoreFile = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "-record") == 0) {
+            ASSERT(i + 1 < argc);
+            recordFile = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "-replay") == 0) {
+            ASSERT(i + 1 < argc);
+            replayFile = argv[i + 1];
+            i++;
         } else if (strcmp(argv[i], "-e") == 0) {
             execfile[++execfileNum] = argv[++i];
             cout << execfile[execfileNum] << "\n";
@@ -85,6 +240,18 @@ Kernel::Kernel(int argc, char **argv) {
         } else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-rs randomSeed]\n";
             cout << "Partial usage: nachos [-s]\n";
+            cout << "Partial usage: nachos [-sim interp|block|jit]\n";
+            cout << "Partial usage: nachos [-tlb #] [-tlbways #] [-asid]\n";
+            cout << "Partial usage: nachos [-tlbpolicy random|fifo|lru|clock]\n";
+            cout << "Partial usage: nachos [-icache #] [-dcache #] [-cacheline #] [-cacheways #]\n";
+            cout << "Partial usage: nachos [-cachewrite back|through] [-cachehit #] [-cachemiss #]\n";
+            cout << "Partial usage: nachos [-cost costFile]\n";
+            cout << "Partial usage: nachos [-smp #] [-smpquantum #]\n";
+            cout << "Partial usage: nachos [-stats-json file] [-stats-interval #]\n";
+            cout << "Partial usage: nachos [-prof #]\n";
+            cout << "Partial usage: nachos [-hostperf interp,translate,tick,block|all|none]\n";
+            cout << "Partial usage: nachos [-checkpoint file #] [-restore file]\n";
+            cout << "Partial usage: nachos [-record file] [-replay file]\n";
             cout << "Partial usage: nachos [-ci consoleIn] [-co consoleOut]\n";
 #ifndef FILESYS_STUB
             cout << "Partial usage: nachos [-nf]\n";
@@ -92,6 +259,21 @@ Kernel::Kernel(int argc, char **argv) {
             cout << "Partial usage: nachos [-n #] [-m #]\n";
         }
     }
+    if ((checkpointFile != NULL || restoreFile != NULL) &&
+        (numCpus > 1 || tlbSize > 0 || icacheSize > 0 || dcacheSize > 0 ||
+         costModelFile != NULL || profileInterval > 0 ||
+         statsJsonFile != NULL)) {
+        cerr << "A checkpoint does not keep the state of -smp, -tlb, -icache, "
+                "-dcache, -cost, -prof or -stats-json\n";
+        ASSERT(FALSE);
+    }
+    if ((recordFile != NULL || replayFile != NULL) &&
+        (checkpointFile != NULL || restoreFile != NULL ||
+         (recordFile != NULL && replayFile != NULL))) {
+        cerr << "-record and -replay cannot be used together, or with "
+                "-checkpoint or -restore\n";
+        ASSERT(FALSE);
+    }
 }
 
 //----------------------------------------------------------------------
@@ -102,18 +284,66 @@ Kernel::Kernel(int argc, char **argv) {
 //----------------------------------------------------------------------
 
 void Kernel::Initialize() {
+    stats = new Statistics();  // collect statistics -- first, so
+                               // that it sees every thread
+    if (statsJsonFile != NULL) {
+        stats->OpenJson(statsJsonFile, statsInterval);
+    }
+    if (hostPerfRegions != NULL) {
+        stats->hostPerf = new HostPerf(hostPerfRegions);
+    }
+    if (recordFile != NULL || replayFile != NULL) {  // before the timer
+        interruptLog = new InterruptLog(
+            recordFile != NULL ? recordFile : replayFile, recordFile != NULL,
+            &randomSlice);
+    }
+
     // We didn't explicitly allocate the current thread we are running in.
     // But if it ever tries to give up the CPU, we better have a Thread
     // object to save its state.
 
     currentThread = new Thread("main", threadNum++);
     currentThread->setStatus(RUNNING);
+    hostThread = currentThread;
+    stats->SwitchThread(currentThread->threadStats);
 
-    stats = new Statistics();        // collect statistics
     interrupt = new Interrupt;       // start up interrupt handling
     scheduler = new Scheduler();     // initialize the ready queue
+    cpus = new Cpu *[numCpus];       // and those of the other CPUs
+    for (int i = 0; i < numCpus; i++) {
+        cpus[i] = new Cpu(i, i == 0 ? scheduler : new Scheduler());
+    }
+    cpu = cpus[0];
+    cpu->Runs(currentThread);
     alarm = new Alarm(randomSlice);  // start up time slicing
     machine = new Machine(debugUserProg);
+    machine->engine = simEngine;
+    if (tlbSize > 0) {
+        ASSERT(tlbWays == 0 || tlbSize % tlbWays == 0);
+        for (int i = 1; i < numCpus; i++) {  // each CPU has its own
+            machine->SwitchTLB(&cpu->tlb, &cpus[i]->tlb);
+            machine->EnableTLB(tlbSize, tlbWays > 0 ? tlbWays : tlbSize,
+                               tlbPolicy, tlbTagged);
+            machine->SwitchTLB(&cpus[i]->tlb, &cpu->tlb);
+        }
+        machine->EnableTLB(tlbSize, tlbWays > 0 ? tlbWays : tlbSize,
+                           tlbPolicy, tlbTagged);
+    }
+    if (icacheSize > 0 || dcacheSize > 0) {
+        machine->EnableCaches(
+            icacheSize == 0 ? NULL
+                            : new Cache("I-cache", icacheSize, cacheLineSize,
+                                        cacheWays, WriteBack, cacheHitTicks,
+                                        cacheMissTicks),
+            dcacheSize == 0 ? NULL
+                            : new Cache("D-cache", dcacheSize, cacheLineSize,
+                                        cacheWays, cacheWritePolicy,
+                                        cacheHitTicks, cacheMissTicks));
+    }
+    if (costModelFile != NULL) {
+        machine->costModel = new CostModel(costModelFile);
+    }
+    machine->hostPerf = stats->hostPerf;
     synchConsoleIn = new SynchConsoleInput(consoleIn);     // input from stdin
     synchConsoleOut = new SynchConsoleOutput(consoleOut);  // output to stdout
     synchDisk = new SynchDisk();                           //
@@ -131,12 +361,24 @@ void Kernel::Initialize() {
 //----------------------------------------------------------------------
 // Kernel::~Kernel
 // 	Nachos is halting.  De-allocate global data structures.
+//
+//	A batch job goes on to the next one instead of exiting, so first
+//	delete the thread that halted, and the host thread's own.  Threads
+//	still blocked or ready at Halt are not found, and leak.
 //----------------------------------------------------------------------
 
 Kernel::~Kernel() {
+    if (returnTo != NULL) {
+        scheduler->CheckToBeDestroyed();  // the thread that halted
+        currentThread = NULL;
+        delete hostThread;
+    }
     delete stats;
     delete interrupt;
-    delete scheduler;
+    for (int i = 0; i < numCpus; i++) {
+        delete cpus[i];  // and its scheduler
+    }
+    delete[] cpus;
     delete alarm;
     delete machine;
     delete synchConsoleIn;
@@ -145,8 +387,40 @@ Kernel::~Kernel() {
     delete fileSystem;
     // delete postOfficeIn;
     // delete postOfficeOut;
+    delete interruptLog;  // write out the rest of a recording
+    delete trace;  // write out any buffered trace records
+    trace = NULL;
 
-    Exit(0);
+    if (returnTo == NULL) {
+        Exit(0);
+    }
+}
+
+//----------------------------------------------------------------------
+// Kernel::ReturnToHost
+// 	Called at Halt, when running as a batch job: go back to the host
+//	thread's own stack, and from there to the batch driver, which
+//	deletes the kernel and runs the next job.
+//
+//	Only the thread that Kernel::Initialize found running on the host
+//	thread's stack can get back to the driver.  If it is not the one
+//	halting, we switch to it, wherever it is blocked or ready; it
+//	then finds "halted" set, and calls us again.
+//----------------------------------------------------------------------
+
+void Kernel::ReturnToHost() {
+    Thread *oldThread = currentThread;
+
+    ASSERT(returnTo != NULL);
+    halted = TRUE;
+    if (oldThread != hostThread) {
+        (void)interrupt->SetLevel(IntOff);
+        scheduler->DestroyLater(oldThread);
+        currentThread = hostThread;
+        SWITCH(oldThread, hostThread);
+        ASSERTNOTREACHED();
+    }
+    longjmp(*returnTo, 1);
 }
 
 //----------------------------------------------------------------------
@@ -8,8 +8,12 @@
 #ifndef KERNEL_H
 #define KERNEL_H
 
+#include <setjmp.h>
+
 #include "alarm.h"
+#include "cache.h"
 #include "copyright.h"
+#include "cpu.h"
 #include "debug.h"
 #include "filesys.h"
 #include "interrupt.h"
@@ -19,6 +23,8 @@
 #include "thread.h"
 #include "utility.h"
 
+class CheckpointFile;
+class InterruptLog;
 class PostOfficeInput;
 class PostOfficeOutput;
 class SynchConsoleInput;
@@ -52,11 +58,35 @@ class Kernel {
     int ReadFile(char *buffer, int size, OpenFileId id);   // fileSystem call
     int CloseFile(OpenFileId id);                          // fileSystem call
 
+    // Running more than one CPU (see cpu.h)
+
+    void NextCpu();  // pass the turn on to the next CPU
+    void IdleCpu(bool finishing);
+    // the current thread is blocked, or
+    // done, and its CPU has nothing to run
+    Thread *FindNextToRun(Cpu *forCpu);  // a ready thread for "forCpu",
+                                         // taken from another if need be
+    void Balance();  // even out the ready queues a little
+    void FlushTLBs(int asid);  // FlushTLB on every CPU
+
+    void ReturnToHost();  // a batch job has halted: return to the
+                          // host thread that started it (see batch.h)
+
+    // Checkpoints (see checkpoint.h)
+
+    void CheckpointIfDue();  // -checkpoint: take it, if it is time
+                             // and it can be taken now
+    void Restore();          // -restore: carry on from the checkpoint
+
     // These are public for notational convenience; really,
     // they're global variables used everywhere.
 
     Thread *currentThread;  // the thread holding the CPU
-    Scheduler *scheduler;   // the ready list
+    Scheduler *scheduler;   // the ready list (of the running CPU)
+    Cpu *cpu;               // the running CPU
+    Cpu **cpus;             // all of them, numCpus in all
+    int numCpus;            // simulated CPUs, 1 unless -smp
+    int cpuQuantum;         // ticks in each CPU's turn (-smpquantum)
     Interrupt *interrupt;   // interrupt status
     Statistics *stats;      // performance metrics
     Alarm *alarm;           // the software alarm clock
@@ -69,12 +99,42 @@ class Kernel {
     PostOfficeOutput *postOfficeOut;
     bool execExit;       // exit if all threads are finished
     int execRunningNum;  // number of running threads
+    int profileInterval;  // ticks between profile samples, 0 if
+                          // user programs are not profiled
 
     int hostName;  // machine identifier
     int frameTable[NumPhysPages];
     int NumFreeFrame;
+    AddrSpace *asidOwner[MaxAddrSpaces];  // the address space with each
+                                          // ASID, or NULL
+
+    int outputFileNo;  // where console output goes without -co:
+                       // stdout, or the output file of a batch job
+    jmp_buf *returnTo;   // where to go back to at Halt, if this is a
+                         // batch job; NULL to exit
+    Thread *hostThread;  // the thread on the host thread's own stack
+    bool halted;         // TRUE once a batch job has halted
+
+    char *checkpointFile;  // where to write a checkpoint, or NULL if
+                           // there is none (left) to take
+    int checkpointTick;    // when to take it, at the earliest
+    char *restoreFile;     // the checkpoint to start from, or NULL
+    char *recordFile;      // where to record the interrupts, or NULL
+    char *replayFile;      // the interrupt log to replay, or NULL
+    InterruptLog *interruptLog;  // the one being recorded or replayed,
+                                 // if either (see machine/intlog.h)
 
    private:
+    Cpu *BusiestCpu();  // the CPU with the most ready threads
+    void Dispatch(Cpu *toCpu, Thread *thread);
+    // start "thread" on the idle "toCpu"
+    void SwitchCpu(Cpu *toCpu, Thread *nextThread);
+    // give the host to "toCpu", running
+    // "nextThread"
+    bool CanCheckpoint();  // TRUE if every thread can be restarted
+    void Checkpoint(CheckpointFile *file);
+    // write the state out, or read it in
+
     Thread *t[10];
     char *execfile[10];
     /* MP3 */
@@ -84,6 +144,24 @@ class Kernel {
     int threadNum;
     bool randomSlice;    // enable pseudo-random time slicing
     bool debugUserProg;  // single step user program
+    SimEngine simEngine;  // how the machine executes user code
+    int tlbSize;          // entries in the simulated TLB, 0 for none
+    int tlbWays;          // entries in each set of it, 0 for all
+    TLBPolicy tlbPolicy;  // how it picks an entry to replace
+    bool tlbTagged;       // tag its entries with ASIDs
+    int icacheSize;       // bytes in the simulated instruction and
+    int dcacheSize;       // data caches, 0 for none
+    int cacheLineSize;    // bytes in each of their lines
+    int cacheWays;        // lines in each set
+    CacheWritePolicy cacheWritePolicy;  // what stores do
+    int cacheHitTicks;    // extra time taken by a hit
+    int cacheMissTicks;   // extra time taken by a miss
+    char *costModelFile;  // cycles taken by each instruction, or NULL
+                          // for one tick each
+    char *statsJsonFile;  // file to write statistics to, as JSON
+    int statsInterval;    // ticks between snapshots written to it
+    char *hostPerfRegions;  // the regions -hostperf measures, or NULL
+                            // to leave the host's counters alone
     double reliability;  // likelihood messages are dropped
     char *consoleIn;     // file to read console input from
     char *consoleOut;    // file to send console output to
@@ -92,4 +170,8 @@ class Kernel {
 #endif
 };
 
+// The procedure each thread forked by Kernel::Exec runs: load the
+// program it is named after, and run it
+extern void ForkExecute(Thread *t);
+
 #endif  // KERNEL_H
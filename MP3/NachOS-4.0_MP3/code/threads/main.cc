@@ -7,13 +7,92 @@
 //              -f -cp <unix file> <nachos file>
 //              -p <nachos file> -r <nachos file> -l -D
 //              -n <network reliability> -m <machine id>
-//              -z -K -C -N
+//              -z -K -C -N -B -sim <engine>
+//              -trace <trace file> -tracedump <trace file>
+//              -tlb <entries> -tlbways <ways> -tlbpolicy <policy> -asid
+//              -icache <bytes> -dcache <bytes> -cacheline <bytes>
+//              -cacheways <ways> -cachewrite <policy>
+//              -cachehit <ticks> -cachemiss <ticks> -cost <cost file>
+//              -stats-json <file> -stats-interval <ticks> -prof <ticks>
+//              -hostperf <regions>
+//              -smp <cpus> -smpquantum <ticks>
+//              -batch <job file> -jobs <n>
+//              -checkpoint <file> <tick> -restore <file>
+//              -record <file> -replay <file>
 //
 //    -d causes certain debugging messages to be printed (see debug.h)
+//    -trace writes the per-instruction and per-tick messages enabled by -d
+//       ("m" and "i") to a binary trace file, instead of printing them
+//    -tracedump prints a trace file written by -trace, then exits
 //    -rs causes Yield to occur at random (but repeatable) spots
 //    -z prints the copyright message
 //    -s causes user programs to be executed in single-step mode
 //    -x runs a user program
+//    -sim selects how user code is simulated: "interp" (the default),
+//       "block" (basic blocks translated to threaded code) or "jit"
+//       (as "block", with the hot blocks compiled to host code)
+//    -tlb translates user addresses through a TLB of the given size,
+//       loaded by the kernel on each miss, instead of the page table
+//       (under "-sim block" and "jit", instruction fetches only go
+//       through the TLB once per basic block)
+//    -tlbways sets how many TLB entries are in each set, at least 2 (the
+//       default is all of them: fully associative)
+//    -tlbpolicy picks the TLB entry to replace: "random" (the default),
+//       "fifo", "lru" or "clock"
+//    -asid tags TLB entries by address space, so that context switches
+//       need not flush the TLB
+//    -icache and -dcache simulate an instruction and a data cache of the
+//       given size, and charge user programs for their misses.  They
+//       have -cacheline byte lines (16 by default), -cacheways lines to
+//       a set (1 by default: direct mapped) and LRU replacement; the
+//       data cache is "back" (write-back, the default) or "through"
+//       (write-through), as -cachewrite says.  A hit costs -cachehit
+//       extra ticks (0 by default), and each trip to memory -cachemiss
+//       (10 by default).  Implies "-sim interp"
+//    -cost charges each user instruction the cycles given for it in the
+//       cost file, with load-use and taken-branch penalties and multiply
+//       and divide latencies (see machine/costmodel.h for the format),
+//       instead of one tick each.  The statistics then include the
+//       cycles per instruction (CPI) of each thread.  Implies "-sim interp"
+//    -smp simulates a multiprocessor with the given number of CPUs, each
+//       with its own ready queues and TLB, taking turns of -smpquantum
+//       ticks (10 by default) while the clock stands still (see
+//       threads/cpu.h).  The statistics then include how busy each CPU
+//       was.  Cache misses and -cost cycles still advance the one clock
+//    -stats-json writes the statistics, per thread, system call and
+//       device, to a file as JSON: one line at Halt, and one on the first
+//       timer interrupt after every -stats-interval ticks (10000 by
+//       default; 0 for none) before that
+//    -prof profiles each user program: counts every basic block it runs,
+//       and samples its PC (and call stack) on the timer interrupt, at
+//       most once per the given number of ticks.  On exit, writes
+//       <program>.prof (flat profile and blocks) and <program>.folded
+//       (call stacks, for flame graphs), naming functions from the
+//       <program>.sym file written by coff2noff.  Implies "-sim interp"
+//    -hostperf counts the host's own cycles, instructions and cache
+//       misses (or, where perf events are not available, the time-stamp
+//       counter) and prints them per simulated instruction at Halt, on
+//       stderr: in all, and in each of the regions named, separated by
+//       commas: "interp", "translate", "tick", "block", "all" or
+//       "none" (see machine/hostperf.h).  Each region measured slows
+//       the simulation down
+//    -batch runs many simulations in this one process, one for each line
+//       of the job file (the flags for that simulation), -jobs of them at
+//       a time (1 by default), each on a host thread of its own.  The
+//       output of the simulation on line n goes to <job file>.n.out (see
+//       threads/batch.h).  Any other flags are ignored
+//    -checkpoint saves the state of the simulation to a file, as soon
+//       after the given tick as every thread is in user code and none
+//       is blocked; -restore starts from such a file, instead of
+//       running the -e programs, and goes on as the first run did (see
+//       threads/checkpoint.h for what is kept, and what is not).  Not
+//       with -smp, -tlb, -icache, -dcache, -cost, -prof or -stats-json
+//    -record logs every interrupt delivered, and the console input and
+//       network packets that arrive, to a file; -replay runs again
+//       from such a file, taking the input and the -rs setting from
+//       it instead of the host, and checks that it delivers the same
+//       interrupts (see machine/intlog.h).  The programs and other
+//       flags must be the same.  Not with -checkpoint or -restore
 //    -ci specify file for console input (stdin is the default)
 //    -co specify file for console output (stdout is the default)
 //    -n sets the network reliability
@@ -21,6 +100,7 @@
 //    -K run a simple self test of kernel threads and synchronization
 //    -C run an interactive console test
 //    -N run a two-machine network test (see Kernel::NetworkTest)
+//    -B time the heap used for pending interrupts against a sorted list
 //
 //    Filesystem-related flags:
 //    -f forces the Nachos disk to be formatted
@@ -41,14 +121,18 @@
 #include "copyright.h"
 #undef MAIN
 
+#include "batch.h"
 #include "filesys.h"
+#include "libtest.h"
 #include "main.h"
 #include "openfile.h"
 #include "sysdep.h"
+#include "trace.h"
 
-// global variables
-Kernel *kernel;
-Debug *debug;
+// global variables, one set for each simulation (see batch.h)
+THREAD_LOCAL Kernel *kernel;
+THREAD_LOCAL Debug *debug;
+THREAD_LOCAL Trace *trace;
 
 //----------------------------------------------------------------------
 // Cleanup
@@ -143,11 +227,8 @@ void Print(char *name) {
 
 //----------------------------------------------------------------------
 // main
-// 	Bootstrap the operating system kernel.
-//
-//	Initialize kernel data structures
-//	Call some test routines
-//	Call "Run" to start an initial user program running
+// 	Bootstrap the operating system kernel, or with -batch, run a
+//	batch of simulations, each of which does.
 //
 //	"argc" is the number of command line arguments (including the name
 //		of the command) -- ex: "nachos -d +" -> argc = 3
@@ -156,12 +237,50 @@ void Print(char *name) {
 //----------------------------------------------------------------------
 
 int main(int argc, char **argv) {
+    char *jobFileName = NULL;
+    int numJobs = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-batch") == 0) {
+            ASSERT(i + 1 < argc);
+            jobFileName = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "-jobs") == 0) {
+            ASSERT(i + 1 < argc);
+            numJobs = atoi(argv[i + 1]);
+            ASSERT(numJobs > 0);
+            i++;
+        }
+    }
+    if (jobFileName != NULL) {
+        return RunBatch(jobFileName, numJobs);
+    }
+    return RunNachos(argc, argv, NULL, 1);
+}
+
+//----------------------------------------------------------------------
+// RunNachos
+// 	Run one simulation.
+//
+//	Initialize kernel data structures
+//	Call some test routines
+//	Call "Run" to start an initial user program running
+//
+//	"argc", "argv" -- the command line, as for main
+//	"returnTo" -- for a batch job, where to go back to once the
+//		simulation halts; NULL to exit from Nachos instead
+//	"outputFileNo" -- where console output goes, unless -co says
+//----------------------------------------------------------------------
+
+int RunNachos(int argc, char **argv, jmp_buf *returnTo, int outputFileNo) {
     int i;
     char *debugArg = "";
+    char *traceFileName = NULL;  // default is to print trace records
     char *userProgName = NULL;  // default is not to execute a user prog
     bool threadTestFlag = false;
     bool consoleTestFlag = false;
     bool networkTestFlag = false;
+    bool queueBenchFlag = false;
 #ifndef FILESYS_STUB
     char *copyUnixFileName = NULL;    // UNIX file to be copied into Nachos
     char *copyNachosFileName = NULL;  // name of copied file in Nachos
@@ -179,6 +298,14 @@ int main(int argc, char **argv) {
             ASSERT(i + 1 < argc);  // next argument is debug string
             debugArg = argv[i + 1];
             i++;
+        } else if (strcmp(argv[i], "-trace") == 0) {
+            ASSERT(i + 1 < argc);
+            traceFileName = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "-tracedump") == 0) {
+            ASSERT(i + 1 < argc);
+            Trace::Decode(argv[i + 1]);
+            return 0;
         } else if (strcmp(argv[i], "-z") == 0) {
             cout << copyright << "\n";
         } else if (strcmp(argv[i], "-x") == 0) {
@@ -191,6 +318,8 @@ int main(int argc, char **argv) {
             consoleTestFlag = TRUE;
         } else if (strcmp(argv[i], "-N") == 0) {
             networkTestFlag = TRUE;
+        } else if (strcmp(argv[i], "-B") == 0) {
+            queueBenchFlag = TRUE;
         }
 #ifndef FILESYS_STUB
         else if (strcmp(argv[i], "-cp") == 0) {
@@ -214,8 +343,11 @@ int main(int argc, char **argv) {
 #endif  // FILESYS_STUB
         else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-z -d debugFlags]\n";
+            cout << "Partial usage: nachos [-trace traceFile]\n";
+            cout << "Partial usage: nachos [-tracedump traceFile]\n";
             cout << "Partial usage: nachos [-x programName]\n";
-            cout << "Partial usage: nachos [-K] [-C] [-N]\n";
+            cout << "Partial usage: nachos [-K] [-C] [-N] [-B]\n";
+            cout << "Partial usage: nachos [-batch jobFile] [-jobs n]\n";
 #ifndef FILESYS_STUB
             cout << "Partial usage: nachos [-cp UnixFile NachosFile]\n";
             cout << "Partial usage: nachos [-p fileName] [-r fileName]\n";
@@ -224,14 +356,19 @@ int main(int argc, char **argv) {
         }
     }
     debug = new Debug(debugArg);
+    trace = new Trace(traceFileName);
 
     DEBUG(dbgThread, "Entering main");
 
     kernel = new Kernel(argc, argv);
+    kernel->returnTo = returnTo;
+    kernel->outputFileNo = outputFileNo;
 
     kernel->Initialize();
 
-    CallOnUserAbort(Cleanup);  // if user hits ctl-C
+    if (returnTo == NULL) {
+        CallOnUserAbort(Cleanup);  // if user hits ctl-C
+    }
 
     // at this point, the kernel is ready to do something
     // run some tests, if requested
@@ -244,6 +381,9 @@ int main(int argc, char **argv) {
     if (networkTestFlag) {
         kernel->NetworkTest();  // two-machine test of the network
     }
+    if (queueBenchFlag) {
+        QueueBenchmark();  // time the pending-interrupt queue
+    }
 
 #ifndef FILESYS_STUB
     if (removeFileName != NULL) {
@@ -263,8 +403,12 @@ int main(int argc, char **argv) {
     }
 #endif  // FILESYS_STUB
 
-    // finally, run an initial user program if requested to do so
+    // finally, run an initial user program if requested to do so,
+    // or carry on from a checkpoint
 
+    if (kernel->restoreFile != NULL) {
+        kernel->Restore();
+    }
     kernel->ExecAll();
     // If we don't run a user program, we may get here.
     // Calling "return" would terminate the program.
@@ -12,7 +12,11 @@
 #include "debug.h"
 #include "kernel.h"
 
-extern Kernel *kernel;
-extern Debug *debug;
+extern THREAD_LOCAL Kernel *kernel;
+extern THREAD_LOCAL Debug *debug;
+
+// Run one simulation, with the given command line (see main.cc)
+extern int RunNachos(int argc, char **argv, jmp_buf *returnTo,
+                     int outputFileNo);
 
 #endif  // MAIN_H
@@ -4,7 +4,11 @@
 //
 // 	These routines assume that interrupts are already disabled.
 //	If interrupts are disabled, we can assume mutual exclusion
-//	(since we are on a uniprocessor).
+//	(since we are on a uniprocessor, or with -smp, since no other
+//	CPU runs until interrupts are enabled again; see cpu.h).
+//
+//	With -smp, each CPU has a Scheduler of its own, and
+//	kernel->scheduler is that of the running CPU.
 //
 // 	NOTE: We can't use Locks to provide mutual exclusion here, since
 // 	if we needed to wait for a lock, and the lock was busy, we would
@@ -20,6 +24,7 @@
 
 #include "scheduler.h"
 
+#include "checkpoint.h"
 #include "copyright.h"
 #include "debug.h"
 #include "main.h"
@@ -27,6 +32,8 @@
 static int L1Cmp(Thread *newThread, Thread *cmpThread);
 static int L2Cmp(Thread *newThread, Thread *cmpThread);
 
+THREAD_LOCAL Thread *Scheduler::toBeDestroyed = NULL;
+
 //----------------------------------------------------------------------
 // Scheduler::Scheduler
 // 	Initialize the list of ready but not running threads.
@@ -38,7 +45,6 @@ Scheduler::Scheduler() {
     L1 = new SortedList<Thread *>(L1Cmp);
     L2 = new SortedList<Thread *>(L2Cmp);
     L3 = new List<Thread *>;
-    toBeDestroyed = NULL;
 }
 
 //----------------------------------------------------------------------
@@ -58,15 +64,20 @@ Scheduler::~Scheduler() {
 // 	Mark a thread as ready, but not running.
 //	Put it on the ready list, for later scheduling onto the CPU.
 //
-//	"thread" is the thread to be put on the ready list.
+//	"thread" is the thread to be put on the ready list.  It may
+//	already be ready, taken off the list of another CPU.
 //----------------------------------------------------------------------
 
 void Scheduler::ReadyToRun(Thread *thread) {
     ASSERT(kernel->interrupt->getLevel() == IntOff);
     DEBUG(dbgThread, "Putting thread on ready list: " << thread->getName());
     // cout << "Putting thread on ready list: " << thread->getName() << endl;
-    thread->setStatus(READY);
-    thread->TimeUpdate_ToReady(kernel->stats->totalTicks);
+    if (thread->getStatus() != READY) {  // not just moving between CPUs
+        kernel->stats->ThreadReady(thread->threadStats,
+                                   thread->getStatus() == BLOCKED);
+        thread->setStatus(READY);
+        thread->TimeUpdate_ToReady(kernel->stats->totalTicks);
+    }
 
     // readyList->Append(thread);
     DEBUG(dbgThread, ":D, " << thread->getID() << ": "
@@ -157,8 +168,7 @@ void Scheduler::Run(Thread *nextThread, bool finishing) {
     ASSERT(kernel->interrupt->getLevel() == IntOff);
 
     if (finishing) {  // mark that we need to delete current thread
-        ASSERT(toBeDestroyed == NULL);
-        toBeDestroyed = oldThread;
+        DestroyLater(oldThread);
     }
 
     if (oldThread->space != NULL) {  // if this thread is a user program,
@@ -170,6 +180,8 @@ void Scheduler::Run(Thread *nextThread, bool finishing) {
                                  // had an undetected stack overflow
 
     kernel->currentThread = nextThread;  // switch to the next thread
+    kernel->cpu->Runs(nextThread);
+    kernel->stats->SwitchThread(nextThread->threadStats);
     nextThread->setStatus(RUNNING);      // nextThread is now running
     nextThread->TimeUpdate_ToRun(kernel->stats->totalTicks);
     DEBUG(dbgThread, "Updated startRunning time: "
@@ -186,6 +198,9 @@ void Scheduler::Run(Thread *nextThread, bool finishing) {
                          << oldThread->getName()
                          << " status: " << oldThread->getStatus());
     SWITCH(oldThread, nextThread);
+    if (kernel->halted) {        // a batch job halted, while we were
+        kernel->ReturnToHost();  // switched out: go back to the host
+    }
     DEBUG(dbgThread, "After SWITCH(), oldThread "
                          << oldThread->getName()
                          << " status: " << oldThread->getStatus());
@@ -217,11 +232,35 @@ void Scheduler::Run(Thread *nextThread, bool finishing) {
 
 void Scheduler::CheckToBeDestroyed() {
     if (toBeDestroyed != NULL) {
-        delete toBeDestroyed;
+        // in a batch job, the host thread's own is needed at Halt, to
+        // get back to the batch driver (see Kernel::ReturnToHost)
+        if (kernel->returnTo == NULL || toBeDestroyed != kernel->hostThread) {
+            delete toBeDestroyed;
+        }
         toBeDestroyed = NULL;
     }
 }
 
+//----------------------------------------------------------------------
+// Scheduler::DestroyLater
+// 	Note that "thread" has finished, and is to be deleted by
+//	CheckToBeDestroyed, once we're no longer running on its stack.
+//----------------------------------------------------------------------
+
+void Scheduler::DestroyLater(Thread *thread) {
+    ASSERT(toBeDestroyed == NULL);
+    toBeDestroyed = thread;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::NumReady
+// 	Return the number of threads on the ready list.
+//----------------------------------------------------------------------
+
+int Scheduler::NumReady() {
+    return L1->NumInList() + L2->NumInList() + L3->NumInList();
+}
+
 //----------------------------------------------------------------------
 // Scheduler::Print
 // 	Print the scheduler state -- in other words, the contents of
@@ -232,6 +271,63 @@ void Scheduler::Print() {
     // readyList->Apply(ThreadPrint);
 }
 
+//----------------------------------------------------------------------
+// Scheduler::AllResumable
+// 	Return TRUE if every thread on the ready list could be started
+//	again from a checkpoint: it has not run yet, or was preempted
+//	while running user code (see Thread::Resume).
+//----------------------------------------------------------------------
+
+bool Scheduler::AllResumable() {
+    List<Thread *> *queues[3] = {L1, L2, L3};
+
+    for (int i = 0; i < 3; i++) {
+        ListIterator<Thread *> iterator(queues[i]);
+
+        for (; !iterator.IsDone(); iterator.Next()) {
+            Thread *thread = iterator.Item();
+
+            if (thread->cpuId != -1 && !thread->preempted) {
+                return FALSE;
+            }
+        }
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Checkpoint
+// 	Write out the threads on the ready list, in order, or read them
+//	back in.  The threads read in are new, and are put back on the
+//	queues they were on, in the same order -- even if their
+//	priorities have changed since they were sorted.
+//----------------------------------------------------------------------
+
+void Scheduler::Checkpoint(CheckpointFile *file) {
+    List<Thread *> *queues[3] = {L1, L2, L3};
+
+    for (int i = 0; i < 3; i++) {
+        int numThreads = queues[i]->NumInList();
+
+        file->Int(&numThreads);
+        if (file->IsWriting()) {
+            ListIterator<Thread *> iterator(queues[i]);
+
+            for (; !iterator.IsDone(); iterator.Next()) {
+                iterator.Item()->Checkpoint(file);
+            }
+        } else {
+            for (int j = 0; j < numThreads; j++) {
+                Thread *thread = new Thread("checkpoint", 0);
+
+                thread->Checkpoint(file);
+                thread->Resume();
+                queues[i]->List<Thread *>::Append(thread);
+            }
+        }
+    }
+}
+
 int Scheduler::Aging() {
     ListIterator<Thread *> *iterator;
     Thread *thread;
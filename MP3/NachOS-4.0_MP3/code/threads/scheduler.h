@@ -30,8 +30,18 @@ class Scheduler {
     // Cause nextThread to start running
     void CheckToBeDestroyed();  // Check if thread that had been
                                 // running needs to be deleted
+    void DestroyLater(Thread* thread);
+    // Have "thread" deleted by the
+    // next thread that runs
+    int NumReady();  // Number of threads on the ready list
     void Print();               // Print contents of ready list
 
+    bool AllResumable();  // can every ready thread be restarted
+                          // from a checkpoint?
+    void Checkpoint(CheckpointFile* file);
+    // write out, or read in, the ready
+    // threads (see checkpoint.h)
+
     // SelfTest for scheduler is implemented in class Thread
 
     int CheckYield(Thread* currThread);
@@ -49,8 +59,10 @@ class Scheduler {
     SortedList<Thread*>* L1;
     SortedList<Thread*>* L2;
     List<Thread*>* L3;
-    Thread* toBeDestroyed;  // finishing thread to be destroyed
-                            // by the next thread that runs
+    static THREAD_LOCAL Thread* toBeDestroyed;
+    // finishing thread to be destroyed by
+    // the next thread that runs, on
+    // whichever CPU
 };
 
 #endif  // SCHEDULER_H
@@ -6,7 +6,7 @@
  *	call frame, etc, are all specific to a processor architecture.
  *
  * 	This file currently supports the DEC MIPS, DEC Alpha, SUN SPARC,
- *  HP PARISC, IBM PowerPC, and Intel x86 architectures.
+ *  HP PARISC, IBM PowerPC, Intel x86 and x86-64 architectures.
  */
 
 /*
@@ -156,6 +156,36 @@
 
 #endif  // x86
 
+#ifdef x86_64
+
+/* the offsets of the registers from the beginning of the thread object.
+ * Only the registers the System V ABI asks a callee to preserve are
+ * saved, since SWITCH is called like any other function.
+ */
+#define _RSP 0
+#define _RBX 8
+#define _RBP 16
+#define _R12 24
+#define _R13 32
+#define _R14 40
+#define _R15 48
+#define _PC 56
+
+/* These definitions are used in Thread::AllocateStack(). */
+#define PCState (_PC / 8 - 1)
+#define FPState (_RBP / 8 - 1)
+#define InitialPCState (_R12 / 8 - 1)
+#define InitialArgState (_R13 / 8 - 1)
+#define WhenDonePCState (_R14 / 8 - 1)
+#define StartupPCState (_R15 / 8 - 1)
+
+#define InitialPC %r12
+#define InitialArg %r13
+#define WhenDonePC %r14
+#define StartupPC %r15
+
+#endif  // x86_64
+
 #ifdef PowerPC
 
 #define SP 0  // stack pointer
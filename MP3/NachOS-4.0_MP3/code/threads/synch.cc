@@ -125,7 +125,7 @@ void Semaphore::V() {
 //	to control two threads ping-ponging back and forth.
 //----------------------------------------------------------------------
 
-static Semaphore *ping;
+static THREAD_LOCAL Semaphore *ping;
 static void SelfTestHelper(Semaphore *pong) {
     for (int i = 0; i < 10; i++) {
         ping->P();
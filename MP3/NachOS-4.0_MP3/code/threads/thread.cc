@@ -18,6 +18,7 @@
 
 #include "thread.h"
 
+#include "checkpoint.h"
 #include "copyright.h"
 #include "switch.h"
 #include "synch.h"
@@ -50,6 +51,13 @@ Thread::Thread(char *threadName, int threadID) {
                                  // of machine registers
     }
     space = NULL;
+    last_approximatedBurstTime = 0;
+    timeStamp_startRunning = 0;  // the main thread starts running
+    timeStamp_startReady = 0;    // without either being set
+    totalReadyTime = 0;
+    threadStats = kernel->stats->NewThread(threadName, threadID);
+    cpuId = -1;
+    preempted = FALSE;
     TimeUpdate_NewToReady();
 }
 
@@ -98,7 +106,7 @@ void Thread::Fork(VoidFunctionPtr func, void *arg) {
     IntStatus oldLevel;
 
     DEBUG(dbgThread,
-          "Forking thread: " << name << " f(a): " << (int)func << " " << arg);
+          "Forking thread: " << name << " f(a): " << (void *)func << " " << arg);
     StackAllocate(func, arg);
 
     oldLevel = interrupt->SetLevel(IntOff);
@@ -123,11 +131,15 @@ void Thread::Fork(VoidFunctionPtr func, void *arg) {
 //----------------------------------------------------------------------
 
 void Thread::CheckOverflow() {
+    // The fencepost is only ever overwritten behind the compiler's back,
+    // so make sure it really reads the stack each time.
+    volatile int *fence = stack;
+
     if (stack != NULL) {
 #ifdef HPUX  // Stacks grow upward on the Snakes
-        ASSERT(stack[StackSize - 1] == STACK_FENCEPOST);
+        ASSERT(fence[StackSize - 1] == STACK_FENCEPOST);
 #else
-        ASSERT(*stack == STACK_FENCEPOST);
+        ASSERT(*fence == STACK_FENCEPOST);
 #endif
     }
 }
@@ -154,6 +166,27 @@ void Thread::Begin() {
     }
 }
 
+//----------------------------------------------------------------------
+// Thread::ResumeUser
+// 	Called by ThreadRoot, instead of Begin, when a thread restored
+//	from a checkpoint first runs again.  The thread was preempted
+//	from user code by the timer; so finish the context switch, and
+//	the Yield it was in, then carry on with the user program.
+//----------------------------------------------------------------------
+
+void Thread::ResumeUser() {
+    ASSERT(this == kernel->currentThread);
+    DEBUG(dbgThread, "Resuming thread: " << name);
+
+    kernel->scheduler->CheckToBeDestroyed();
+    RestoreUserState();
+    space->RestoreState();
+    preempted = FALSE;
+    kernel->interrupt->Enable();
+    kernel->machine->Run();  // never returns
+    ASSERTNOTREACHED();
+}
+
 //----------------------------------------------------------------------
 // Thread::Finish
 // 	Called by ThreadRoot when a thread is done executing the
@@ -238,7 +271,8 @@ void Thread::Yield() {  // time sharing
 //	we have no thread to run.  "Interrupt::Idle" is called
 //	to signify that we should idle the CPU until the next I/O interrupt
 //	occurs (the only thing that could cause a thread to become
-//	ready to run).
+//	ready to run).  With more than one CPU, this CPU is left idle
+//	instead, while the others go on (see Kernel::IdleCpu).
 //
 //	NOTE: we assume interrupts are already disabled, because it
 //	is called from the synchronization routines which must
@@ -258,18 +292,27 @@ void Thread::Sleep(bool finishing) {  // finish v I/O etc.
                           << name << ", " << kernel->stats->totalTicks);
 
     status = BLOCKED;
+    kernel->stats->ThreadBlocked(threadStats, finishing);
     // cout << "debug Thread::Sleep " << name << "wait for Idle\n";
-    while ((nextThread = kernel->scheduler->FindNextToRun()) == NULL) {
-        kernel->interrupt->Idle();  // no one to run, wait for an interrupt
+    if (kernel->numCpus > 1) {
+        // with other CPUs to make progress, just leave this one idle
+        nextThread = kernel->FindNextToRun(kernel->cpu);
+    } else {
+        while ((nextThread = kernel->scheduler->FindNextToRun()) == NULL) {
+            kernel->interrupt->Idle();  // no one to run, wait for an interrupt
+        }
     }
     // returns when it's time for us to run
-    DEBUG(dbgZ, "[E] Tick ["
-                    << kernel->stats->totalTicks << "]: Thread ["
-                    << nextThread->getID()
-                    << "] is now selected for execution, thread ["
-                    << this->getID() << "] is replaced, and it has executed ["
-                    << kernel->stats->totalTicks - timeStamp_startRunning
-                    << "] ticks");
+    if (nextThread != NULL) {
+        DEBUG(dbgZ, "[E] Tick ["
+                        << kernel->stats->totalTicks << "]: Thread ["
+                        << nextThread->getID()
+                        << "] is now selected for execution, thread ["
+                        << this->getID()
+                        << "] is replaced, and it has executed ["
+                        << kernel->stats->totalTicks - timeStamp_startRunning
+                        << "] ticks");
+    }
     if (!finishing) {
         TimeUpdate_RunningToWaiting(kernel->stats->totalTicks);
         DEBUG(dbgZ, "[D] Tick ["
@@ -280,7 +323,11 @@ void Thread::Sleep(bool finishing) {  // finish v I/O etc.
                         << kernel->stats->totalTicks - timeStamp_startRunning
                         << "], to [" << curr_approximatedBurstTime << "]");
     }
-    kernel->scheduler->Run(nextThread, finishing);
+    if (nextThread == NULL) {
+        kernel->IdleCpu(finishing);
+    } else {
+        kernel->scheduler->Run(nextThread, finishing);
+    }
 }
 
 //----------------------------------------------------------------------
@@ -293,6 +340,7 @@ void Thread::Sleep(bool finishing) {  // finish v I/O etc.
 
 static void ThreadFinish() { kernel->currentThread->Finish(); }
 static void ThreadBegin() { kernel->currentThread->Begin(); }
+static void ThreadResumeUser() { kernel->currentThread->ResumeUser(); }
 void ThreadPrint(Thread *t) { t->Print(); }
 
 #ifdef PARISC
@@ -366,11 +414,24 @@ void Thread::StackAllocate(VoidFunctionPtr func, void *arg) {
     // the x86 passes the return address on the stack.  In order for SWITCH()
     // to go to ThreadRoot when we switch to this thread, the return addres
     // used in SWITCH() must be the starting address of ThreadRoot.
-    stackTop = stack + StackSize - 4;  // -4 to be on the safe side!
+    // ThreadRoot pushes two words before it calls anything, so start it
+    // with the stack pointer 8 bytes off a 16 byte boundary: then the
+    // calls are aligned as the compiler assumes (it may use SSE spills).
+    stackTop = stack + StackSize - 6;
     *(--stackTop) = (int)ThreadRoot;
     *stack = STACK_FENCEPOST;
 #endif
 
+#ifdef x86_64
+    // Same as x86, but the return address takes two words.  The slot is
+    // placed so that ThreadRoot starts with the stack pointer 8 bytes
+    // off a 16 byte boundary, as the System V ABI expects on entry.
+    stackTop = stack + StackSize - 6;
+    stackTop -= 2;
+    *(void **)stackTop = (void *)ThreadRoot;
+    *stack = STACK_FENCEPOST;
+#endif
+
 #ifdef PARISC
     machineState[PCState] = PLabelToAddr(ThreadRoot);
     machineState[StartupPCState] = PLabelToAddr(ThreadBegin);
@@ -386,6 +447,75 @@ void Thread::StackAllocate(VoidFunctionPtr func, void *arg) {
 #endif
 }
 
+//----------------------------------------------------------------------
+// Thread::Resume
+// 	Make a thread that has been read in from a checkpoint ready to be
+//	switched to.  Its kernel stack was not saved, so it gets a new
+//	one: a thread that had not started yet starts over, as
+//	Kernel::Exec would have started it; one that was preempted goes
+//	on from its user registers (see ResumeUser).
+//----------------------------------------------------------------------
+
+void Thread::Resume() {
+    if (cpuId == -1) {
+        StackAllocate((VoidFunctionPtr)ForkExecute, (void *)this);
+        return;
+    }
+    ASSERT(preempted);
+    StackAllocate((VoidFunctionPtr)ThreadResumeUser, NULL);  // no return
+#ifdef PARISC
+    machineState[StartupPCState] = PLabelToAddr(ThreadResumeUser);
+#else
+    machineState[StartupPCState] = (void *)ThreadResumeUser;
+#endif
+}
+
+//----------------------------------------------------------------------
+// Thread::Checkpoint
+// 	Write out the state of the thread, and of its address space, or
+//	read it back in.  When reading, the thread is either the host
+//	thread's own (taking the place of the one that was running), or
+//	a new one, whose statistics record is the one read in with the
+//	other statistics, not the one it made for itself.
+//----------------------------------------------------------------------
+
+void Thread::Checkpoint(CheckpointFile *file) {
+    bool hasSpace = (space != NULL);
+
+    if (!file->IsWriting() && this != kernel->currentThread) {
+        kernel->stats->threads->Remove(threadStats);
+        delete threadStats;
+    }
+    file->String(&name);
+    file->Int(&ID);
+    file->Bool(&isExec);
+    file->Int((int *)&status);
+    file->Bytes(userRegisters, sizeof(userRegisters));
+    file->Int(&cpuId);
+    file->Bool(&preempted);
+    file->Int(&priority);
+    file->Int(&inWhichQueue);
+    file->Float(&weight);
+    file->Float(&curr_approximatedBurstTime);
+    file->Float(&last_approximatedBurstTime);
+    file->Float(&rem_approximatedBurstTime);
+    file->Int(&timeStamp_startRunning);
+    file->Int(&totalRunningTime);
+    file->Int(&timeStamp_startReady);
+    file->Int(&totalReadyTime);
+    if (!file->IsWriting()) {
+        threadStats = kernel->stats->FindThread(ID);
+    }
+
+    file->Bool(&hasSpace);
+    if (hasSpace) {
+        if (!file->IsWriting()) {
+            space = new AddrSpace();
+        }
+        space->Checkpoint(file);
+    }
+}
+
 #include "machine.h"
 
 //----------------------------------------------------------------------
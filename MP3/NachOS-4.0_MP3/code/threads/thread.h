@@ -40,6 +40,7 @@
 #include "addrspace.h"
 #include "copyright.h"
 #include "machine.h"
+#include "stats.h"
 #include "sysdep.h"
 #include "utility.h"
 
@@ -52,6 +53,8 @@
 
 #define MachineStateSize 75
 
+class CheckpointFile;
+
 // Size of the thread's private execution stack.
 // WATCH OUT IF THIS ISN'T BIG ENOUGH!!!!!
 const int StackSize = (8 * 1024);  // in words
@@ -100,6 +103,9 @@ class Thread {
                                  // relinquish the processor
     void Begin();                // Startup code for the thread
     void Finish();               // The thread is done executing
+    void Resume();               // Make a thread restored from a
+                                 // checkpoint ready to run again
+    void ResumeUser();           // Startup code for such a thread
 
     void CheckOverflow();  // Check if thread stack has overflowed
     void setStatus(ThreadStatus st) { status = st; }
@@ -125,7 +131,11 @@ class Thread {
             curr_approximatedBurstTime - totalRunningTime;
     }
     void TimeUpdate_RunningToReady(int system_totalTicks) {
-        totalRunningTime += system_totalTicks - timeStamp_startRunning;
+        // A thread that yields with nobody else ready keeps running, and
+        // has its time so far counted again; so this can grow past the
+        // largest int.  Let it wrap around explicitly, as it always has.
+        totalRunningTime = (int)((unsigned int)totalRunningTime +
+                                 system_totalTicks - timeStamp_startRunning);
         rem_approximatedBurstTime =
             curr_approximatedBurstTime - totalRunningTime;
     }
@@ -174,6 +184,17 @@ class Thread {
 
     AddrSpace *space;  // User code this thread is running.
 
+    ThreadStats *threadStats;  // where the time spent running, ready
+                               // and blocked is kept (see stats.h)
+    int cpuId;                 // the CPU it last ran on, or -1 if it
+                               // has not run yet (see cpu.h)
+    bool preempted;            // TRUE while it is switched out by the
+                               // timer, in the middle of user code
+
+    void Checkpoint(CheckpointFile *file);
+    // write out, or read in, the thread's
+    // state (see checkpoint.h)
+
     int priority;      // priority for ready queue
     int inWhichQueue;  // L1: 1, L2: 2, L3: 3
 
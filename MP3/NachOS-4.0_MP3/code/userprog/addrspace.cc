@@ -17,10 +17,12 @@
 
 #include "addrspace.h"
 
+#include "checkpoint.h"
 #include "copyright.h"
 #include "machine.h"
 #include "main.h"
 #include "noff.h"
+#include "profile.h"
 
 //----------------------------------------------------------------------
 // SwapHeader
@@ -61,9 +63,22 @@ static void SwapHeader(NoffHeader *noffH) {
 //	Set up the translation from program memory to physical
 //	memory.  For now, this is really simple (1:1), since we are
 //	only uniprogramming, and we have a single unsegmented page table
+//
+//	Each address space also gets the lowest free ASID, to tag its
+//	entries in the TLB, if there is one.
 //----------------------------------------------------------------------
 
 AddrSpace::AddrSpace() {
+    AddrSpace **asidOwner = kernel->asidOwner;
+
+    for (asid = 0; asid < MaxAddrSpaces && asidOwner[asid] != NULL; asid++)
+        ;
+    ASSERT(asid < MaxAddrSpaces);
+    asidOwner[asid] = this;
+    profile = NULL;
+    pageTable = NULL;  // until the program is loaded
+    numPages = 0;
+
     // pageTable = new TranslationEntry[NumPhysPages];
     // for (int i = 0; i < NumPhysPages; i++) {
     //     pageTable[i].virtualPage = i;   // for now, virt page # = phys page #
@@ -90,6 +105,14 @@ AddrSpace::~AddrSpace() {
         kernel->NumFreeFrame++;
     }
 
+    if (kernel->machine->tlb != NULL) {
+        kernel->FlushTLBs(asid);  // before the ASID is reused
+    }
+    kernel->asidOwner[asid] = NULL;
+    if (kernel->machine->profile == profile) {
+        kernel->machine->profile = NULL;
+    }
+    delete profile;
     delete pageTable;
 }
 
@@ -112,6 +135,9 @@ void AddrSpace::ConstructPageTable(int numPages) {
 //	Assumes that the page table has been initialized, and that
 //	the object code file is in NOFF format.
 //
+//	With -prof, also starts a profile of the program, with its own
+//	copy of the code, to find the basic blocks in later.
+//
 //	"fileName" is the file containing the object code to load into memory
 //----------------------------------------------------------------------
 
@@ -234,6 +260,16 @@ bool AddrSpace::Load(char *fileName) {
     }
 #endif
 
+    if (kernel->profileInterval > 0) {
+        unsigned int *code = new unsigned int[noffH.code.size / 4 + 1];
+
+        executable->ReadAt((char *)code, noffH.code.size,
+                           noffH.code.inFileAddr);
+        profile = new Profile(fileName, noffH.code.virtualAddr,
+                              noffH.code.size, code, kernel->profileInterval);
+        delete[] code;
+    }
+
     delete executable;  // close file
     return TRUE;        // success
 }
@@ -308,12 +344,95 @@ void AddrSpace::SaveState() {}
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      For now, tell the machine where to find the page table, and
+//	have it forget the translations it cached for the old one.
+//
+//	With a TLB, the machine gets no page table: the TLB is loaded
+//	on demand by TLBMiss.  The entries of the old address space
+//	have to go, unless the TLB tells address spaces apart by ASID.
+//
+//	The machine also reports instructions to this program's profile.
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState() {
-    kernel->machine->pageTable = pageTable;
-    kernel->machine->pageTableSize = numPages;
+    Machine *machine = kernel->machine;
+
+    machine->profile = profile;
+
+    if (machine->tlb == NULL) {
+        machine->pageTable = pageTable;
+        machine->pageTableSize = numPages;
+    } else if (machine->currentAsid != asid && !machine->tlbTagged) {
+        for (int i = 0; i < machine->tlbSize; i++) {
+            SaveTLBEntry(i);
+        }
+        machine->FlushTLB(-1);
+    }
+    machine->currentAsid = asid;
+    machine->FlushSoftTLB();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Checkpoint
+// 	Write out the page table, or read it back in; it is empty if the
+//	program has not been loaded yet.  The physical pages it maps are
+//	saved with the rest of main memory.  The address space keeps the
+//	ASID it was given, since there is no TLB to tag.
+//----------------------------------------------------------------------
+
+void AddrSpace::Checkpoint(CheckpointFile *file) {
+    file->Int((int *)&numPages);
+    if (!file->IsWriting() && numPages > 0) {
+        ConstructPageTable(numPages);
+    }
+    if (numPages > 0) {
+        file->Bytes(pageTable, numPages * sizeof(TranslationEntry));
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::TLBMiss
+// 	Handle a TLB miss on "virtAddr": copy its translation from the
+//	page table into the TLB, in the entry the machine's replacement
+//	policy picks, first saving the use and dirty bits of the entry
+//	being replaced.  The faulting instruction is then retried.
+//
+//	Returns FALSE if "virtAddr" is not in this address space.
+//----------------------------------------------------------------------
+
+bool AddrSpace::TLBMiss(int virtAddr) {
+    unsigned int vpn = (unsigned)virtAddr / PageSize;
+    int i;
+
+    if (vpn >= numPages || !pageTable[vpn].valid) {
+        return FALSE;
+    }
+    i = kernel->machine->TLBVictim(vpn);
+    SaveTLBEntry(i);
+    kernel->machine->WriteTLB(i, &pageTable[vpn]);
+    DEBUG(dbgAddr, "TLB entry " << i << " loaded for virtual page " << vpn);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SaveTLBEntry
+// 	The hardware sets the use and dirty bits in the TLB entry, not
+//	in the page table it came from.  Before the entry is replaced or
+//	flushed, copy them back to the page table of the address space
+//	it belongs to, if that still exists.
+//
+//	"i" is the index of the TLB entry.
+//----------------------------------------------------------------------
+
+void AddrSpace::SaveTLBEntry(int i) {
+    TranslationEntry *entry = &kernel->machine->tlb[i];
+    AddrSpace *owner;
+
+    if (!entry->valid) return;
+    owner = kernel->asidOwner[kernel->machine->TLBOwner(i)];
+    if (owner == NULL) return;
+    if (entry->use) owner->pageTable[entry->virtualPage].use = TRUE;
+    if (entry->dirty) owner->pageTable[entry->virtualPage].dirty = TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -337,6 +456,10 @@ ExceptionType AddrSpace::Translate(unsigned int vaddr, unsigned int *paddr,
 
     pte = &pageTable[vpn];
 
+    if (!pte->valid) {
+        return PageFaultException;
+    }
+
     if (isReadWrite && pte->readOnly) {
         return ReadOnlyException;
     }
@@ -363,3 +486,120 @@ ExceptionType AddrSpace::Translate(unsigned int vaddr, unsigned int *paddr,
 
     return NoException;
 }
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyIn, AddrSpace::CopyOut
+//  Copy "size" bytes from the user buffer at "virtAddr" into the
+//  kernel buffer "into", or from the kernel buffer "from" out to
+//  the user buffer, for a system call.  Each page of the user buffer
+//  is translated once, through the page table, and the part of the
+//  buffer on it copied with a single memcpy; a buffer may cross any
+//  number of pages, which need not be contiguous in main memory.
+//
+//  Return FALSE, having copied only part of the buffer, if any page
+//  of it is not mapped, or CopyOut finds one read-only, so that the
+//  system call can fail instead of touching memory it should not.
+//----------------------------------------------------------------------
+
+bool AddrSpace::CopyIn(int virtAddr, char *into, int size) {
+    unsigned int vaddr = (unsigned int)virtAddr;
+    unsigned int paddr;
+
+    if (size < 0) return FALSE;
+    while (size > 0) {
+        int chunk = PageSize - vaddr % PageSize;
+
+        if (chunk > size) chunk = size;
+        if (Translate(vaddr, &paddr, 0) != NoException) return FALSE;
+        memcpy(into, &kernel->machine->mainMemory[paddr], chunk);
+        vaddr += chunk;
+        into += chunk;
+        size -= chunk;
+    }
+    return TRUE;
+}
+
+bool AddrSpace::CopyOut(int virtAddr, char *from, int size) {
+    unsigned int vaddr = (unsigned int)virtAddr;
+    unsigned int paddr;
+
+    if (size < 0) return FALSE;
+    while (size > 0) {
+        int chunk = PageSize - vaddr % PageSize;
+
+        if (chunk > size) chunk = size;
+        if (Translate(vaddr, &paddr, 1) != NoException) return FALSE;
+        memcpy(&kernel->machine->mainMemory[paddr], from, chunk);
+        vaddr += chunk;
+        from += chunk;
+        size -= chunk;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Writable
+//  Return how many bytes of the user buffer at "virtAddr", up to
+//  "size", CopyOut could write before reaching a page that is not
+//  mapped or is read-only.  The page table is only looked at, not
+//  marked used or dirty; a system call can check where it would put
+//  its result before doing anything it could not undo.
+//----------------------------------------------------------------------
+
+int AddrSpace::Writable(int virtAddr, int size) {
+    unsigned int vaddr = (unsigned int)virtAddr;
+    int done = 0;
+
+    while (done < size) {
+        unsigned int vpn = vaddr / PageSize;
+        int chunk = PageSize - vaddr % PageSize;
+
+        if (vpn >= numPages || !pageTable[vpn].valid ||
+            pageTable[vpn].readOnly ||
+            pageTable[vpn].physicalPage >= NumPhysPages) {
+            break;
+        }
+        if (chunk > size - done) chunk = size - done;
+        vaddr += chunk;
+        done += chunk;
+    }
+    return done;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyInString
+//  Copy the NUL-terminated string at "virtAddr" in user memory into
+//  the kernel buffer "into", which has room for "maxSize" bytes.  As
+//  with CopyIn, each page is translated once; the string is searched
+//  for its NUL a page at a time, with memchr.
+//
+//  Return FALSE if part of the string is not mapped, or it does not
+//  end within "maxSize" bytes; "into" is then still NUL-terminated.
+//----------------------------------------------------------------------
+
+bool AddrSpace::CopyInString(int virtAddr, char *into, int maxSize) {
+    unsigned int vaddr = (unsigned int)virtAddr;
+    unsigned int paddr;
+    int left = maxSize;
+
+    ASSERT(maxSize > 0);
+    while (left > 0) {
+        int chunk = PageSize - vaddr % PageSize;
+        char *end;
+
+        if (chunk > left) chunk = left;
+        if (Translate(vaddr, &paddr, 0) != NoException) break;
+        end = (char *)memchr(&kernel->machine->mainMemory[paddr], '\0', chunk);
+        if (end != NULL) {
+            memcpy(into, &kernel->machine->mainMemory[paddr],
+                   end - &kernel->machine->mainMemory[paddr] + 1);
+            return TRUE;
+        }
+        memcpy(into, &kernel->machine->mainMemory[paddr], chunk);
+        vaddr += chunk;
+        into += chunk;
+        left -= chunk;
+    }
+    into[left > 0 ? 0 : -1] = '\0';  // cut short
+    return FALSE;
+}
@@ -16,9 +16,15 @@
 #include "copyright.h"
 #include "filesys.h"
 #include "machine.h"
+#include "profile.h"
 
 #define UserStackSize 1024  // increase this as necessary!
 
+class CheckpointFile;
+
+const int MaxAddrSpaces = 64;  // address spaces that can exist at once,
+                               // each with its own ASID for the TLB
+
 class AddrSpace {
    public:
     AddrSpace();   // Create an address space.
@@ -37,16 +43,41 @@ class AddrSpace {
     void SaveState();     // Save/restore address space-specific
     void RestoreState();  // info on a context switch
 
+    void Checkpoint(CheckpointFile *file);
+    // write out, or read in, the page table
+
     // Translate virtual address _vaddr_
     // to physical address _paddr_. _mode_
     // is 0 for Read, 1 for Write.
     ExceptionType Translate(unsigned int vaddr, unsigned int *paddr, int mode);
 
+    // Copy between a user buffer at _virtAddr_ and a kernel buffer,
+    // for system call arguments; FALSE if part of the user buffer is
+    // not mapped (or, for CopyOut, is read-only)
+    bool CopyIn(int virtAddr, char *into, int size);
+    bool CopyOut(int virtAddr, char *from, int size);
+    bool CopyInString(int virtAddr, char *into, int maxSize);
+    // Also FALSE if the string, with its NUL, is
+    // longer than maxSize
+    int Writable(int virtAddr, int size);
+    // How many of the "size" bytes at virtAddr
+    // CopyOut could write, from the start
+
+    bool TLBMiss(int virtAddr);  // Load the TLB with the translation
+                                 // for virtAddr; FALSE if there is none
+
+    Profile *profile;  // of the program, with -prof; otherwise NULL
+
    private:
     TranslationEntry *pageTable;  // Assume linear page table translation
                                   // for now!
     unsigned int numPages;        // Number of pages in the virtual
                                   // address space
+    int asid;                     // tags this space's TLB entries
+
+    static void SaveTLBEntry(int i);
+    // Copy the use and dirty bits of TLB
+    // entry "i" back to its page table
 
     void InitRegisters();  // Initialize user-level CPU registers,
                            // before jumping to user code
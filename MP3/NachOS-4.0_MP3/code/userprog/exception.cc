@@ -24,7 +24,86 @@
 #include "copyright.h"
 #include "ksyscall.h"
 #include "main.h"
+#include "hosterrno.h"  // before syscall.h, see hosterrno.h
 #include "syscall.h"
+
+// System call arguments in user memory are copied into kernel buffers
+// (see AddrSpace::CopyIn), never used in place: a file name or message
+// may be at most MaxStringArg bytes long, with its NUL, and the data of
+// a Read or Write is moved IOChunkSize bytes at a time.
+const int MaxStringArg = 256;
+const int IOChunkSize = 4096;
+
+//----------------------------------------------------------------------
+// UserWrite
+// 	Write "size" bytes from the user buffer at "virtAddr" to the open
+//	file "id", through a kernel buffer.  Return the number of bytes
+//	written; or, if none were, EFAULT if the buffer is not all in
+//	the address space, or the error from the file system.
+//----------------------------------------------------------------------
+
+static int UserWrite(int virtAddr, int size, OpenFileId id) {
+    AddrSpace *space = kernel->currentThread->space;
+    char buffer[IOChunkSize];
+    int done = 0;
+
+    if (size < 0) return EINVAL;
+    while (done < size) {
+        int chunk = min(size - done, IOChunkSize);
+        int result;
+
+        if (!space->CopyIn(virtAddr + done, buffer, chunk)) {
+            return done > 0 ? done : EFAULT;
+        }
+        result = SysWrite(buffer, chunk, id);
+        if (result < 0) {
+            return done > 0 ? done : result;
+        }
+        done += result;
+        if (result < chunk) break;
+    }
+    return done;
+}
+
+//----------------------------------------------------------------------
+// UserRead
+// 	Read up to "size" bytes from the open file "id" into the user
+//	buffer at "virtAddr", through a kernel buffer.  Return the number
+//	of bytes read, which is less than "size" at the end of the file;
+//	or, if none were, EFAULT or the error from the file system, as
+//	for UserWrite.
+//
+//	Each chunk is read only as far as the user buffer can take it,
+//	so that no data is taken from the file and then lost.
+//----------------------------------------------------------------------
+
+static int UserRead(int virtAddr, int size, OpenFileId id) {
+    AddrSpace *space = kernel->currentThread->space;
+    char buffer[IOChunkSize];
+    int done = 0;
+
+    if (size < 0) return EINVAL;
+    while (done < size) {
+        int chunk =
+            space->Writable(virtAddr + done, min(size - done, IOChunkSize));
+        int result;
+
+        if (chunk == 0) {
+            return done > 0 ? done : EFAULT;
+        }
+        result = SysRaed(buffer, chunk, id);
+        if (result < 0) {
+            return done > 0 ? done : result;
+        }
+        if (!space->CopyOut(virtAddr + done, buffer, result)) {
+            return done > 0 ? done : EFAULT;
+        }
+        done += result;
+        if (result < chunk) break;
+    }
+    return done;
+}
+
 //----------------------------------------------------------------------
 // ExceptionHandler
 // 	Entry point into the Nachos kernel.  Called when a user program
@@ -60,10 +139,23 @@ void ExceptionHandler(ExceptionType which) {
         case MemoryLimitException:
             cerr << "Unexpected user mode exception " << (int)which << "\n";
             ASSERT(false);
+        case PageFaultException:
+            // with a TLB, this is a TLB miss: load the translation from
+            // the page table, and retry the instruction
+            if (kernel->machine->tlb != NULL &&
+                kernel->currentThread->space->TLBMiss(
+                    kernel->machine->ReadRegister(BadVAddrReg))) {
+                return;
+            }
+            kernel->stats->numPageFaults++;
+            cerr << "Unexpected user mode exception " << (int)which << "\n";
+            break;
         case SyscallException:
             switch (type) {
                 case SC_Halt:
                     DEBUG(dbgSys, "Shutdown, initiated by user program.\n");
+                    if (kernel->currentThread->space->profile != NULL)
+                        kernel->currentThread->space->profile->Write();
                     SysHalt();
                     cout << "in exception\n";
                     ASSERTNOTREACHED();
@@ -92,7 +184,11 @@ void ExceptionHandler(ExceptionType which) {
                     DEBUG(dbgSys, "Message received.\n");
                     val = kernel->machine->ReadRegister(4);
                     {
-                        char *msg = &(kernel->machine->mainMemory[val]);
+                        char msg[MaxStringArg];
+
+                        // print as much of it as could be copied
+                        kernel->currentThread->space->CopyInString(
+                            val, msg, MaxStringArg);
                         cout << msg << endl;
                     }
                     SysHalt();
@@ -101,9 +197,14 @@ void ExceptionHandler(ExceptionType which) {
                 case SC_Create:
                     val = kernel->machine->ReadRegister(4);
                     {
-                        char *filename = &(kernel->machine->mainMemory[val]);
-                        // cout << filename << endl;
-                        status = SysCreate(filename);
+                        char filename[MaxStringArg];
+
+                        if (kernel->currentThread->space->CopyInString(
+                                val, filename, MaxStringArg)) {
+                            status = SysCreate(filename);
+                        } else {
+                            status = EFAULT;
+                        }
                         kernel->machine->WriteRegister(2, (int)status);
                     }
                     kernel->machine->WriteRegister(
@@ -125,14 +226,19 @@ void ExceptionHandler(ExceptionType which) {
                     val = kernel->machine->ReadRegister(
                         4);  // Retrieve file name address.
                     {
-                        char *filename =
-                            &(kernel->machine
-                                  ->mainMemory[val]);  // Retrive file name.
+                        char filename[MaxStringArg];
+
                         DEBUG(
                             dbgTraCode,
                             "In ExceptionHandler:case SC_Open, into SysOpen.");
-                        fileID = SysOpen(
-                            filename);  // Success: get file ID / Fail: get -1
+                        if (kernel->currentThread->space->CopyInString(
+                                val, filename,
+                                MaxStringArg)) {  // Retrieve file name.
+                            fileID = SysOpen(filename);  // Success: get file
+                                                         // ID / Fail: get -1
+                        } else {
+                            fileID = EFAULT;
+                        }
                         DEBUG(dbgTraCode,
                               "In ExceptionHandler:case SC_Open, return from "
                               "SysOpen.");
@@ -158,17 +264,17 @@ void ExceptionHandler(ExceptionType which) {
                     DEBUG(dbgTraCode, "In ExceptionHandler:case SC_Write.");
                     val = kernel->machine->ReadRegister(4);
                     {
-                        char *buffer = &(kernel->machine->mainMemory[val]);
                         numChar = kernel->machine->ReadRegister(5);
                         fileID = kernel->machine->ReadRegister(6);
 
                         DEBUG(dbgTraCode,
                               "In ExceptionHandler:case SC_Write, into "
                               "SysWrite()");
-                        numChar = SysWrite(
-                            buffer, numChar,
+                        numChar = UserWrite(
+                            val, numChar,
                             fileID);  // Success: get number of character
-                                      // written into the file / Fail: get -1
+                                      // written into the file / Fail: get
+                                      // a negative error code
                         DEBUG(dbgTraCode,
                               "In ExceptionHandler:case SC_Write, return from "
                               "SysWrite()");
@@ -194,14 +300,13 @@ void ExceptionHandler(ExceptionType which) {
                     DEBUG(dbgTraCode, "In ExceptionHandler:case SC_Read.");
                     val = kernel->machine->ReadRegister(4);
                     {
-                        char *buffer = &(kernel->machine->mainMemory[val]);
                         numChar = kernel->machine->ReadRegister(5);
                         fileID = kernel->machine->ReadRegister(6);
 
                         DEBUG(
                             dbgTraCode,
                             "In ExceptionHandler:case SC_Read, into SysRaed()");
-                        numChar = SysRaed(buffer, numChar, fileID);
+                        numChar = UserRead(val, numChar, fileID);
                         DEBUG(dbgTraCode,
                               "In ExceptionHandler:case SC_Read, return from "
                               "SysRead()");
@@ -276,7 +381,11 @@ void ExceptionHandler(ExceptionType which) {
                 case SC_Exit:
                     DEBUG(dbgAddr, "Program exit\n");
                     val = kernel->machine->ReadRegister(4);
+                    if (debug->IsEnabled(dbgExit))
+                        kernel->machine->DumpExitState();
                     cout << "return value:" << val << endl;
+                    if (kernel->currentThread->space->profile != NULL)
+                        kernel->currentThread->space->profile->Write();
                     kernel->currentThread->Finish();
                     break;
                 default:
@@ -0,0 +1,77 @@
+// hosterrno.h
+//	Drop the host's definitions of the error numbers that errno.h
+//	defines too.  The C++ library brings the host's <cerrno> into most
+//	of the kernel; where a file also needs the Nachos error numbers
+//	(through syscall.h), it includes this first, so that errno.h
+//	defines them afresh instead of redefining the host's.  A system
+//	call must return the Nachos values, not the host's.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef HOSTERRNO_H
+#define HOSTERRNO_H
+
+#include <cerrno>
+
+#undef ERRNO_H
+#undef EPERM
+#undef ENOENT
+#undef ESRCH
+#undef EINTR
+#undef EIO
+#undef ENXIO
+#undef E2BIG
+#undef ENOEXEC
+#undef EBADF
+#undef ECHILD
+#undef EAGAIN
+#undef ENOMEM
+#undef EACCES
+#undef EFAULT
+#undef ENOTBLK
+#undef EBUSY
+#undef EEXIST
+#undef EXDEV
+#undef ENODEV
+#undef ENOTDIR
+#undef EISDIR
+#undef EINVAL
+#undef ENFILE
+#undef EMFILE
+#undef ENOTTY
+#undef ETXTBSY
+#undef EFBIG
+#undef ENOSPC
+#undef ESPIPE
+#undef EROFS
+#undef EMLINK
+#undef EPIPE
+#undef EDOM
+#undef ERANGE
+#undef EDEADLK
+#undef ENAMETOOLONG
+#undef ENOLCK
+#undef ENOSYS
+#undef ENOTEMPTY
+#undef ELOOP
+#undef EWOULDBLOCK
+#undef ENOMSG
+#undef EIDRM
+#undef ECHRNG
+#undef EL2NSYNC
+#undef EL3HLT
+#undef EL3RST
+#undef ELNRNG
+#undef EUNATCH
+#undef ENOCSI
+#undef EL2HLT
+#undef EBADE
+#undef EBADR
+#undef EXFULL
+#undef ENOANO
+#undef EBADRQC
+#undef EBADSLT
+
+#endif  // HOSTERRNO_H
@@ -0,0 +1,456 @@
+// profile.cc
+//	Routines to profile a user program: count the instructions it
+//	executes, sample where it is on the timer interrupt, and write
+//	both out, named by the program's symbol file, when it exits.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include <sstream>  // first, as utility.h #defines min and max
+
+#include "profile.h"
+
+#include "copyright.h"
+#include "debug.h"
+#include "machine.h"
+#include "main.h"
+#include "mipssim.h"
+
+// A basic block, as written to the profile.
+class ProfileBlock {
+   public:
+    int start;   // index of its first instruction
+    int length;  // how many instructions it has
+    int count;   // how many times it ran
+};
+
+static int
+SymbolCompare(const void *x, const void *y) {
+    return ((ProfileSymbol *)x)->address - ((ProfileSymbol *)y)->address;
+}
+
+static int
+BlockCompare(const void *x, const void *y) {
+    ProfileBlock *a = (ProfileBlock *)x, *b = (ProfileBlock *)y;
+
+    if (a->count != b->count) return (a->count > b->count) ? -1 : 1;
+    return a->start - b->start;
+}
+
+//----------------------------------------------------------------------
+// Profile::Profile
+// 	Start profiling a program that has just been loaded, and read
+//	its symbol file, if there is one.
+//
+//	"programName" -- the program's file name; the symbol file and the
+//		profile are named after it
+//	"codeStart", "codeSize" -- where its code is loaded, and how big
+//	"code" -- a copy of the code, as read from the program's file
+//	"interval" -- the fewest ticks between two samples
+//----------------------------------------------------------------------
+
+Profile::Profile(char *programName, int codeStart, int codeSize,
+                 unsigned int *code, int interval) {
+    name = new char[strlen(programName) + 1];
+    strcpy(name, programName);
+    this->codeStart = codeStart;
+    numWords = codeSize / 4;
+    this->code = new unsigned int[numWords];
+    counts = new int[numWords];
+    for (int i = 0; i < numWords; i++) {
+        this->code[i] = WordToHost(code[i]);
+        counts[i] = 0;
+    }
+    this->interval = interval;
+    nextSample = 0;
+    numSamples = 0;
+
+    char *symFileName = new char[strlen(name) + 5];
+    sprintf(symFileName, "%s.sym", name);
+    LoadSymbols(symFileName);
+    delete[] symFileName;
+
+    maxNodes = 64;
+    nodes = new StackNode[maxNodes];
+    nodes[0].symbol = unknownSymbol;  // the root: no functions at all
+    nodes[0].parent = -1;
+    nodes[0].firstChild = nodes[0].nextSibling = -1;
+    nodes[0].samples = 0;
+    numNodes = 1;
+    depth = 0;
+}
+
+//----------------------------------------------------------------------
+// Profile::~Profile
+// 	De-allocate the profile.
+//----------------------------------------------------------------------
+
+Profile::~Profile() {
+    for (int i = 0; i < numSymbols; i++) {
+        delete[] symbols[i].name;
+    }
+    delete[] symbols;
+    delete[] nodes;
+    delete[] counts;
+    delete[] code;
+    delete[] name;
+}
+
+//----------------------------------------------------------------------
+// Profile::LoadSymbols
+// 	Read the functions of the program from "fileName", as written
+//	by coff2noff: one per line, a hex address then the name.  The
+//	two pseudo-functions "[unknown]" and "[kernel]" go at the end.
+//----------------------------------------------------------------------
+
+void Profile::LoadSymbols(char *fileName) {
+    int fileNo = OpenForReadWrite(fileName, FALSE);
+    char *text = NULL, *line, *next;
+    int size = 0, maxSymbols = 0;
+
+    if (fileNo >= 0) {
+        Lseek(fileNo, 0, 2);
+        size = Tell(fileNo);
+        Lseek(fileNo, 0, 0);
+        text = new char[size + 1];
+        Read(fileNo, text, size);
+        text[size] = '\0';
+        Close(fileNo);
+        for (int i = 0; i < size; i++) {
+            if (text[i] == '\n') maxSymbols++;
+        }
+    } else {
+        cerr << "No symbol file " << fileName << ", so the profile of "
+             << name << " will have no function names\n";
+    }
+
+    symbols = new ProfileSymbol[maxSymbols + 2];
+    numSymbols = 0;
+    for (line = text; line != NULL && *line != '\0'; line = next) {
+        ProfileSymbol *symbol = &symbols[numSymbols];
+        unsigned int address;
+        char symName[256];
+
+        next = strchr(line, '\n');
+        if (next != NULL) *next++ = '\0';
+        if (numSymbols == maxSymbols ||
+            sscanf(line, "%x %255s", &address, symName) != 2) {
+            continue;
+        }
+        symbol->address = address;
+        symbol->name = new char[strlen(symName) + 1];
+        strcpy(symbol->name, symName);
+        numSymbols++;
+    }
+    delete[] text;
+    qsort(symbols, numSymbols, sizeof(ProfileSymbol), SymbolCompare);
+
+    unknownSymbol = numSymbols++;
+    kernelSymbol = numSymbols++;
+    symbols[unknownSymbol].name = new char[10];
+    strcpy(symbols[unknownSymbol].name, "[unknown]");
+    symbols[kernelSymbol].name = new char[9];
+    strcpy(symbols[kernelSymbol].name, "[kernel]");
+    symbols[unknownSymbol].address = symbols[kernelSymbol].address = -1;
+    for (int i = 0; i < numSymbols; i++) {
+        symbols[i].samples = symbols[i].instructions = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// Profile::FindSymbol
+// 	Return the function containing "pc": the last one starting at
+//	or before it, or "[unknown]" if there is none, or if "pc" is
+//	not in the code at all.
+//----------------------------------------------------------------------
+
+int Profile::FindSymbol(int pc) {
+    int low = 0, high = unknownSymbol;  // the answer is below high
+
+    if (pc < codeStart || pc >= codeStart + numWords * 4) {
+        return unknownSymbol;
+    }
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (symbols[middle].address <= pc)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return (low == 0) ? unknownSymbol : low - 1;
+}
+
+//----------------------------------------------------------------------
+// Profile::Child
+// 	Return the call stack "node" with "symbol" called on top of it,
+//	adding it to the tree if it is new.
+//----------------------------------------------------------------------
+
+int Profile::Child(int node, int symbol) {
+    int child;
+
+    for (child = nodes[node].firstChild; child != -1;
+         child = nodes[child].nextSibling) {
+        if (nodes[child].symbol == symbol) return child;
+    }
+
+    if (numNodes == maxNodes) {
+        StackNode *old = nodes;
+        nodes = new StackNode[maxNodes * 2];
+        for (int i = 0; i < maxNodes; i++) {
+            nodes[i] = old[i];
+        }
+        maxNodes *= 2;
+        delete[] old;
+    }
+    child = numNodes++;
+    nodes[child].symbol = symbol;
+    nodes[child].parent = node;
+    nodes[child].firstChild = -1;
+    nodes[child].nextSibling = nodes[node].firstChild;
+    nodes[child].samples = 0;
+    nodes[node].firstChild = child;
+    return child;
+}
+
+//----------------------------------------------------------------------
+// Profile::Execute
+// 	Count one completed instruction, and keep the shadow call stack
+//	up to date: a jump-and-link pushes the function making the call,
+//	and a "jr $31" (a return) pops it again.
+//
+//	"pc" -- where the instruction is
+//	"instr" -- the instruction
+//----------------------------------------------------------------------
+
+void Profile::Execute(int pc, Instruction *instr) {
+    int i = (pc - codeStart) >> 2;
+
+    if (i >= 0 && i < numWords) counts[i]++;
+
+    switch (instr->opCode) {
+        case OP_JAL:
+        case OP_JALR:
+            if (depth < MaxProfileDepth) {
+                stack[depth] =
+                    Child((depth == 0) ? 0 : stack[depth - 1], FindSymbol(pc));
+            }
+            depth++;
+            break;
+        case OP_JR:
+            if (instr->rs == R31 && depth > 0) depth--;
+            break;
+        default:
+            break;
+    }
+}
+
+//----------------------------------------------------------------------
+// Profile::Sample
+// 	Record where the program is, unless the last sample was taken
+//	less than "interval" ticks ago.
+//
+//	"pc" -- the program counter
+//	"inKernel" -- TRUE if the kernel is running on the program's
+//		behalf (a system call), rather than the program itself
+//----------------------------------------------------------------------
+
+void Profile::Sample(int pc, bool inKernel) {
+    int now = kernel->stats->totalTicks;
+    int node, symbol;
+
+    if (now < nextSample) return;
+    nextSample = now + interval;
+
+    node = (depth == 0) ? 0 : stack[min(depth, MaxProfileDepth) - 1];
+    symbol = FindSymbol(pc);
+    node = Child(node, symbol);
+    if (inKernel) {
+        symbol = kernelSymbol;
+        node = Child(node, symbol);
+    }
+    nodes[node].samples++;
+    symbols[symbol].samples++;
+    numSamples++;
+}
+
+//----------------------------------------------------------------------
+// Profile::FindBlocks
+// 	Return, for each instruction, whether it starts a basic block:
+//	the first instruction, the start of each function, the target of
+//	each branch and jump, the instruction after the delay slot of
+//	each, and the instruction after each syscall.
+//
+//	Since every instruction in a block runs as often as the first,
+//	this is all that is needed to turn the counts of instructions
+//	into counts of blocks.
+//----------------------------------------------------------------------
+
+bool *Profile::FindBlocks() {
+    bool *leader = new bool[numWords + 2];
+    Instruction instr;
+    int i, target;
+
+    for (i = 0; i < numWords + 2; i++) {
+        leader[i] = (i == 0);
+    }
+    for (i = 0; i < unknownSymbol; i++) {
+        target = (symbols[i].address - codeStart) >> 2;
+        if (target >= 0 && target < numWords) leader[target] = TRUE;
+    }
+    for (i = 0; i < numWords; i++) {
+        instr.value = code[i];
+        instr.Decode();
+        target = -1;
+        switch (instr.opCode) {
+            case OP_BEQ:
+            case OP_BNE:
+            case OP_BLEZ:
+            case OP_BGTZ:
+            case OP_BLTZ:
+            case OP_BGEZ:
+            case OP_BLTZAL:
+            case OP_BGEZAL:
+                target = i + 1 + instr.extra;
+                leader[i + 2] = TRUE;
+                break;
+            case OP_J:
+            case OP_JAL:
+                target = ((((codeStart + 4 * i + 4) & 0xf0000000) |
+                           IndexToAddr(instr.extra)) -
+                          codeStart) >> 2;
+                leader[i + 2] = TRUE;
+                break;
+            case OP_JR:
+            case OP_JALR:
+                leader[i + 2] = TRUE;
+                break;
+            case OP_SYSCALL:
+                leader[i + 1] = TRUE;
+                break;
+            default:
+                break;
+        }
+        if (target >= 0 && target < numWords) leader[target] = TRUE;
+    }
+    return leader;
+}
+
+//----------------------------------------------------------------------
+// Profile::PrintStack
+// 	Print the call stack "node", outermost function first, separated
+//	by semicolons.
+//----------------------------------------------------------------------
+
+void Profile::PrintStack(ostream &out, int node) {
+    if (nodes[node].parent > 0) {
+        PrintStack(out, nodes[node].parent);
+        out << ";";
+    }
+    out << symbols[nodes[node].symbol].name;
+}
+
+//----------------------------------------------------------------------
+// Profile::Write
+// 	Write out the profile, as "<program>.prof" and "<program>.folded".
+//
+//	The first has the functions, by samples taken in each (then by
+//	instructions executed), and then the basic blocks that ran, most
+//	often first.  The second has each call stack that was sampled,
+//	and how often.
+//----------------------------------------------------------------------
+
+void Profile::Write() {
+    std::ostringstream prof, folded;
+    ProfileBlock *blocks = new ProfileBlock[numWords];
+    ProfileSymbol *bySamples = new ProfileSymbol[numSymbols];
+    bool *leader = FindBlocks();
+    long long totalInstructions = 0;
+    int numBlocks = 0, i, symbol, fileNo;
+    char *fileName = new char[strlen(name) + 8];
+    char line[200];
+
+    for (i = 0; i < numWords; i++) {
+        if (counts[i] > 0) {
+            symbols[FindSymbol(codeStart + 4 * i)].instructions += counts[i];
+            totalInstructions += counts[i];
+        }
+        if (leader[i]) {
+            blocks[numBlocks].start = i;
+            blocks[numBlocks].length = 0;
+            blocks[numBlocks].count = counts[i];
+            numBlocks++;
+        }
+        blocks[numBlocks - 1].length++;
+    }
+    delete[] leader;
+
+    // the flat profile, by function
+    sprintf(line, "Profile of %s: %d samples, at least %d ticks apart; "
+                  "%lld instructions\n\n",
+            name, numSamples, interval, totalInstructions);
+    prof << line;
+    prof << " samples       %  instructions  function\n";
+    for (i = 0; i < numSymbols; i++) {
+        bySamples[i] = symbols[i];
+    }
+    for (i = 1; i < numSymbols; i++) {  // insertion sort, so ties stay
+                                        // in order of address
+        ProfileSymbol s = bySamples[i];
+        int j = i;
+        for (; j > 0 && (bySamples[j - 1].samples < s.samples ||
+                         (bySamples[j - 1].samples == s.samples &&
+                          bySamples[j - 1].instructions < s.instructions));
+             j--) {
+            bySamples[j] = bySamples[j - 1];
+        }
+        bySamples[j] = s;
+    }
+    for (i = 0; i < numSymbols; i++) {
+        if (bySamples[i].samples == 0 && bySamples[i].instructions == 0)
+            continue;
+        sprintf(line, "%8d %6.2f%% %13d  %s\n", bySamples[i].samples,
+                (numSamples == 0) ? 0.0
+                                  : 100.0 * bySamples[i].samples / numSamples,
+                bySamples[i].instructions, bySamples[i].name);
+        prof << line;
+    }
+    delete[] bySamples;
+
+    // the basic blocks that ran, most often first
+    qsort(blocks, numBlocks, sizeof(ProfileBlock), BlockCompare);
+    prof << "\n   address       count  length  function\n";
+    for (i = 0; i < numBlocks && blocks[i].count > 0; i++) {
+        int pc = codeStart + 4 * blocks[i].start;
+
+        symbol = FindSymbol(pc);
+        sprintf(line, "0x%08x %11d %7d  %s", pc, blocks[i].count,
+                blocks[i].length, symbols[symbol].name);
+        prof << line;
+        if (symbol != unknownSymbol && pc != symbols[symbol].address) {
+            sprintf(line, "+0x%x", pc - symbols[symbol].address);
+            prof << line;
+        }
+        prof << "\n";
+    }
+    delete[] blocks;
+
+    // the call stacks, folded
+    for (i = 1; i < numNodes; i++) {
+        if (nodes[i].samples > 0) {
+            PrintStack(folded, i);
+            folded << " " << nodes[i].samples << "\n";
+        }
+    }
+
+    sprintf(fileName, "%s.prof", name);
+    fileNo = OpenForWrite(fileName);
+    WriteFile(fileNo, (char *)prof.str().c_str(), prof.str().length());
+    Close(fileNo);
+    sprintf(fileName, "%s.folded", name);
+    fileNo = OpenForWrite(fileName);
+    WriteFile(fileNo, (char *)folded.str().c_str(), folded.str().length());
+    Close(fileNo);
+    delete[] fileName;
+}
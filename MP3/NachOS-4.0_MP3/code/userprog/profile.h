@@ -0,0 +1,110 @@
+// profile.h
+//	Data structures for profiling a user program (nachos -prof).
+//
+//	Every instruction the program completes is counted, so the number
+//	of times each basic block ran is exact.  In addition, on the timer
+//	interrupt, at most once every "interval" ticks, the program counter
+//	is sampled, along with the call stack at that moment.
+//
+//	The call stack is not read from the user stack: instead, a shadow
+//	stack of functions is kept, pushed on each jump-and-link and popped
+//	on each "jr $31".  Code that returns some other way can confuse it,
+//	but only the stack, not the flat profile.
+//
+//	Functions are named by the symbol file that coff2noff writes next
+//	to the program ("<program>.sym"); without one, all samples land in
+//	"[unknown]".  When the program exits, the profile is written to
+//	"<program>.prof" (a flat profile, then the basic blocks) and to
+//	"<program>.folded" (one line per call stack, in the "collapsed"
+//	format read by flame graph tools).
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "copyright.h"
+#include "sysdep.h"
+
+class Instruction;
+
+const int MaxProfileDepth = 64;  // deepest call stack that is kept track of
+
+// A function in the program, from the symbol file.
+
+class ProfileSymbol {
+   public:
+    int address;       // where the function starts
+    char *name;
+    int samples;       // samples taken in the function itself
+    int instructions;  // instructions it executed
+};
+
+// A call stack, as a node in a tree of them: the path from the root
+// to the node is the stack, outermost function first.
+
+class StackNode {
+   public:
+    int symbol;       // the innermost function, as an index into symbols
+    int parent;       // the rest of the stack, as an index into nodes
+    int firstChild;   // the stacks this one calls (-1 if none), linked
+    int nextSibling;  // through nextSibling
+    int samples;      // samples taken with exactly this stack
+};
+
+// The following class profiles one program.
+
+class Profile {
+   public:
+    Profile(char *programName, int codeStart, int codeSize,
+            unsigned int *code, int interval);
+    // Profile the program "programName",
+    // whose code is "code" (codeSize bytes,
+    // in target byte order), loaded at
+    // codeStart; sample every interval ticks
+    ~Profile();
+
+    void Execute(int pc, Instruction *instr);
+    // Count an instruction, which has just
+    // completed, at "pc"
+    void Sample(int pc, bool inKernel);
+    // Called on each timer interrupt while
+    // the program is running; "inKernel"
+    // if it is in a system call
+    void Write();  // Write out the profile
+
+   private:
+    char *name;             // the program
+    int codeStart;          // the address of its first instruction
+    int numWords;           // how many instructions it has
+    unsigned int *code;     // the instructions, in host byte order
+    int *counts;            // times each instruction was executed
+    int interval;           // ticks between samples
+    int nextSample;         // when the next sample may be taken
+    int numSamples;         // samples taken so far
+
+    ProfileSymbol *symbols;  // the functions, in order of address,
+    int numSymbols;          // then "[unknown]" and "[kernel]"
+    int unknownSymbol;       // index of "[unknown]"
+    int kernelSymbol;        // index of "[kernel]"
+
+    StackNode *nodes;  // all the call stacks seen; nodes[0] is the root
+    int numNodes;
+    int maxNodes;      // size of the nodes array
+
+    int stack[MaxProfileDepth];  // the current call stack, as nodes
+    int depth;                   // how deep it is; may be more than
+                                 // MaxProfileDepth, if the calls
+                                 // beyond that are not kept
+
+    void LoadSymbols(char *fileName);  // read the symbol file
+    int FindSymbol(int pc);            // the function containing pc
+    int Child(int node, int symbol);   // the stack "node" plus "symbol"
+    void PrintStack(ostream &out, int node);
+    // print the stack "node", folded
+    bool *FindBlocks();  // which instructions start basic blocks
+};
+
+#endif  // PROFILE_H
@@ -89,7 +89,10 @@ SynchConsoleOutput::~SynchConsoleOutput() {
 //----------------------------------------------------------------------
 
 void SynchConsoleOutput::PutChar(char ch) {
+    int queued = kernel->stats->totalTicks;
+
     lock->Acquire();
+    kernel->stats->console.Queued(queued);
     consoleOutput->PutChar(ch);
     waitFor->P();
     lock->Release();
@@ -100,7 +103,9 @@ void SynchConsoleOutput::PutInt(int value) {
     int idx = 0;
     // sprintf(str, "%d\n\0", value);  the true one
     sprintf(str, "%d\n\0", value);  // simply for trace code
+    int queued = kernel->stats->totalTicks;
     lock->Acquire();
+    kernel->stats->console.Queued(queued);
     do {
         DEBUG(dbgTraCode,
               "In SynchConsoleOutput::PutInt, into consoleOutput->PutChar, "
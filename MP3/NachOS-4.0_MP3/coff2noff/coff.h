@@ -1,13 +1,16 @@
 /* coff.h
  *   Data structures that describe the MIPS COFF format.
+ *
+ *   Every field is as wide as in the file: "int" is 32 bits on both
+ *   32-bit and 64-bit hosts, where "long" is not.
  */
 
 struct filehdr {
         unsigned short  f_magic;        /* magic number */
         unsigned short  f_nscns;        /* number of sections */
-        long            f_timdat;       /* time & date stamp */
-        long            f_symptr;       /* file pointer to symbolic header */
-        long            f_nsyms;        /* sizeof(symbolic hdr) */
+        int             f_timdat;       /* time & date stamp */
+        int             f_symptr;       /* file pointer to symbolic header */
+        int             f_nsyms;        /* sizeof(symbolic hdr) */
         unsigned short  f_opthdr;       /* sizeof(optional hdr) */
         unsigned short  f_flags;        /* flags */
       };
@@ -20,30 +23,111 @@ struct filehdr {
 typedef struct aouthdr {
         short   magic;          /* see above                            */
         short   vstamp;         /* version stamp                        */
-        long    tsize;          /* text size in bytes, padded to DW bdry*/
-        long    dsize;          /* initialized data "  "                */
-        long    bsize;          /* uninitialized data "   "             */
-        long    entry;          /* entry pt.                            */
-        long    text_start;     /* base of text used for this file      */
-        long    data_start;     /* base of data used for this file      */
-        long    bss_start;      /* base of bss used for this file       */
-        long    gprmask;        /* general purpose register mask        */
-        long    cprmask[4];     /* co-processor register masks          */
-        long    gp_value;       /* the gp value used for this object    */
+        int     tsize;          /* text size in bytes, padded to DW bdry*/
+        int     dsize;          /* initialized data "  "                */
+        int     bsize;          /* uninitialized data "   "             */
+        int     entry;          /* entry pt.                            */
+        int     text_start;     /* base of text used for this file      */
+        int     data_start;     /* base of data used for this file      */
+        int     bss_start;      /* base of bss used for this file       */
+        int     gprmask;        /* general purpose register mask        */
+        int     cprmask[4];     /* co-processor register masks          */
+        int     gp_value;       /* the gp value used for this object    */
       } AOUTHDR;
 #define AOUTHSZ sizeof(AOUTHDR)
  
 
 struct scnhdr {
         char            s_name[8];      /* section name */
-        long            s_paddr;        /* physical address, aliased s_nlib */
-        long            s_vaddr;        /* virtual address */
-        long            s_size;         /* section size */
-        long            s_scnptr;       /* file ptr to raw data for section */
-        long            s_relptr;       /* file ptr to relocation */
-        long            s_lnnoptr;      /* file ptr to gp histogram */
+        int             s_paddr;        /* physical address, aliased s_nlib */
+        int             s_vaddr;        /* virtual address */
+        int             s_size;         /* section size */
+        int             s_scnptr;       /* file ptr to raw data for section */
+        int             s_relptr;       /* file ptr to relocation */
+        int             s_lnnoptr;      /* file ptr to gp histogram */
         unsigned short  s_nreloc;       /* number of relocation entries */
         unsigned short  s_nlnno;        /* number of gp histogram entries */
-        long            s_flags;        /* flags */
+        int             s_flags;        /* flags */
       };
  
+
+/* The symbol table.  "f_symptr" points at the symbolic header, which
+ * locates the other tables: only the ones used to find the address
+ * of each procedure are described here.
+ */
+
+typedef struct hdrr {
+        short   magic;          /* to verify validity of the table      */
+        short   vstamp;         /* version stamp                        */
+        int     ilineMax;       /* number of line number entries        */
+        int     cbLine;         /* number of bytes for line numbers     */
+        int     cbLineOffset;   /* offset to start of line numbers      */
+        int     idnMax;         /* max index into dense number table    */
+        int     cbDnOffset;     /* offset to start dense number table   */
+        int     ipdMax;         /* number of procedures                 */
+        int     cbPdOffset;     /* offset to procedure descriptors      */
+        int     isymMax;        /* number of local symbols              */
+        int     cbSymOffset;    /* offset to start of local symbols     */
+        int     ioptMax;        /* max index into optimization entries  */
+        int     cbOptOffset;    /* offset to optimization entries       */
+        int     iauxMax;        /* number of auxiliary symbols          */
+        int     cbAuxOffset;    /* offset to start of auxiliary symbols */
+        int     issMax;         /* max index into local strings         */
+        int     cbSsOffset;     /* offset to start of local strings     */
+        int     issExtMax;      /* max index into external strings      */
+        int     cbSsExtOffset;  /* offset to start of external strings  */
+        int     ifdMax;         /* number of file descriptors           */
+        int     cbFdOffset;     /* offset to file descriptors           */
+        int     crfd;           /* number of relative file descriptors  */
+        int     cbRfdOffset;    /* offset to relative file descriptors  */
+        int     iextMax;        /* number of external symbols           */
+        int     cbExtOffset;    /* offset to start of external symbols  */
+      } HDRR;
+
+#define magicSym        0x7009
+
+/* One source file's share of the local symbols and strings. */
+typedef struct fdr {
+        unsigned int    adr;            /* memory address of beginning  */
+        int             rss;            /* file name (of source)        */
+        int             issBase;        /* its first local string       */
+        int             cbSs;           /* number of bytes of them      */
+        int             isymBase;       /* its first local symbol       */
+        int             csym;           /* number of them               */
+        int             ilineBase;      /* line numbers ...             */
+        int             cline;
+        int             ioptBase;       /* optimization entries ...     */
+        int             copt;
+        unsigned short  ipdFirst;       /* procedure descriptors ...    */
+        short           cpd;
+        int             iauxBase;       /* auxiliary symbols ...        */
+        int             caux;
+        int             rfdBase;        /* relative file descriptors    */
+        int             crfd;
+        unsigned int    bits;           /* language, flags              */
+        int             cbLineOffset;   /* line numbers again           */
+        int             cbLine;
+      } FDR;
+
+/* A symbol.  "st_sc" holds the symbol type in bits 0-5 and the storage
+ * class in bits 6-10 (followed by an index into the auxiliary symbols).
+ */
+typedef struct symr {
+        int             iss;            /* index into string space      */
+        int             value;          /* address, for a procedure     */
+        unsigned int    st_sc;          /* symbol type, storage class   */
+      } SYMR;
+
+#define SymType(s)      ((s)->st_sc & 0x3f)
+#define SymClass(s)     (((s)->st_sc >> 6) & 0x1f)
+
+#define stProc          6       /* a procedure                          */
+#define stStaticProc    14      /* a static procedure                   */
+#define scText          1       /* in the text segment                  */
+
+/* An external symbol: global procedures and variables. */
+typedef struct extr {
+        unsigned short  flags;          /* jmptbl, cobol_main, weakext  */
+        short           ifd;            /* file where it is defined     */
+        SYMR            asym;           /* the symbol itself            */
+      } EXTR;
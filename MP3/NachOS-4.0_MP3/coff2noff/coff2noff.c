@@ -10,6 +10,11 @@
  * 	ld with  -N -T 0
  * to make sure the object file has no shared text.
  *
+ * If a third file name is given, the address and name of each procedure
+ * in the COFF symbol table are written to it, one per line, in order
+ * of address ("%08x name").  Nachos reads this file, if it finds it next
+ * to the program, to name the functions in a profile (nachos -prof).
+ *
  * Also assumes that the COFF file has at most 3 segments:
  *	.text	-- read-only executable instructions 
  *	.data	-- initialized data
@@ -148,6 +153,133 @@ void Write(int fd, char *buf, int nBytes)
     }
 }
 
+/****************************************************************/
+/* Routines for writing out the procedures in the symbol table.
+ */
+
+/* a procedure, and where it starts */
+typedef struct {
+    unsigned int address;
+    char *name;
+} Symbol;
+
+/* order procedures by address, then by name */
+static int
+SymbolCompare(const void *x, const void *y)
+{
+    const Symbol *a = (const Symbol *) x, *b = (const Symbol *) y;
+
+    if (a->address != b->address)
+	return (a->address < b->address) ? -1 : 1;
+    return strcmp(a->name, b->name);
+}
+
+/* read "size" bytes of a table from "offset" in the COFF file */
+static char *
+ReadTable(int fd, long offset, long size)
+{
+    char *table = malloc(size > 0 ? size : 1);
+
+    lseek(fd, offset, 0);
+    Read(fd, table, size);
+    return table;
+}
+
+/* add "sym" to "procs" if it is a procedure in the text segment */
+static void
+AddSymbol(Symbol *procs, int *numProcs, SYMR *sym, char *strings)
+{
+    sym->iss = WordToHost(sym->iss);
+    sym->value = WordToHost(sym->value);
+    sym->st_sc = WordToHost(sym->st_sc);
+    if ((SymType(sym) == stProc || SymType(sym) == stStaticProc)
+	&& SymClass(sym) == scText) {
+	procs[*numProcs].address = sym->value;
+	procs[*numProcs].name = strings + sym->iss;
+	(*numProcs)++;
+    }
+}
+
+/* write the procedures in the symbol table (local symbols, for static
+ * procedures, and external ones) to "symFileName"
+ */
+static void
+WriteSymbols(int fdIn, struct filehdr *fileh, char *symFileName)
+{
+    HDRR hdr;
+    FDR *fdrs;
+    SYMR *syms;
+    EXTR *exts;
+    char *ss, *ssExt;
+    Symbol *procs;
+    int numProcs = 0, i, j;
+    FILE *out;
+
+    if (WordToHost(fileh->f_symptr) == 0) {
+	fprintf(stderr, "No symbol table, so no %s\n", symFileName);
+	return;
+    }
+    lseek(fdIn, WordToHost(fileh->f_symptr), 0);
+    ReadStruct(fdIn, hdr);
+    if (ShortToHost(hdr.magic) != magicSym) {
+	fprintf(stderr, "Bad symbol table, so no %s\n", symFileName);
+	return;
+    }
+    hdr.isymMax = WordToHost(hdr.isymMax);
+    hdr.issExtMax = WordToHost(hdr.issExtMax);
+    hdr.ifdMax = WordToHost(hdr.ifdMax);
+    hdr.iextMax = WordToHost(hdr.iextMax);
+
+    fdrs = (FDR *) ReadTable(fdIn, WordToHost(hdr.cbFdOffset),
+			     hdr.ifdMax * sizeof(FDR));
+    syms = (SYMR *) ReadTable(fdIn, WordToHost(hdr.cbSymOffset),
+			      hdr.isymMax * sizeof(SYMR));
+    exts = (EXTR *) ReadTable(fdIn, WordToHost(hdr.cbExtOffset),
+			      hdr.iextMax * sizeof(EXTR));
+    ss = ReadTable(fdIn, WordToHost(hdr.cbSsOffset),
+		   WordToHost(hdr.issMax));
+    ssExt = ReadTable(fdIn, WordToHost(hdr.cbSsExtOffset), hdr.issExtMax);
+    procs = (Symbol *) malloc((hdr.isymMax + hdr.iextMax + 1) *
+			      sizeof(Symbol));
+
+    for (i = 0; i < hdr.ifdMax; i++) {
+	long isymBase = WordToHost(fdrs[i].isymBase);
+	long csym = WordToHost(fdrs[i].csym);
+	long issBase = WordToHost(fdrs[i].issBase);
+
+	for (j = 0; j < csym && isymBase + j < hdr.isymMax; j++)
+	    AddSymbol(procs, &numProcs, &syms[isymBase + j], ss + issBase);
+    }
+    for (i = 0; i < hdr.iextMax; i++)
+	AddSymbol(procs, &numProcs, &exts[i].asym, ssExt);
+    qsort(procs, numProcs, sizeof(Symbol), SymbolCompare);
+
+    out = fopen(symFileName, "w");
+    if (out == NULL) {
+	perror(symFileName);
+	unlink(noffFileName);
+	exit(1);
+    }
+    for (i = j = 0; i < numProcs; i++) {
+	/* a global procedure shows up among the local symbols too */
+	if (i > 0 && SymbolCompare(&procs[i - 1], &procs[i]) == 0)
+	    continue;
+	fprintf(out, "%08x %s\n", procs[i].address, procs[i].name);
+	j++;
+    }
+    fclose(out);
+    printf("Wrote %d procedures to %s\n", j, symFileName);
+
+    free(procs);
+    free(ssExt);
+    free(ss);
+    free(exts);
+    free(syms);
+    free(fdrs);
+}
+
+/****************************************************************/
+
 int main(int argc, char **argv)
 {
     int fdIn, fdOut, numsections, i, inNoffFile;
@@ -158,7 +290,8 @@ int main(int argc, char **argv)
     NoffHeader noffH;
 
     if (argc < 2) {
-	fprintf(stderr, "Usage: %s <coffFileName> <noffFileName>\n", argv[0]);
+	fprintf(stderr, "Usage: %s <coffFileName> <noffFileName> "
+		"[<symFileName>]\n", argv[0]);
 	exit(1);
     }
     
@@ -294,6 +427,8 @@ int main(int argc, char **argv)
     SwapHeader(&noffH);
     
     Write(fdOut, (char *)&noffH, sizeof(NoffHeader));
+    if (argc > 3)
+	WriteSymbols(fdIn, &fileh, argv[3]);
     close(fdIn);
     close(fdOut);
     exit(0);
@@ -15,6 +15,38 @@ scl enable devtoolset-8 'make'
 ./scripts/verify --output ./tests/00.out --answer ./tests/00.ans
 
 
+####################################################
+####          n = 200 binary verify             ####
+####################################################
+# ./item_convert ./tests/00.in ./tests/00.bin binary
+# ./main 200 ./tests/00.bin ./tests/00.out.bin --binary-output
+# ./item_convert ./tests/00.out.bin ./tests/00.out text
+# ./scripts/verify --output ./tests/00.out --answer ./tests/00.ans
+
+
+####################################################
+####        short binary input                  ####
+####################################################
+# a binary file with fewer records than n must fail rather than hang
+head -n 10 ./tests/00.in > ./tests/short.in
+./item_convert ./tests/short.in ./tests/short.bin binary
+timeout 60 ./main 20 ./tests/short.bin ./tests/short.out
+status=$?
+if [ $status -eq 0 ] || [ $status -eq 124 ]; then
+	echo "short input: expected an error, got status $status"
+fi
+rm -f ./tests/short.in
+
+
+####################################################
+####        n = 200 sharded verify              ####
+####################################################
+# every shard has fewer items than the worker queue holds
+./main 200 ./tests/00.in ./tests/00.shards.out --shards 4 --ordered
+./scripts/verify --output ./tests/00.shards.out --answer ./tests/00.ans
+# ./scripts/bench_shards.sh 40000 4
+
+
 ####################################################
 ####        n = 40000 gen transfomer            ####
 ####################################################
@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include "thread.hpp"
 #include "ts_queue.hpp"
+#include "output_merger.hpp"
 #include "item.hpp"
 #include "transformer.hpp"
 
@@ -13,6 +14,9 @@ public:
 	// constructor
 	Consumer(TSQueue<Item*>* worker_queue, TSQueue<Item*>* output_queue, Transformer* transformer);
 
+	// constructor, pushes results into a private ring of the OutputMerger
+	Consumer(TSQueue<Item*>* worker_queue, OutputMerger* output_merger, Transformer* transformer);
+
 	// destructor
 	~Consumer();
 
@@ -23,6 +27,10 @@ private:
 	TSQueue<Item*>* worker_queue;
 	TSQueue<Item*>* output_queue;
 
+	// set instead of output_queue when the Consumer owns an output ring
+	OutputMerger* output_merger;
+	SPSCRing<Item*>* output_ring;
+
 	Transformer* transformer;
 
 	bool is_cancel;
@@ -32,7 +40,14 @@ private:
 };
 
 Consumer::Consumer(TSQueue<Item*>* worker_queue, TSQueue<Item*>* output_queue, Transformer* transformer)
-	: worker_queue(worker_queue), output_queue(output_queue), transformer(transformer) {
+	: worker_queue(worker_queue), output_queue(output_queue),
+	output_merger(nullptr), output_ring(nullptr), transformer(transformer) {
+	is_cancel = false;
+}
+
+Consumer::Consumer(TSQueue<Item*>* worker_queue, OutputMerger* output_merger, Transformer* transformer)
+	: worker_queue(worker_queue), output_queue(nullptr),
+	output_merger(output_merger), output_ring(nullptr), transformer(transformer) {
 	is_cancel = false;
 }
 
@@ -40,6 +55,9 @@ Consumer::~Consumer() {}
 
 void Consumer::start() {
 	// TODO: starts a Consumer thread
+	if (output_merger)
+		output_ring = output_merger->attach();
+
 	pthread_create(&t, 0, Consumer::process, (void*)this);
 }
 
@@ -54,6 +72,7 @@ void* Consumer::process(void* arg) {
 	Consumer* consumer = (Consumer*)arg;
 
 	pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, nullptr);
+	Tracer::set_thread_name("Consumer");
 
 	while (!consumer->is_cancel) {
 		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, nullptr);
@@ -63,12 +82,21 @@ void* Consumer::process(void* arg) {
 		// transformer.consumer_transform()
 		// Put the Item with new value into the Output Queue
 		Item *item = consumer->worker_queue->dequeue();
+		long long start = Tracer::now();
 		item->val = consumer->transformer->consumer_transform(item->opcode, item->val);
-		consumer->output_queue->enqueue(item);
+		Tracer::span("transform", start);
+		if (consumer->output_ring)
+			consumer->output_merger->push(consumer->output_ring, item);
+		else
+			consumer->output_queue->enqueue(item);
 
 		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, nullptr);
 	}
 
+	// the Writer deletes the ring once it has drained it
+	if (consumer->output_ring)
+		consumer->output_merger->detach(consumer->output_ring);
+
 	delete consumer;
 
 	return nullptr;
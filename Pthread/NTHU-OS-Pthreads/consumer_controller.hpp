@@ -1,21 +1,32 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <vector>
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include "consumer.hpp"
 #include "ts_queue.hpp"
+#include "output_merger.hpp"
 #include "item.hpp"
 #include "transformer.hpp"
+#include "resizable.hpp"
 
 #ifndef CONSUMER_CONTROLLER
 #define CONSUMER_CONTROLLER
 
+// A queue is grown when its writers were blocked on a full buffer for more
+// than this percentage of the last check period.
+#define RESIZE_GROW_BLOCKED_PERCENTAGE 5
+// A queue is shrunk when nobody was blocked and it is less than this
+// percentage full.
+#define RESIZE_SHRINK_SIZE_PERCENTAGE 25
+
 class ConsumerController : public Thread {
 public:
 	// constructor
 	ConsumerController(
 		TSQueue<Item*>* worker_queue,
-		TSQueue<Item*>* writer_queue,
+		OutputMerger* output_merger,
 		Transformer* transformer,
 		int check_period,
 		int low_threshold,
@@ -27,11 +38,43 @@ public:
 
 	virtual void start();
 
+	// let the controller grow and shrink `queue` between min_capacity and
+	// max_capacity, `name` is used in the log messages
+	void add_resizable(Resizable* queue, const char* name, int min_capacity, int max_capacity);
+
+	// limit the bytes used by all resizable queues, counting each slot as
+	// an Item pointer plus the Item it refers to
+	void set_memory_budget(long long bytes);
+
+	// return how often consumers were scaled up and down so far
+	int get_scale_ups();
+	int get_scale_downs();
+
+	// return the largest number of consumers running at once
+	int get_max_consumers();
+
 private:
+	struct ResizableQueue {
+		Resizable* queue;
+		const char* name;
+		int min_capacity;
+		int max_capacity;
+	};
+
 	std::vector<Consumer*> consumers;
+	std::vector<ResizableQueue> resizables;
+
+	// the memory all resizable queues may use in bytes, 0 for unlimited
+	long long memory_budget;
+
+	// statistics, read by other threads while the controller runs
+	std::atomic<int> scale_ups;
+	std::atomic<int> scale_downs;
+	std::atomic<int> max_consumers;
 
 	TSQueue<Item*>* worker_queue;
-	TSQueue<Item*>* writer_queue;
+	// each Consumer gets its own output ring in here
+	OutputMerger* output_merger;
 
 	Transformer* transformer;
 
@@ -44,6 +87,9 @@ private:
 	// the number of consumers scaled up by 1.
 	int high_threshold;
 
+	// resize the queues from the blocked time observed in the last period
+	void resize_queues();
+
 	static void* process(void* arg);
 };
 
@@ -51,13 +97,17 @@ private:
 
 ConsumerController::ConsumerController(
 	TSQueue<Item*>* worker_queue,
-	TSQueue<Item*>* writer_queue,
+	OutputMerger* output_merger,
 	Transformer* transformer,
 	int check_period,
 	int low_threshold,
 	int high_threshold
-) : worker_queue(worker_queue),
-	writer_queue(writer_queue),
+) : memory_budget(0),
+	scale_ups(0),
+	scale_downs(0),
+	max_consumers(0),
+	worker_queue(worker_queue),
+	output_merger(output_merger),
 	transformer(transformer),
 	check_period(check_period),
 	low_threshold(low_threshold),
@@ -71,6 +121,65 @@ void ConsumerController::start() {
 	pthread_create(&t, 0, ConsumerController::process, (void*)this);
 }
 
+void ConsumerController::add_resizable(Resizable* queue, const char* name,
+                                       int min_capacity, int max_capacity) {
+	ResizableQueue resizable = {queue, name, min_capacity, max_capacity};
+	resizables.push_back(resizable);
+}
+
+void ConsumerController::set_memory_budget(long long bytes) {
+	memory_budget = bytes;
+}
+
+int ConsumerController::get_scale_ups() {
+	return scale_ups;
+}
+
+int ConsumerController::get_scale_downs() {
+	return scale_downs;
+}
+
+int ConsumerController::get_max_consumers() {
+	return max_consumers;
+}
+
+void ConsumerController::resize_queues() {
+	const long long slot_bytes = sizeof(Item*) + sizeof(Item);
+
+	long long used_bytes = 0;
+	for (ResizableQueue& r : resizables)
+		used_bytes += r.queue->get_allocated() * slot_bytes;
+
+	for (ResizableQueue& r : resizables) {
+		long long blocked_ns = r.queue->take_blocked_full_ns();
+		int capacity = r.queue->get_capacity();
+		int allocated = r.queue->get_allocated();
+		int new_capacity = capacity;
+
+		if (blocked_ns * 100 > (long long)check_period * 1000 * RESIZE_GROW_BLOCKED_PERCENTAGE) {
+			// doubling the capacity doubles what this queue allocates
+			new_capacity = std::min(capacity * 2, r.max_capacity);
+			if (memory_budget > 0 && used_bytes + allocated * slot_bytes > memory_budget)
+				new_capacity = capacity;
+		} else if (blocked_ns == 0 &&
+		           r.queue->get_size() * 100 < allocated * RESIZE_SHRINK_SIZE_PERCENTAGE) {
+			new_capacity = std::max(capacity / 2, r.min_capacity);
+		}
+
+		if (new_capacity == capacity)
+			continue;
+
+		r.queue->resize(new_capacity);
+		used_bytes += (long long)(new_capacity - capacity) * (allocated / capacity) * slot_bytes;
+		Tracer::instant("resize", new_capacity);
+
+		// stderr, so that it never mixes with the scaling messages the
+		// program's output is checked against
+		std::cerr << "Resizing " << r.name << " from " << capacity
+				  << " to " << new_capacity << "\n";
+	}
+}
+
 void* ConsumerController::process(void* arg) {
 	// TODO: implements the ConsumerController's work
 	// In the beginning, no Consumer thread is created by ConsumerController
@@ -78,14 +187,20 @@ void* ConsumerController::process(void* arg) {
 	// Worker Queue size > high_threshold -> new Consumer
 	// Worker Queue size < low_threshold -> call Consumer->cancel
 	ConsumerController *controller = (ConsumerController*)arg;
+	Tracer::set_thread_name("ConsumerController");
+
 	while (1) {
 		usleep(controller->check_period);
 
 		if (controller->worker_queue->get_size() > controller->high_threshold) {
-			Consumer *one_worker = new Consumer(controller->worker_queue, controller->writer_queue, controller->transformer);
+			Consumer *one_worker = new Consumer(controller->worker_queue, controller->output_merger, controller->transformer);
 
 			controller->consumers.push_back(one_worker);
 			one_worker->start();
+			Tracer::instant("scale up", controller->consumers.size());
+			controller->scale_ups++;
+			if ((int)controller->consumers.size() > controller->max_consumers)
+				controller->max_consumers = controller->consumers.size();
 
 
 			std::cout << "Scaling up consumers from " << controller->consumers.size() - 1
@@ -97,10 +212,14 @@ void* ConsumerController::process(void* arg) {
 
 			controller->consumers.pop_back();
 			one_worker->cancel();
+			Tracer::instant("scale down", controller->consumers.size());
+			controller->scale_downs++;
 
 			std::cout << "Scaling down consumers from " << controller->consumers.size() + 1
 					  << " to " << controller->consumers.size() << "\n";
 		}
+
+		controller->resize_queues();
 	}
 }
 
@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <string>
+#include "ts_queue.hpp"
+#include "reader.hpp"
+#include "writer.hpp"
+#include "item_record.hpp"
+
+// Converts an item file between the text and the binary record format.
+// The input format is detected from the file magic.
+//
+//   ./item_convert <input> <output> text|binary
+
+// return the number of items in `file`
+long long count_items(std::string file) {
+	std::ifstream ifs(file, std::ios::binary);
+	unsigned char header[ITEM_RECORD_HEADER_SIZE];
+	ifs.read((char*)header, ITEM_RECORD_HEADER_SIZE);
+
+	unsigned long long count;
+	if (decode_item_header(header, ifs.gcount(), &count))
+		return count;
+
+	ifs.clear();
+	ifs.seekg(0);
+	long long lines = 0;
+	std::string line;
+	while (std::getline(ifs, line)) {
+		if (!line.empty())
+			lines++;
+	}
+	return lines;
+}
+
+int main(int argc, char** argv) {
+	if (argc != 4 || (strcmp(argv[3], "text") != 0 && strcmp(argv[3], "binary") != 0)) {
+		fprintf(stderr, "usage: %s <input> <output> text|binary\n", argv[0]);
+		return 1;
+	}
+
+	long long n = count_items(argv[1]);
+	ItemFormat format = strcmp(argv[3], "binary") == 0 ? BINARY_FORMAT : TEXT_FORMAT;
+
+	TSQueue<Item*>* q = new TSQueue<Item*>;
+	Reader* reader = new Reader(n, argv[1], q);
+	if (!reader->good())
+		return 1;
+	Writer* writer = new Writer(n, argv[2], q, format);
+
+	reader->start();
+	writer->start();
+
+	reader->join();
+	writer->join();
+
+	delete writer;
+	delete reader;
+	delete q;
+
+	return 0;
+}
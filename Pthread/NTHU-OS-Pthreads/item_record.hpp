@@ -0,0 +1,111 @@
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include "item.hpp"
+
+#ifndef ITEM_RECORD_HPP
+#define ITEM_RECORD_HPP
+
+// A binary item file starts with a 16 byte header, the magic followed by
+// the record count as a little-endian uint64. Then come fixed-width
+// records, all fields little-endian:
+//
+//   offset  0  uint64  val
+//   offset  8  int32   key
+//   offset 12  char    opcode
+//   offset 13  3 bytes zero padding
+#define ITEM_RECORD_MAGIC "ITEMBIN1"
+#define ITEM_RECORD_MAGIC_SIZE 8
+#define ITEM_RECORD_HEADER_SIZE 16
+#define ITEM_RECORD_SIZE 16
+
+// the number of records the Writer collects before one write()
+#define ITEM_RECORD_BLOCK 4096
+
+enum ItemFormat {
+	TEXT_FORMAT,
+	BINARY_FORMAT
+};
+
+// fill `out` with the file header for `count` records
+void encode_item_header(unsigned char* out, unsigned long long count);
+
+// return whether `in` starts with a valid header and store its count
+bool decode_item_header(const unsigned char* in, size_t length, unsigned long long* count);
+
+// fill `out` with the record of `item`
+void encode_item(unsigned char* out, const Item& item);
+
+// load `item` from the record at `in`
+void decode_item(const unsigned char* in, Item* item);
+
+// write all `length` bytes, retrying short writes
+bool write_all(int fd, const unsigned char* buf, size_t length);
+
+// Implementation start
+
+static void put_le64(unsigned char* out, unsigned long long v) {
+	for (int i = 0; i < 8; i++)
+		out[i] = (unsigned char)(v >> (8 * i));
+}
+
+static unsigned long long get_le64(const unsigned char* in) {
+	unsigned long long v = 0;
+	for (int i = 0; i < 8; i++)
+		v |= (unsigned long long)in[i] << (8 * i);
+	return v;
+}
+
+static void put_le32(unsigned char* out, unsigned int v) {
+	for (int i = 0; i < 4; i++)
+		out[i] = (unsigned char)(v >> (8 * i));
+}
+
+static unsigned int get_le32(const unsigned char* in) {
+	unsigned int v = 0;
+	for (int i = 0; i < 4; i++)
+		v |= (unsigned int)in[i] << (8 * i);
+	return v;
+}
+
+void encode_item_header(unsigned char* out, unsigned long long count) {
+	memcpy(out, ITEM_RECORD_MAGIC, ITEM_RECORD_MAGIC_SIZE);
+	put_le64(out + ITEM_RECORD_MAGIC_SIZE, count);
+}
+
+bool decode_item_header(const unsigned char* in, size_t length, unsigned long long* count) {
+	if (length < ITEM_RECORD_HEADER_SIZE || memcmp(in, ITEM_RECORD_MAGIC, ITEM_RECORD_MAGIC_SIZE) != 0)
+		return false;
+
+	*count = get_le64(in + ITEM_RECORD_MAGIC_SIZE);
+	return true;
+}
+
+void encode_item(unsigned char* out, const Item& item) {
+	put_le64(out, item.val);
+	put_le32(out + 8, (unsigned int)item.key);
+	out[12] = item.opcode;
+	out[13] = out[14] = out[15] = 0;
+}
+
+void decode_item(const unsigned char* in, Item* item) {
+	item->val = get_le64(in);
+	item->key = (int)get_le32(in + 8);
+	item->opcode = in[12];
+}
+
+bool write_all(int fd, const unsigned char* buf, size_t length) {
+	while (length > 0) {
+		ssize_t n = write(fd, buf, length);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		buf += n;
+		length -= n;
+	}
+
+	return true;
+}
+
+#endif // ITEM_RECORD_HPP
@@ -1,37 +1,43 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <time.h>
+#include <algorithm>
 #include "ts_queue.hpp"
 #include "item.hpp"
 #include "reader.hpp"
 #include "writer.hpp"
 #include "producer.hpp"
 #include "consumer_controller.hpp"
+#include "tracer.hpp"
+#include "shard_launcher.hpp"
 
 #define READER_QUEUE_SIZE 200
 #define WORKER_QUEUE_SIZE 200
+// the capacity of each Consumer's output ring
 #define WRITER_QUEUE_SIZE 4000
 #define CONSUMER_CONTROLLER_LOW_THRESHOLD_PERCENTAGE 20
 #define CONSUMER_CONTROLLER_HIGH_THRESHOLD_PERCENTAGE 80
 #define CONSUMER_CONTROLLER_CHECK_PERIOD 1000000
+// the controller resizes each queue between its size / QUEUE_RESIZE_FACTOR
+// and its size * QUEUE_RESIZE_FACTOR within QUEUE_MEMORY_BUDGET bytes
+#define QUEUE_RESIZE_FACTOR 16
+#define QUEUE_MEMORY_BUDGET (64 << 20)
 
-int main(int argc, char** argv) {
-	assert(argc == 4);
-	// struct timespec start, end;
-	// clock_gettime(CLOCK_MONOTONIC, &start);
+// runs one Reader -> Producer -> Consumer -> Writer chain over the first n
+// items of the input and fills `stats` when it is not null
+int run_pipeline(int n, std::string input_file_name, std::string output_file_name,
+                 ItemFormat output_format, std::string trace_file_name, ShardStats* stats) {
+	long long start_ns = Tracer::clock_ns();
 
-
-	int n = atoi(argv[1]);
-	std::string input_file_name(argv[2]);
-	std::string output_file_name(argv[3]);
-	// int doExperiment = atoi(argv[4]);
+	if (!trace_file_name.empty())
+		Tracer::enable();
 
 	// TODO: implements main function
 	// Construct
 	Transformer *transformer = new Transformer();
 	TSQueue<Item*>* reader_queue = NULL;
 	TSQueue<Item*>* worker_queue = NULL;
-	TSQueue<Item*>* writer_queue = NULL;
+	OutputMerger* output_merger = NULL;
 	ConsumerController* controller = NULL;
 
 	// if (doExperiment == 1) {
@@ -50,33 +56,54 @@ int main(int argc, char** argv) {
 
 	// 	reader_queue = new TSQueue<Item*>(reader_size);
 	// 	worker_queue = new TSQueue<Item*>(worker_size);
-	// 	writer_queue = new TSQueue<Item*>(writer_size);
+	// 	output_merger = new OutputMerger(writer_size);
 
-	// 	controller = new ConsumerController(worker_queue, writer_queue, transformer,
+	// 	controller = new ConsumerController(worker_queue, output_merger, transformer,
 	// 										check_period,
 	// 										worker_size * low / 100,
 	// 										worker_size * high / 100);
 	// } else {
 	// 		std::cout << "default setting.\n";
-	// reader_queue = new TSQueue<Item*>(READER_QUEUE_SIZE);
-	// worker_queue = new TSQueue<Item*>(WORKER_QUEUE_SIZE);
-	// writer_queue = new TSQueue<Item*>(WRITER_QUEUE_SIZE);
-	// controller = new ConsumerController(worker_queue, writer_queue, transformer,
-	// 									CONSUMER_CONTROLLER_CHECK_PERIOD,
-	// 									WORKER_QUEUE_SIZE * CONSUMER_CONTROLLER_LOW_THRESHOLD_PERCENTAGE / 100,
-	// 									WORKER_QUEUE_SIZE * CONSUMER_CONTROLLER_HIGH_THRESHOLD_PERCENTAGE / 100);
+	reader_queue = new TSQueue<Item*>(READER_QUEUE_SIZE);
+	worker_queue = new TSQueue<Item*>(WORKER_QUEUE_SIZE);
+	output_merger = new OutputMerger(WRITER_QUEUE_SIZE);
+
+	// the thresholds are taken of what the worker queue can ever hold:
+	// with fewer items than its size (a small shard), the high threshold
+	// would otherwise never be passed and no consumer would start
+	int worker_fill = std::min(n, WORKER_QUEUE_SIZE);
+	controller = new ConsumerController(worker_queue, output_merger, transformer,
+										CONSUMER_CONTROLLER_CHECK_PERIOD,
+										worker_fill * CONSUMER_CONTROLLER_LOW_THRESHOLD_PERCENTAGE / 100,
+										worker_fill * CONSUMER_CONTROLLER_HIGH_THRESHOLD_PERCENTAGE / 100);
 	// }
 
+	// the worker queue never shrinks below its size so that the high
+	// threshold stays reachable
+	controller->add_resizable(reader_queue, "reader queue",
+							  READER_QUEUE_SIZE / QUEUE_RESIZE_FACTOR,
+							  READER_QUEUE_SIZE * QUEUE_RESIZE_FACTOR);
+	controller->add_resizable(worker_queue, "worker queue",
+							  WORKER_QUEUE_SIZE,
+							  WORKER_QUEUE_SIZE * QUEUE_RESIZE_FACTOR);
+	controller->add_resizable(output_merger, "writer rings",
+							  WRITER_QUEUE_SIZE / QUEUE_RESIZE_FACTOR,
+							  WRITER_QUEUE_SIZE * QUEUE_RESIZE_FACTOR);
+	controller->set_memory_budget(QUEUE_MEMORY_BUDGET);
+
 
 
 	Reader* reader = new Reader(n, input_file_name, reader_queue);
+	// the writer would wait forever for the missing items
+	if (!reader->good())
+		return 1;
 
 	Producer* producer0 = new Producer(reader_queue, worker_queue, transformer);
 	Producer* producer1 = new Producer(reader_queue, worker_queue, transformer);
 	Producer* producer2 = new Producer(reader_queue, worker_queue, transformer);
 	Producer* producer3 = new Producer(reader_queue, worker_queue, transformer);
 
-	Writer* writer = new Writer(n, output_file_name, writer_queue);
+	Writer* writer = new Writer(n, output_file_name, output_merger, output_format);
 
 	// Transfer
 	reader->start();
@@ -94,20 +121,70 @@ int main(int argc, char** argv) {
 	reader->join();
 	writer->join();
 
-	delete transformer;
-	delete reader_queue;
-	delete worker_queue;
-	delete writer_queue;
+	if (!trace_file_name.empty() && !Tracer::dump(trace_file_name))
+		std::cerr << "failed to write trace to " << trace_file_name << "\n";
+
+	// Producers, consumers and the controller never return and are still
+	// blocked on the queues, destroying the queues under them would hang.
+	// They are reclaimed at process exit instead.
 	delete reader;
-	delete producer0;
-	delete producer1;
-	delete producer2;
-	delete producer3;
-	delete controller;
 	delete writer;
 
+	if (stats) {
+		stats->items = n;
+		stats->elapsed = (Tracer::clock_ns() - start_ns) / 1e9;
+		stats->scale_ups = controller->get_scale_ups();
+		stats->scale_downs = controller->get_scale_downs();
+		stats->max_consumers = controller->get_max_consumers();
+	}
+
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	assert(argc >= 4);
+	// struct timespec start, end;
+	// clock_gettime(CLOCK_MONOTONIC, &start);
+
+
+	int n = atoi(argv[1]);
+	std::string input_file_name(argv[2]);
+	std::string output_file_name(argv[3]);
+	// int doExperiment = atoi(argv[4]);
+
+	// optional flags after the positional arguments
+	std::string trace_file_name;
+	ItemFormat output_format = TEXT_FORMAT;
+	int shards = 0;
+	bool ordered = false;
+	for (int i = 4; i < argc; i++) {
+		std::string opt(argv[i]);
+		if (opt == "--trace" && i + 1 < argc) {
+			trace_file_name = argv[++i];
+		} else if (opt == "--binary-output") {
+			output_format = BINARY_FORMAT;
+		} else if (opt == "--shards" && i + 1 < argc) {
+			shards = atoi(argv[++i]);
+		} else if (opt == "--ordered") {
+			ordered = true;
+		} else {
+			std::cerr << "unknown option: " << opt << "\n";
+			return 1;
+		}
+	}
+
+	// with --shards K the input runs through K pipeline processes
+	if (shards > 0) {
+		ShardLauncher launcher(n, input_file_name, output_file_name, shards,
+		                       ordered, output_format, trace_file_name);
+		return launcher.run(run_pipeline);
+	}
+
+	int status = run_pipeline(n, input_file_name, output_file_name, output_format,
+	                          trace_file_name, nullptr);
+
 	// clock_gettime(CLOCK_MONOTONIC, &end);
 	// double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
 	// std::cout << "execution time: " << elapsed << " seconds\n";
-	return 0;
+	return status;
 }
@@ -0,0 +1,253 @@
+#include <pthread.h>
+#include <sched.h>
+#include <atomic>
+#include <vector>
+#include "spsc_ring.hpp"
+#include "tracer.hpp"
+#include "item.hpp"
+#include "resizable.hpp"
+
+#ifndef OUTPUT_MERGER_HPP
+#define OUTPUT_MERGER_HPP
+
+// OutputMerger replaces the single writer queue. Every Consumer pushes into
+// its own SPSCRing without taking a lock, and the Writer drains all rings
+// round-robin. The mutex is only taken when a ring is attached or reaped and
+// when the Writer has nothing to do and goes to sleep.
+//
+// Resizing only changes the size of new rings. A Consumer whose ring has
+// an outdated size moves to a fresh ring on its next push and closes the
+// old one, which the Writer drains and reaps as usual. Items of that
+// Consumer may come out of order around the switch.
+class OutputMerger : public Resizable {
+public:
+	// constructor
+	explicit OutputMerger(int ring_size);
+
+	// destructor
+	~OutputMerger();
+
+	// create a ring for a new Consumer
+	SPSCRing<Item*>* attach();
+
+	// called by a Consumer that will not push anymore, the Writer deletes
+	// the ring once it is drained
+	void detach(SPSCRing<Item*>* ring);
+
+	// called by a Consumer to add an item to its own ring, replaces the
+	// ring when its size is outdated
+	void push(SPSCRing<Item*>*& ring, Item* item);
+
+	// called by the Writer to remove the next item of any ring
+	Item* pop();
+
+	// return the number of rings not reaped yet
+	int get_ring_count();
+
+	// change the capacity of each ring
+	virtual void resize(int new_ring_size) override;
+
+	// return the capacity of each ring
+	virtual int get_capacity() override;
+
+	// return the slots allocated over all rings
+	virtual int get_allocated() override;
+
+	// return the number of items pushed but not popped yet
+	virtual int get_size() override;
+
+	virtual long long take_blocked_full_ns() override;
+private:
+	// the capacity of each new ring
+	std::atomic<int> ring_size;
+
+	// protects `rings`
+	pthread_mutex_t mutex;
+	// signaled when an item is pushed while the Writer sleeps
+	pthread_cond_t cond;
+	// all rings not reaped yet
+	std::vector<SPSCRing<Item*>*> rings;
+	// bumped whenever `rings` changes
+	std::atomic<int> version;
+
+	// the Writer's own copy of `rings`, refreshed when `version` changes
+	std::vector<SPSCRing<Item*>*> snapshot;
+	int snapshot_version;
+	// the ring the Writer tries first on the next pop
+	size_t next;
+
+	// the number of items pushed but not popped yet, may be briefly
+	// negative since a push is counted after the item is visible
+	std::atomic<long long> pending;
+	// whether the Writer is waiting on `cond`
+	std::atomic<bool> sleeping;
+	// the nanoseconds Consumers spent waiting on a full ring
+	std::atomic<long long> blocked_full_ns;
+
+	bool try_pop(Item** item);
+	void reap();
+};
+
+// Implementation start
+
+OutputMerger::OutputMerger(int ring_size) : ring_size(ring_size), version(0),
+	snapshot_version(0), next(0), pending(0), sleeping(false), blocked_full_ns(0) {
+	pthread_mutex_init(&mutex, 0);
+	pthread_cond_init(&cond, 0);
+}
+
+OutputMerger::~OutputMerger() {
+	for (SPSCRing<Item*>* ring : rings)
+		delete ring;
+
+	pthread_mutex_destroy(&mutex);
+	pthread_cond_destroy(&cond);
+}
+
+SPSCRing<Item*>* OutputMerger::attach() {
+	SPSCRing<Item*>* ring = new SPSCRing<Item*>(ring_size);
+
+	pthread_mutex_lock(&mutex);
+	rings.push_back(ring);
+	version++;
+	pthread_mutex_unlock(&mutex);
+
+	return ring;
+}
+
+void OutputMerger::detach(SPSCRing<Item*>* ring) {
+	ring->close();
+}
+
+void OutputMerger::push(SPSCRing<Item*>*& ring, Item* item) {
+	if (ring->get_capacity() != ring_size.load(std::memory_order_relaxed)) {
+		SPSCRing<Item*>* old_ring = ring;
+		ring = attach();
+		detach(old_ring);
+	}
+
+	if (!ring->try_push(item)) {
+		long long start = Tracer::clock_ns();
+		while (!ring->try_push(item)) {
+			sched_yield();
+		}
+		long long blocked = Tracer::clock_ns() - start;
+		blocked_full_ns.fetch_add(blocked, std::memory_order_relaxed);
+		Tracer::span("blocked on enqueue", Tracer::now() - blocked);
+	}
+
+	// either the Writer sees the new count before sleeping, or we see it
+	// sleeping and wake it up
+	pending.fetch_add(1);
+	if (sleeping.load()) {
+		pthread_mutex_lock(&mutex);
+		pthread_cond_signal(&cond);
+		pthread_mutex_unlock(&mutex);
+	}
+}
+
+Item* OutputMerger::pop() {
+	Item* item;
+
+	while (!try_pop(&item)) {
+		reap();
+
+		long long start = Tracer::now();
+		pthread_mutex_lock(&mutex);
+		sleeping.store(true);
+		while (pending.load() <= 0) {
+			pthread_cond_wait(&cond, &mutex);
+		}
+		sleeping.store(false);
+		pthread_mutex_unlock(&mutex);
+		Tracer::span("blocked on dequeue", start);
+	}
+
+	pending.fetch_sub(1);
+	return item;
+}
+
+bool OutputMerger::try_pop(Item** item) {
+	if (version.load(std::memory_order_acquire) != snapshot_version) {
+		pthread_mutex_lock(&mutex);
+		snapshot = rings;
+		snapshot_version = version;
+		pthread_mutex_unlock(&mutex);
+	}
+
+	for (size_t i = 0; i < snapshot.size(); i++) {
+		size_t index = (next + i) % snapshot.size();
+		if (snapshot[index]->try_pop(item)) {
+			next = (index + 1) % snapshot.size();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void OutputMerger::reap() {
+	// closed must be checked before empty, a closed ring gets no more items
+	std::vector<SPSCRing<Item*>*> drained;
+	for (SPSCRing<Item*>* ring : snapshot) {
+		if (ring->is_closed() && ring->empty())
+			drained.push_back(ring);
+	}
+
+	if (drained.empty())
+		return;
+
+	pthread_mutex_lock(&mutex);
+	for (SPSCRing<Item*>* ring : drained) {
+		for (size_t i = 0; i < rings.size(); i++) {
+			if (rings[i] == ring) {
+				rings.erase(rings.begin() + i);
+				break;
+			}
+		}
+		delete ring;
+	}
+	snapshot = rings;
+	snapshot_version = ++version;
+	pthread_mutex_unlock(&mutex);
+}
+
+int OutputMerger::get_ring_count() {
+	pthread_mutex_lock(&mutex);
+	int count = rings.size();
+	pthread_mutex_unlock(&mutex);
+
+	return count;
+}
+
+void OutputMerger::resize(int new_ring_size) {
+	if (new_ring_size < 1)
+		new_ring_size = 1;
+
+	ring_size.store(new_ring_size, std::memory_order_relaxed);
+}
+
+int OutputMerger::get_capacity() {
+	return ring_size.load(std::memory_order_relaxed);
+}
+
+int OutputMerger::get_allocated() {
+	pthread_mutex_lock(&mutex);
+	int allocated = 0;
+	for (SPSCRing<Item*>* ring : rings)
+		allocated += ring->get_capacity();
+	pthread_mutex_unlock(&mutex);
+
+	return allocated;
+}
+
+int OutputMerger::get_size() {
+	long long stable_val = pending.load();
+	return stable_val < 0 ? 0 : stable_val;
+}
+
+long long OutputMerger::take_blocked_full_ns() {
+	return blocked_full_ns.exchange(0, std::memory_order_relaxed);
+}
+
+#endif // OUTPUT_MERGER_HPP
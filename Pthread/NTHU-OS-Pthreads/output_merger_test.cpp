@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <assert.h>
+#include "ts_queue.hpp"
+#include "output_merger.hpp"
+
+// Compares the writer side of the pipeline: num_consumer threads push
+// num_item items each into either one shared TSQueue or their own rings of
+// an OutputMerger, while one writer thread drains them.
+
+#define QUEUE_SIZE 4000
+
+int num_consumer;
+int num_item;
+
+TSQueue<Item*>* q;
+OutputMerger* merger;
+
+// the nanoseconds each consumer spent inside enqueue/push
+long long* push_ns;
+
+long long now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void* consume_queue(void* arg) {
+	int tid = *(int*)arg;
+	Item* items = new Item[num_item];
+
+	long long start = now_ns();
+	for (int i = 0; i < num_item; i++)
+		q->enqueue(&items[i]);
+	push_ns[tid] = now_ns() - start;
+
+	return nullptr;
+}
+
+void* consume_merger(void* arg) {
+	int tid = *(int*)arg;
+	Item* items = new Item[num_item];
+	SPSCRing<Item*>* ring = merger->attach();
+
+	long long start = now_ns();
+	for (int i = 0; i < num_item; i++)
+		merger->push(ring, &items[i]);
+	push_ns[tid] = now_ns() - start;
+
+	merger->detach(ring);
+	return nullptr;
+}
+
+void* write_queue(void* arg) {
+	for (long long i = 0; i < (long long)num_consumer * num_item; i++)
+		q->dequeue();
+
+	return nullptr;
+}
+
+void* write_merger(void* arg) {
+	for (long long i = 0; i < (long long)num_consumer * num_item; i++)
+		merger->pop();
+
+	return nullptr;
+}
+
+void run(const char* name, void* (*consume)(void*), void* (*write)(void*)) {
+	pthread_t writer;
+	pthread_t* consumers = new pthread_t[num_consumer];
+	int* ids = new int[num_consumer];
+
+	long long start = now_ns();
+	pthread_create(&writer, 0, write, nullptr);
+	for (int i = 0; i < num_consumer; i++) {
+		ids[i] = i;
+		pthread_create(&consumers[i], 0, consume, (void*)&ids[i]);
+	}
+	for (int i = 0; i < num_consumer; i++)
+		pthread_join(consumers[i], 0);
+	pthread_join(writer, 0);
+	long long elapsed = now_ns() - start;
+
+	long long total_push_ns = 0;
+	for (int i = 0; i < num_consumer; i++)
+		total_push_ns += push_ns[i];
+
+	double items = (double)num_consumer * num_item;
+	printf("%-12s %10.0f items/s %8.1f ns/push\n", name,
+		items / (elapsed / 1e9), total_push_ns / items);
+
+	delete[] consumers;
+	delete[] ids;
+}
+
+int main(int argc, char** argv) {
+	assert(argc == 3);
+
+	num_consumer = atoi(argv[1]);
+	num_item = atoi(argv[2]);
+	push_ns = new long long[num_consumer];
+
+	q = new TSQueue<Item*>(QUEUE_SIZE);
+	run("TSQueue", consume_queue, write_queue);
+
+	merger = new OutputMerger(QUEUE_SIZE);
+	run("OutputMerger", consume_merger, write_merger);
+	assert(merger->get_ring_count() <= num_consumer);
+
+	delete q;
+	delete merger;
+
+	return 0;
+}
@@ -43,10 +43,13 @@ void* Producer::process(void* arg) {
 	// applies the Item with the Transformer::producer transform function: transformer.producer_transform()
 	// puts the result Item into the Worker Queue
 	Producer* producer = (Producer*)arg;
+	Tracer::set_thread_name("Producer");
 
 	while (1) {
 		Item *item = producer->input_queue->dequeue();
+		long long start = Tracer::now();
 		item->val = producer->transformer->producer_transform(item->opcode, item->val);
+		Tracer::span("transform", start);
 		producer->worker_queue->enqueue(item);
 	}
 
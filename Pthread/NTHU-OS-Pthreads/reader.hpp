@@ -1,28 +1,46 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <fstream>
+#include <iostream>
 #include "thread.hpp"
 #include "ts_queue.hpp"
 #include "item.hpp"
+#include "item_record.hpp"
 
 #ifndef READER_HPP
 #define READER_HPP
 
 class Reader : public Thread {
 public:
-	// constructor
+	// constructor, reads binary input when the file starts with
+	// ITEM_RECORD_MAGIC and text otherwise
 	Reader(int expected_lines, std::string input_file, TSQueue<Item*>* input_queue);
 
 	// destructor
 	~Reader();
 
 	virtual void start() override;
+
+	// false when binary input holds fewer records than expected,
+	// the reader must then not be started
+	bool good();
 private:
 	// the expected lines to read,
 	// the reader thread finished after input expected lines of item
 	int expected_lines;
+	bool short_input;
 
 	std::ifstream ifs;
 	TSQueue<Item*>* input_queue;
 
+	// the mapped binary input, nullptr for text input
+	unsigned char* mapped;
+	size_t mapped_size;
+	// the next binary record to load
+	const unsigned char* record;
+
 	// the method for pthread to create a reader thread
 	static void* process(void* arg);
 };
@@ -30,24 +48,65 @@ private:
 // Implementaion start
 
 Reader::Reader(int expected_lines, std::string input_file, TSQueue<Item*>* input_queue)
-	: expected_lines(expected_lines), input_queue(input_queue) {
-	ifs = std::ifstream(input_file);
+	: expected_lines(expected_lines), short_input(false), input_queue(input_queue),
+	mapped(nullptr), mapped_size(0), record(nullptr) {
+	int fd = open(input_file.c_str(), O_RDONLY);
+	struct stat st;
+	if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size >= ITEM_RECORD_HEADER_SIZE) {
+		void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		unsigned long long count;
+		if (p != MAP_FAILED && decode_item_header((unsigned char*)p, st.st_size, &count)) {
+			mapped = (unsigned char*)p;
+			mapped_size = st.st_size;
+			record = mapped + ITEM_RECORD_HEADER_SIZE;
+			madvise(p, st.st_size, MADV_SEQUENTIAL);
+
+			unsigned long long available = (st.st_size - ITEM_RECORD_HEADER_SIZE) / ITEM_RECORD_SIZE;
+			if (count > available)
+				count = available;
+			if ((unsigned long long)this->expected_lines > count) {
+				std::cerr << input_file << ": fewer than " << this->expected_lines << " records\n";
+				short_input = true;
+			}
+		} else if (p != MAP_FAILED) {
+			munmap(p, st.st_size);
+		}
+	}
+	if (fd >= 0)
+		close(fd);
+
+	if (mapped == nullptr)
+		ifs = std::ifstream(input_file);
 }
 
 Reader::~Reader() {
+	if (mapped)
+		munmap(mapped, mapped_size);
 	ifs.close();
 }
 
+bool Reader::good() {
+	return !short_input;
+}
+
 void Reader::start() {
 	pthread_create(&t, 0, Reader::process, (void*)this);
 }
 
 void* Reader::process(void* arg) {
 	Reader* reader = (Reader*)arg;
+	Tracer::set_thread_name("Reader");
 
 	while (reader->expected_lines--) {
 		Item *item = new Item;
-		reader->ifs >> *item;
+		long long start = Tracer::now();
+		if (reader->mapped) {
+			decode_item(reader->record, item);
+			reader->record += ITEM_RECORD_SIZE;
+		} else {
+			reader->ifs >> *item;
+		}
+		Tracer::span("read", start);
 		reader->input_queue->enqueue(item);
 
 		// std::cout << "Reader expected line " << reader->expected_lines << " + 1 \n";
@@ -0,0 +1,28 @@
+#ifndef RESIZABLE_HPP
+#define RESIZABLE_HPP
+
+// A buffer between two pipeline stages whose capacity can change while
+// threads use it. The ConsumerController resizes these from what it
+// observes through the getters.
+class Resizable {
+public:
+	virtual ~Resizable() {}
+
+	// change the capacity, elements already buffered are never dropped
+	virtual void resize(int new_capacity) = 0;
+
+	// return the capacity that resize() changes
+	virtual int get_capacity() = 0;
+
+	// return the number of slots currently allocated
+	virtual int get_allocated() = 0;
+
+	// return the number of elements currently buffered
+	virtual int get_size() = 0;
+
+	// return the nanoseconds writers spent blocked on a full buffer since
+	// the last call, and reset it
+	virtual long long take_blocked_full_ns() = 0;
+};
+
+#endif // RESIZABLE_HPP
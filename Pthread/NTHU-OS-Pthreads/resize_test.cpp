@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <assert.h>
+#include <atomic>
+#include <vector>
+#include "ts_queue.hpp"
+#include "output_merger.hpp"
+
+// Resizes a TSQueue and an OutputMerger at random while threads keep
+// passing items through them, and checks nothing is lost or reordered.
+
+#define NUM_ITEMS 200000
+#define NUM_RINGS 4
+
+TSQueue<int>* q;
+OutputMerger* merger;
+std::atomic<bool> done(false);
+
+void* enqueue_all(void* arg) {
+	for (int i = 0; i < NUM_ITEMS; i++)
+		q->enqueue(i);
+
+	return nullptr;
+}
+
+void* push_all(void* arg) {
+	Item* items = (Item*)arg;
+	SPSCRing<Item*>* ring = merger->attach();
+
+	for (int i = 0; i < NUM_ITEMS; i++)
+		merger->push(ring, &items[i]);
+
+	merger->detach(ring);
+	return nullptr;
+}
+
+void* resize_randomly(void* arg) {
+	Resizable* queue = (Resizable*)arg;
+	unsigned int seed = 1;
+
+	while (!done) {
+		queue->resize(rand_r(&seed) % 64 + 1);
+		sched_yield();
+	}
+
+	return nullptr;
+}
+
+int main() {
+	pthread_t producer, resizer;
+
+	// a single enqueuer must see its elements dequeued in order
+	q = new TSQueue<int>(8);
+	pthread_create(&producer, 0, enqueue_all, nullptr);
+	pthread_create(&resizer, 0, resize_randomly, (void*)q);
+	for (int i = 0; i < NUM_ITEMS; i++)
+		assert(q->dequeue() == i);
+	done = true;
+	pthread_join(producer, 0);
+	pthread_join(resizer, 0);
+	assert(q->get_size() == 0);
+	printf("TSQueue: %d items in order\n", NUM_ITEMS);
+
+	// a Consumer moving to a new ring may get its items reordered, but
+	// every item must come out exactly once
+	merger = new OutputMerger(8);
+	Item* items[NUM_RINGS];
+	pthread_t pushers[NUM_RINGS];
+	std::vector<bool> seen[NUM_RINGS];
+	for (int r = 0; r < NUM_RINGS; r++) {
+		items[r] = new Item[NUM_ITEMS];
+		for (int i = 0; i < NUM_ITEMS; i++)
+			items[r][i] = Item(r, i, 'A');
+		seen[r].assign(NUM_ITEMS, false);
+		pthread_create(&pushers[r], 0, push_all, (void*)items[r]);
+	}
+
+	done = false;
+	pthread_create(&resizer, 0, resize_randomly, (void*)merger);
+	for (int i = 0; i < NUM_ITEMS * NUM_RINGS; i++) {
+		Item* item = merger->pop();
+		assert(!seen[item->key][item->val]);
+		seen[item->key][item->val] = true;
+	}
+	done = true;
+	for (int r = 0; r < NUM_RINGS; r++)
+		pthread_join(pushers[r], 0);
+	pthread_join(resizer, 0);
+	printf("OutputMerger: %d items exactly once\n", NUM_ITEMS * NUM_RINGS);
+
+	delete q;
+	delete merger;
+
+	return 0;
+}
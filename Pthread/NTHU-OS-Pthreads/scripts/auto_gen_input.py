@@ -3,11 +3,16 @@
 import click
 import json
 import random
+import struct
+
+# keep in sync with item_record.hpp
+ITEM_RECORD_MAGIC = b'ITEMBIN1'
 
 @click.command()
 @click.option('--input', default='./tests/00_spec.json', help='Input json file path.')
 @click.option('--output', default='./tests/00.out', help='Output file path.')
-def generate(input, output):
+@click.option('--format', 'fmt', default='text', type=click.Choice(['text', 'binary']), help='Output file format.')
+def generate(input, output, fmt):
 	n = 0
 	spec = {}
 
@@ -20,7 +25,10 @@ def generate(input, output):
 		print('\033[1;34;48m' + f'n: {n}' + '\033[1;37;0m')
 		print('\033[1;34;48m' + json.dumps(spec, indent=2) + '\033[1;37;0m')
 
-	with open(output, 'w') as f:
+	with open(output, 'w' if fmt == 'text' else 'wb') as f:
+		if fmt == 'binary':
+			f.write(ITEM_RECORD_MAGIC + struct.pack('<Q', n))
+
 		for i in range(n):
 			key = i + 1
 			val = random.randint(spec['low'], spec['high'])
@@ -32,7 +40,10 @@ def generate(input, output):
 					opcode = random.choice(spec['choices'][c])
 					break
 
-			print(key, val, opcode, file=f)
+			if fmt == 'binary':
+				f.write(struct.pack('<Qic3x', val, key, opcode.encode()))
+			else:
+				print(key, val, opcode, file=f)
 
 	print('\n\033[1;32;48m' + f'done: [{output}].' + '\033[1;37;0m')
 
@@ -0,0 +1,25 @@
+#!/bin/bash
+# Benchmarks sharded execution from 1 to K shards on a generated input.
+#
+#   ./scripts/bench_shards.sh [n] [max shards]
+#
+# The transformer in transformer.cpp decides the per-item cost, generate a
+# cheaper one with auto_gen_transformer.py for large n.
+
+N=${1:-40000}
+K=${2:-$(nproc)}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+cat > "$DIR/spec.json" <<SPEC
+{"n": $N, "auto_gen_input": {"low": 0, "high": 1000000000, "choices": {"$N": ["A", "B", "C"]}}}
+SPEC
+python3 ./scripts/auto_gen_input.py --input "$DIR/spec.json" --output "$DIR/in.bin" --format binary > /dev/null || exit 1
+
+echo "shards  seconds  items/s"
+for ((k = 1; k <= K; k++)); do
+	line=$(./main "$N" "$DIR/in.bin" "$DIR/out.bin" --binary-output --shards "$k" --ordered | grep '^split:')
+	total=$(echo "$line" | sed -E 's/.*total: ([0-9.]+) s.*/\1/')
+	rate=$(echo "$line" | sed -E 's/.*\(([0-9]+) items\/s\).*/\1/')
+	printf "%6d %8s %8s\n" "$k" "$total" "$rate"
+done
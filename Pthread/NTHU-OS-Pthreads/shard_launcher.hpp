@@ -0,0 +1,494 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <vector>
+#include "item.hpp"
+#include "item_record.hpp"
+#include "tracer.hpp"
+
+#ifndef SHARD_LAUNCHER_HPP
+#define SHARD_LAUNCHER_HPP
+
+// what one pipeline process reports back to the launcher
+struct ShardStats {
+	int shard;
+	int items;
+	// the seconds from starting the pipeline until the writer finished
+	double elapsed;
+	int scale_ups;
+	int scale_downs;
+	int max_consumers;
+};
+
+// runs one Reader -> Producer -> Consumer -> Writer chain and fills `stats`
+typedef int (*PipelineFunc)(int n, std::string input_file, std::string output_file,
+                            ItemFormat output_format, std::string trace_file,
+                            ShardStats* stats);
+
+// ShardLauncher splits the first n items of the input into contiguous
+// shards, runs one forked pipeline process per shard and merges their
+// outputs. Shards always write binary output so the merge needs no
+// parsing. Every merge thread loads, optionally sorts and encodes one
+// shard, then writes it at its own offset of the final output. When
+// key-ordered output is asked for and the sorted shards overlap in key
+// range, a sequential k-way merge is used instead.
+class ShardLauncher {
+public:
+	// constructor
+	ShardLauncher(int n, std::string input_file, std::string output_file, int shards,
+	              bool ordered, ItemFormat output_format, std::string trace_file);
+
+	// destructor
+	~ShardLauncher();
+
+	// split, run `pipeline` in every shard, merge and print the report,
+	// must be called before any thread is created
+	int run(PipelineFunc pipeline);
+private:
+	struct MergeTask {
+		ShardLauncher* launcher;
+		int shard;
+		std::vector<Item> items;
+		// the encoded shard, written at `offset` of the output
+		std::string encoded;
+		off_t offset;
+	};
+
+	int n;
+	std::string input_file;
+	std::string output_file;
+	int shards;
+	bool ordered;
+	ItemFormat output_format;
+	std::string trace_file;
+
+	// the number of items given to every shard
+	std::vector<int> counts;
+	std::vector<ShardStats> stats;
+	std::vector<MergeTask> tasks;
+	int output_fd;
+
+	std::string shard_input(int shard);
+	std::string shard_output(int shard);
+
+	bool split();
+	bool launch(PipelineFunc pipeline);
+	// kill and reap the shards already forked when launching fails
+	void abandon(const std::vector<pid_t>& pids, const std::vector<int>& fds);
+	bool merge();
+	void report(double split_time, double run_time, double merge_time);
+
+	// merge thread bodies
+	static void* load(void* arg);
+	static void* store(void* arg);
+
+	bool merge_kway();
+	static std::string encode(const std::vector<Item>& items, ItemFormat format);
+	static double seconds();
+};
+
+// Implementation start
+
+ShardLauncher::ShardLauncher(int n, std::string input_file, std::string output_file, int shards,
+                             bool ordered, ItemFormat output_format, std::string trace_file)
+	: n(n), input_file(input_file), output_file(output_file), shards(shards),
+	ordered(ordered), output_format(output_format), trace_file(trace_file), output_fd(-1) {
+	for (int i = 0; i < shards; i++)
+		counts.push_back(n / shards + (i < n % shards ? 1 : 0));
+}
+
+ShardLauncher::~ShardLauncher() {
+	if (output_fd >= 0)
+		close(output_fd);
+}
+
+std::string ShardLauncher::shard_input(int shard) {
+	return output_file + ".shard" + std::to_string(shard) + ".in";
+}
+
+std::string ShardLauncher::shard_output(int shard) {
+	return output_file + ".shard" + std::to_string(shard) + ".out";
+}
+
+double ShardLauncher::seconds() {
+	return Tracer::clock_ns() / 1e9;
+}
+
+int ShardLauncher::run(PipelineFunc pipeline) {
+	double start = seconds();
+	if (!split())
+		return 1;
+
+	double split_end = seconds();
+	bool ok = launch(pipeline);
+
+	double run_end = seconds();
+	ok = ok && merge();
+
+	double merge_end = seconds();
+	for (int i = 0; i < shards; i++) {
+		unlink(shard_input(i).c_str());
+		unlink(shard_output(i).c_str());
+	}
+
+	if (!ok)
+		return 1;
+
+	report(split_end - start, run_end - split_end, merge_end - run_end);
+	return 0;
+}
+
+bool ShardLauncher::split() {
+	int fd = open(input_file.c_str(), O_RDONLY);
+	if (fd < 0) {
+		std::cerr << "failed to open " << input_file << "\n";
+		return false;
+	}
+
+	// binary input is split by copying record ranges straight from the map
+	struct stat st;
+	unsigned long long count;
+	void* p = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size >= ITEM_RECORD_HEADER_SIZE)
+		p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (p != MAP_FAILED && decode_item_header((unsigned char*)p, st.st_size, &count)) {
+		if (count > (unsigned long long)(st.st_size - ITEM_RECORD_HEADER_SIZE) / ITEM_RECORD_SIZE ||
+		    count < (unsigned long long)n) {
+			std::cerr << input_file << ": fewer than " << n << " records\n";
+			munmap(p, st.st_size);
+			return false;
+		}
+
+		const unsigned char* record = (unsigned char*)p + ITEM_RECORD_HEADER_SIZE;
+		bool ok = true;
+		for (int i = 0; i < shards && ok; i++) {
+			int out = open(shard_input(i).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			unsigned char header[ITEM_RECORD_HEADER_SIZE];
+			encode_item_header(header, counts[i]);
+			ok = out >= 0 && write_all(out, header, ITEM_RECORD_HEADER_SIZE) &&
+			     write_all(out, record, (size_t)counts[i] * ITEM_RECORD_SIZE);
+			record += (size_t)counts[i] * ITEM_RECORD_SIZE;
+			if (out >= 0)
+				close(out);
+		}
+		munmap(p, st.st_size);
+
+		if (!ok)
+			std::cerr << "failed to write shard inputs\n";
+		return ok;
+	}
+
+	if (p != MAP_FAILED)
+		munmap(p, st.st_size);
+
+	// text input is split by lines
+	std::ifstream ifs(input_file);
+	std::string line;
+	for (int i = 0; i < shards; i++) {
+		std::ofstream ofs(shard_input(i));
+		for (int j = 0; j < counts[i]; j++) {
+			if (!std::getline(ifs, line)) {
+				std::cerr << input_file << ": fewer than " << n << " lines\n";
+				return false;
+			}
+			ofs << line << '\n';
+		}
+		if (!ofs) {
+			std::cerr << "failed to write shard inputs\n";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool ShardLauncher::launch(PipelineFunc pipeline) {
+	std::vector<pid_t> pids;
+	std::vector<int> fds;
+
+	for (int i = 0; i < shards; i++) {
+		int fd[2];
+		if (pipe(fd) != 0) {
+			perror("pipe");
+			abandon(pids, fds);
+			return false;
+		}
+
+		// flush before forking so buffered output is not written twice
+		std::cout.flush();
+		fflush(nullptr);
+
+		pid_t pid = fork();
+		if (pid < 0) {
+			perror("fork");
+			close(fd[0]);
+			close(fd[1]);
+			abandon(pids, fds);
+			return false;
+		}
+
+		if (pid == 0) {
+			close(fd[0]);
+
+			ShardStats shard_stats = ShardStats();
+			std::string shard_trace = trace_file.empty() ? "" : trace_file + ".shard" + std::to_string(i);
+			int status = pipeline(counts[i], shard_input(i), shard_output(i), BINARY_FORMAT,
+			                      shard_trace, &shard_stats);
+			shard_stats.shard = i;
+			write_all(fd[1], (unsigned char*)&shard_stats, sizeof(shard_stats));
+
+			// the other pipeline threads never return, skip the destructors
+			std::cout.flush();
+			fflush(nullptr);
+			_exit(status);
+		}
+
+		close(fd[1]);
+		pids.push_back(pid);
+		fds.push_back(fd[0]);
+	}
+
+	bool ok = true;
+	for (int i = 0; i < shards; i++) {
+		ShardStats shard_stats;
+		ssize_t got = 0;
+		while (got < (ssize_t)sizeof(shard_stats)) {
+			ssize_t r = read(fds[i], (char*)&shard_stats + got, sizeof(shard_stats) - got);
+			if (r <= 0)
+				break;
+			got += r;
+		}
+		close(fds[i]);
+
+		int status;
+		waitpid(pids[i], &status, 0);
+		if (got != (ssize_t)sizeof(shard_stats) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			std::cerr << "shard " << i << " failed\n";
+			ok = false;
+			continue;
+		}
+		stats.push_back(shard_stats);
+	}
+
+	return ok;
+}
+
+void ShardLauncher::abandon(const std::vector<pid_t>& pids, const std::vector<int>& fds) {
+	for (size_t i = 0; i < pids.size(); i++) {
+		kill(pids[i], SIGKILL);
+		close(fds[i]);
+	}
+	for (size_t i = 0; i < pids.size(); i++)
+		waitpid(pids[i], nullptr, 0);
+}
+
+std::string ShardLauncher::encode(const std::vector<Item>& items, ItemFormat format) {
+	std::string out;
+	if (format == BINARY_FORMAT) {
+		out.resize(items.size() * ITEM_RECORD_SIZE);
+		for (size_t i = 0; i < items.size(); i++)
+			encode_item((unsigned char*)&out[i * ITEM_RECORD_SIZE], items[i]);
+		return out;
+	}
+
+	char line[64];
+	for (const Item& item : items) {
+		int len = snprintf(line, sizeof(line), "%d %llu %c\n", item.key, item.val, item.opcode);
+		out.append(line, len);
+	}
+	return out;
+}
+
+void* ShardLauncher::load(void* arg) {
+	MergeTask* task = (MergeTask*)arg;
+	ShardLauncher* launcher = task->launcher;
+
+	int fd = open(launcher->shard_output(task->shard).c_str(), O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0 || st.st_size < ITEM_RECORD_HEADER_SIZE) {
+		if (fd >= 0)
+			close(fd);
+		return (void*)1;
+	}
+
+	void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	unsigned long long count;
+	if (p == MAP_FAILED)
+		return (void*)1;
+	if (!decode_item_header((unsigned char*)p, st.st_size, &count) ||
+	    count > (unsigned long long)(st.st_size - ITEM_RECORD_HEADER_SIZE) / ITEM_RECORD_SIZE) {
+		munmap(p, st.st_size);
+		return (void*)1;
+	}
+
+	task->items.resize(count);
+	const unsigned char* record = (unsigned char*)p + ITEM_RECORD_HEADER_SIZE;
+	for (unsigned long long i = 0; i < count; i++)
+		decode_item(record + i * ITEM_RECORD_SIZE, &task->items[i]);
+	munmap(p, st.st_size);
+
+	if (launcher->ordered) {
+		std::stable_sort(task->items.begin(), task->items.end(),
+		                 [](const Item& a, const Item& b) { return a.key < b.key; });
+	}
+
+	task->encoded = encode(task->items, launcher->output_format);
+	return nullptr;
+}
+
+void* ShardLauncher::store(void* arg) {
+	MergeTask* task = (MergeTask*)arg;
+	const char* buf = task->encoded.data();
+	size_t length = task->encoded.size();
+	off_t offset = task->offset;
+
+	while (length > 0) {
+		ssize_t w = pwrite(task->launcher->output_fd, buf, length, offset);
+		if (w <= 0)
+			return (void*)1;
+		buf += w;
+		length -= w;
+		offset += w;
+	}
+
+	return nullptr;
+}
+
+bool ShardLauncher::merge() {
+	tasks.resize(shards);
+	std::vector<pthread_t> threads(shards);
+	bool ok = true;
+
+	for (int i = 0; i < shards; i++) {
+		tasks[i].launcher = this;
+		tasks[i].shard = i;
+		pthread_create(&threads[i], 0, ShardLauncher::load, (void*)&tasks[i]);
+	}
+	for (int i = 0; i < shards; i++) {
+		void* result;
+		pthread_join(threads[i], &result);
+		if (result != nullptr) {
+			std::cerr << "failed to load " << shard_output(i) << "\n";
+			ok = false;
+		}
+	}
+	if (!ok)
+		return false;
+
+	output_fd = open(output_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (output_fd < 0) {
+		std::cerr << "failed to open " << output_file << "\n";
+		return false;
+	}
+
+	if (ordered) {
+		// concatenating sorted shards is only ordered when their key
+		// ranges follow each other
+		int last_key = 0;
+		bool first = true;
+		for (MergeTask& task : tasks) {
+			if (task.items.empty())
+				continue;
+			if (!first && task.items.front().key < last_key)
+				return merge_kway();
+			last_key = task.items.back().key;
+			first = false;
+		}
+	}
+
+	off_t offset = 0;
+	if (output_format == BINARY_FORMAT) {
+		unsigned char header[ITEM_RECORD_HEADER_SIZE];
+		encode_item_header(header, n);
+		if (!write_all(output_fd, header, ITEM_RECORD_HEADER_SIZE))
+			return false;
+		offset = ITEM_RECORD_HEADER_SIZE;
+	}
+	for (MergeTask& task : tasks) {
+		task.offset = offset;
+		offset += task.encoded.size();
+	}
+
+	for (int i = 0; i < shards; i++)
+		pthread_create(&threads[i], 0, ShardLauncher::store, (void*)&tasks[i]);
+	for (int i = 0; i < shards; i++) {
+		void* result;
+		pthread_join(threads[i], &result);
+		if (result != nullptr)
+			ok = false;
+	}
+
+	if (!ok)
+		std::cerr << "failed to write " << output_file << "\n";
+	return ok;
+}
+
+bool ShardLauncher::merge_kway() {
+	// (key, shard) pairs, smallest key first and lower shard on ties
+	typedef std::pair<int, int> Head;
+	std::priority_queue<Head, std::vector<Head>, std::greater<Head> > heads;
+	std::vector<size_t> next(shards, 0);
+
+	for (int i = 0; i < shards; i++) {
+		if (!tasks[i].items.empty())
+			heads.push(Head(tasks[i].items[0].key, i));
+	}
+
+	std::vector<Item> merged;
+	merged.reserve(n);
+	while (!heads.empty()) {
+		int shard = heads.top().second;
+		heads.pop();
+		merged.push_back(tasks[shard].items[next[shard]++]);
+		if (next[shard] < tasks[shard].items.size())
+			heads.push(Head(tasks[shard].items[next[shard]].key, shard));
+	}
+
+	std::string out;
+	if (output_format == BINARY_FORMAT) {
+		unsigned char header[ITEM_RECORD_HEADER_SIZE];
+		encode_item_header(header, n);
+		out.assign((char*)header, ITEM_RECORD_HEADER_SIZE);
+	}
+	out += encode(merged, output_format);
+
+	if (!write_all(output_fd, (unsigned char*)out.data(), out.size())) {
+		std::cerr << "failed to write " << output_file << "\n";
+		return false;
+	}
+	return true;
+}
+
+void ShardLauncher::report(double split_time, double run_time, double merge_time) {
+	int total_items = 0;
+	double slowest = 0;
+
+	std::cout << "shard  items  seconds  scale-ups  scale-downs  max-consumers\n";
+	for (ShardStats& s : stats) {
+		printf("%5d %6d %8.3f %10d %12d %14d\n", s.shard, s.items, s.elapsed,
+		       s.scale_ups, s.scale_downs, s.max_consumers);
+		total_items += s.items;
+		slowest = std::max(slowest, s.elapsed);
+	}
+
+	double total = split_time + run_time + merge_time;
+	printf("shards: %d  items: %d  slowest shard: %.3f s\n", shards, total_items, slowest);
+	printf("split: %.3f s  run: %.3f s  merge: %.3f s  total: %.3f s  (%.0f items/s)\n",
+	       split_time, run_time, merge_time, total, total > 0 ? total_items / total : 0.0);
+	fflush(stdout);
+}
+
+#endif // SHARD_LAUNCHER_HPP
@@ -0,0 +1,105 @@
+#include <atomic>
+
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+// A bounded lock-free ring with exactly one pushing thread and one popping
+// thread. The head and tail only grow, the slot index is taken modulo the
+// capacity.
+template <class T>
+class SPSCRing {
+public:
+	// constructor
+	explicit SPSCRing(int capacity);
+
+	// destructor
+	~SPSCRing();
+
+	// add an element to the end of the ring, return false when it is full
+	bool try_push(T item);
+
+	// remove the first element of the ring, return false when it is empty
+	bool try_pop(T* item);
+
+	// return whether the ring holds no element
+	bool empty();
+
+	// return the maximum number of elements
+	int get_capacity();
+
+	// mark that the pushing thread will not push anymore
+	void close();
+
+	// return whether close() was called
+	bool is_closed();
+private:
+	// the maximum number of elements
+	int capacity;
+	// the buffer containing values of the ring
+	T* buffer;
+
+	// the number of elements popped so far, written by the popping thread
+	std::atomic<unsigned long> head;
+	// keep head and tail on separate cache lines
+	char pad[64];
+	// the number of elements pushed so far, written by the pushing thread
+	std::atomic<unsigned long> tail;
+
+	std::atomic<bool> closed;
+};
+
+// Implementation start
+
+template <class T>
+SPSCRing<T>::SPSCRing(int capacity) : capacity(capacity), head(0), tail(0), closed(false) {
+	buffer = new T[capacity];
+}
+
+template <class T>
+SPSCRing<T>::~SPSCRing() {
+	delete[] buffer;
+}
+
+template <class T>
+bool SPSCRing<T>::try_push(T item) {
+	unsigned long t = tail.load(std::memory_order_relaxed);
+	if (t - head.load(std::memory_order_acquire) == (unsigned long)capacity)
+		return false;
+
+	buffer[t % capacity] = item;
+	tail.store(t + 1, std::memory_order_release);
+	return true;
+}
+
+template <class T>
+bool SPSCRing<T>::try_pop(T* item) {
+	unsigned long h = head.load(std::memory_order_relaxed);
+	if (h == tail.load(std::memory_order_acquire))
+		return false;
+
+	*item = buffer[h % capacity];
+	head.store(h + 1, std::memory_order_release);
+	return true;
+}
+
+template <class T>
+bool SPSCRing<T>::empty() {
+	return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+}
+
+template <class T>
+int SPSCRing<T>::get_capacity() {
+	return capacity;
+}
+
+template <class T>
+void SPSCRing<T>::close() {
+	closed.store(true, std::memory_order_release);
+}
+
+template <class T>
+bool SPSCRing<T>::is_closed() {
+	return closed.load(std::memory_order_acquire);
+}
+
+#endif // SPSC_RING_HPP
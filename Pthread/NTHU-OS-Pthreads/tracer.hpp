@@ -0,0 +1,222 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#ifndef TRACER_HPP
+#define TRACER_HPP
+
+// the maximum number of events kept for each thread, later events are dropped
+#define TRACE_BUFFER_SIZE 65536
+
+struct TraceEvent {
+	// the event name, always a string literal
+	const char* name;
+	// 'X' for a complete span, 'i' for an instant event
+	char phase;
+	// the start time in nanoseconds since the tracer was enabled
+	long long ts;
+	// the duration in nanoseconds, 0 for instant events
+	long long dur;
+	// an optional argument, ignored when negative
+	int arg;
+};
+
+// A TraceBuffer is written only by its owner thread, so recording an event
+// takes no lock. The dumper may read it concurrently up to `count`.
+class TraceBuffer {
+public:
+	// constructor
+	explicit TraceBuffer(int tid);
+
+	// destructor
+	~TraceBuffer();
+
+	// append an event, or count it as dropped when the buffer is full
+	void push(const char* name, char phase, long long ts, long long dur, int arg);
+
+	// the thread id shown in the trace viewer
+	int tid;
+	// the thread name shown in the trace viewer
+	std::atomic<const char*> thread_name;
+	// the events recorded so far
+	TraceEvent* events;
+	// the number of events published to the dumper
+	std::atomic<int> count;
+	// the number of events lost because the buffer was full
+	std::atomic<long long> dropped;
+};
+
+class Tracer {
+public:
+	// start recording events, must be called before any thread is started
+	static void enable();
+
+	// return whether events are recorded
+	static bool is_enabled();
+
+	// return the current time in nanoseconds, or 0 when tracing is disabled
+	static long long now();
+
+	// name the calling thread in the trace
+	static void set_thread_name(const char* name);
+
+	// record a span named `name` from `start` (returned by now()) until now
+	static void span(const char* name, long long start);
+
+	// record an instant event with an optional argument
+	static void instant(const char* name, int arg);
+
+	// write all recorded events as Chrome trace-event JSON
+	static bool dump(std::string output_file);
+
+	// return the monotonic clock in nanoseconds, whether enabled or not
+	static long long clock_ns();
+private:
+	static bool enabled;
+	// the time in nanoseconds when the tracer was enabled
+	static long long origin;
+
+	// protects `buffers`, only taken the first time a thread records an event
+	static pthread_mutex_t mutex;
+	static std::vector<TraceBuffer*> buffers;
+
+	// the buffer of the calling thread
+	static thread_local TraceBuffer* local_buffer;
+
+	// return the buffer of the calling thread, registering it on first use
+	static TraceBuffer* local();
+};
+
+// Implementation start
+
+TraceBuffer::TraceBuffer(int tid) : tid(tid), thread_name("Thread"), count(0), dropped(0) {
+	events = new TraceEvent[TRACE_BUFFER_SIZE];
+}
+
+TraceBuffer::~TraceBuffer() {
+	delete[] events;
+}
+
+void TraceBuffer::push(const char* name, char phase, long long ts, long long dur, int arg) {
+	int n = count.load(std::memory_order_relaxed);
+	if (n == TRACE_BUFFER_SIZE) {
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	TraceEvent& event = events[n];
+	event.name = name;
+	event.phase = phase;
+	event.ts = ts;
+	event.dur = dur;
+	event.arg = arg;
+
+	// publish the event to the dumper
+	count.store(n + 1, std::memory_order_release);
+}
+
+bool Tracer::enabled = false;
+long long Tracer::origin = 0;
+pthread_mutex_t Tracer::mutex = PTHREAD_MUTEX_INITIALIZER;
+std::vector<TraceBuffer*> Tracer::buffers;
+thread_local TraceBuffer* Tracer::local_buffer = nullptr;
+
+void Tracer::enable() {
+	origin = clock_ns();
+	enabled = true;
+}
+
+bool Tracer::is_enabled() {
+	return enabled;
+}
+
+long long Tracer::clock_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+long long Tracer::now() {
+	if (!enabled)
+		return 0;
+
+	return clock_ns() - origin;
+}
+
+TraceBuffer* Tracer::local() {
+	if (local_buffer == nullptr) {
+		pthread_mutex_lock(&mutex);
+		local_buffer = new TraceBuffer(buffers.size());
+		buffers.push_back(local_buffer);
+		pthread_mutex_unlock(&mutex);
+	}
+
+	return local_buffer;
+}
+
+void Tracer::set_thread_name(const char* name) {
+	if (!enabled)
+		return;
+
+	local()->thread_name.store(name, std::memory_order_release);
+}
+
+void Tracer::span(const char* name, long long start) {
+	if (!enabled)
+		return;
+
+	local()->push(name, 'X', start, now() - start, -1);
+}
+
+void Tracer::instant(const char* name, int arg) {
+	if (!enabled)
+		return;
+
+	local()->push(name, 'i', now(), 0, arg);
+}
+
+bool Tracer::dump(std::string output_file) {
+	FILE* f = fopen(output_file.c_str(), "w");
+	if (f == nullptr)
+		return false;
+
+	pthread_mutex_lock(&mutex);
+	std::vector<TraceBuffer*> snapshot(buffers);
+	pthread_mutex_unlock(&mutex);
+
+	// timestamps are written in microseconds as the format requires
+	const char* sep = "\n";
+	fprintf(f, "{\"traceEvents\":[");
+	for (TraceBuffer* buffer : snapshot) {
+		fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+				"\"args\":{\"name\":\"%s\"}}",
+				sep, buffer->tid, buffer->thread_name.load(std::memory_order_acquire));
+		sep = ",\n";
+
+		int n = buffer->count.load(std::memory_order_acquire);
+		for (int i = 0; i < n; i++) {
+			TraceEvent& event = buffer->events[i];
+			fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%.3f",
+					sep, event.name, event.phase, buffer->tid, event.ts / 1000.0);
+			if (event.phase == 'X')
+				fprintf(f, ",\"dur\":%.3f", event.dur / 1000.0);
+			else
+				fprintf(f, ",\"s\":\"t\"");
+			if (event.arg >= 0)
+				fprintf(f, ",\"args\":{\"value\":%d}", event.arg);
+			fprintf(f, "}");
+		}
+
+		long long dropped = buffer->dropped.load(std::memory_order_relaxed);
+		if (dropped > 0)
+			fprintf(stderr, "tracer: thread %d dropped %lld events\n", buffer->tid, dropped);
+	}
+	fprintf(f, "\n],\"displayTimeUnit\":\"ns\"}\n");
+
+	return fclose(f) == 0;
+}
+
+#endif // TRACER_HPP
@@ -0,0 +1,47 @@
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include "tracer.hpp"
+
+#define NUM_THREADS 4
+#define NUM_SPANS 60000
+
+// measures the cost of recording one span on each of NUM_THREADS threads
+void* record(void* arg) {
+	Tracer::set_thread_name("Recorder");
+
+	for (int i = 0; i < NUM_SPANS; i++) {
+		long long start = Tracer::now();
+		Tracer::span("transform", start);
+	}
+
+	return nullptr;
+}
+
+double run() {
+	struct timespec start, end;
+	pthread_t threads[NUM_THREADS];
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < NUM_THREADS; i++)
+		pthread_create(&threads[i], 0, record, nullptr);
+	for (int i = 0; i < NUM_THREADS; i++)
+		pthread_join(threads[i], 0);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double elapsed = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+	return elapsed / ((double)NUM_THREADS * NUM_SPANS);
+}
+
+int main() {
+	printf("disabled: %.2f ns/span\n", run());
+
+	Tracer::enable();
+	printf("enabled: %.2f ns/span\n", run());
+
+	Tracer::instant("scale up", 1);
+	if (!Tracer::dump("./tests/tracer_test.json"))
+		return 1;
+
+	return 0;
+}
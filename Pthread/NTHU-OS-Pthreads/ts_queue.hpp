@@ -1,4 +1,6 @@
 #include <pthread.h>
+#include "tracer.hpp"
+#include "resizable.hpp"
 
 #ifndef TS_QUEUE_HPP
 #define TS_QUEUE_HPP
@@ -6,7 +8,7 @@
 #define DEFAULT_BUFFER_SIZE 200
 
 template <class T>
-class TSQueue {
+class TSQueue : public Resizable {
 public:
 	// constructor
 	TSQueue();
@@ -23,7 +25,18 @@ public:
 	T dequeue();
 
 	// return the number of elements in the queue
-	int get_size();
+	virtual int get_size() override;
+
+	// reallocate the buffer with a new maximum size, never below the
+	// number of elements in the queue
+	virtual void resize(int new_buffer_size) override;
+
+	// return the maximum buffer size
+	virtual int get_capacity() override;
+
+	virtual int get_allocated() override;
+
+	virtual long long take_blocked_full_ns() override;
 private:
 	// the maximum buffer size
 	int buffer_size;
@@ -35,6 +48,8 @@ private:
 	int head;
 	// the index of last item in the queue
 	int tail;
+	// the nanoseconds enqueue() waited on a full buffer
+	long long blocked_full_ns;
 
 	// pthread mutex lock
 	pthread_mutex_t mutex;
@@ -58,6 +73,7 @@ TSQueue<T>::TSQueue(int buffer_size) : buffer_size(buffer_size) {
 	buffer = new T[buffer_size];
 	size = 0;
 	head = tail = 0;
+	blocked_full_ns = 0;
 }
 
 template <class T>
@@ -74,8 +90,14 @@ template <class T>
 void TSQueue<T>::enqueue(T item) {
 	// TODO: enqueues an element to the end of the queue
 	pthread_mutex_lock(&mutex);  // start enqueue
-	while (size == buffer_size) {
-		pthread_cond_wait(&cond_enqueue, &mutex);
+	if (size == buffer_size) {
+		long long start = Tracer::clock_ns();
+		while (size == buffer_size) {
+			pthread_cond_wait(&cond_enqueue, &mutex);
+		}
+		long long blocked = Tracer::clock_ns() - start;
+		blocked_full_ns += blocked;
+		Tracer::span("blocked on enqueue", Tracer::now() - blocked);
 	}
 
 	buffer[tail] = item;
@@ -90,8 +112,12 @@ template <class T>
 T TSQueue<T>::dequeue() {
 	// TODO: dequeues the first element of the queue
 	pthread_mutex_lock(&mutex);  // start dequeue
-	while (size == 0) {
-		pthread_cond_wait(&cond_dequeue, &mutex);
+	if (size == 0) {
+		long long start = Tracer::now();
+		while (size == 0) {
+			pthread_cond_wait(&cond_dequeue, &mutex);
+		}
+		Tracer::span("blocked on dequeue", start);
 	}
 
 	T item = buffer[head];
@@ -114,4 +140,52 @@ int TSQueue<T>::get_size() {
 	return stable_val;
 }
 
+template <class T>
+void TSQueue<T>::resize(int new_buffer_size) {
+	pthread_mutex_lock(&mutex);
+	if (new_buffer_size < size)
+		new_buffer_size = size;
+	if (new_buffer_size < 1)
+		new_buffer_size = 1;
+
+	// move the elements to the front of the new buffer
+	T* new_buffer = new T[new_buffer_size];
+	for (int i = 0; i < size; i++)
+		new_buffer[i] = buffer[(head + i) % buffer_size];
+
+	delete[] buffer;
+	buffer = new_buffer;
+	buffer_size = new_buffer_size;
+	head = 0;
+	tail = size % buffer_size;
+
+	// enqueuers blocked on the old size may fit now
+	pthread_cond_broadcast(&cond_enqueue);
+	pthread_mutex_unlock(&mutex);
+}
+
+template <class T>
+int TSQueue<T>::get_capacity() {
+	pthread_mutex_lock(&mutex);
+	int stable_val = buffer_size;
+	pthread_mutex_unlock(&mutex);
+
+	return stable_val;
+}
+
+template <class T>
+int TSQueue<T>::get_allocated() {
+	return get_capacity();
+}
+
+template <class T>
+long long TSQueue<T>::take_blocked_full_ns() {
+	pthread_mutex_lock(&mutex);
+	long long stable_val = blocked_full_ns;
+	blocked_full_ns = 0;
+	pthread_mutex_unlock(&mutex);
+
+	return stable_val;
+}
+
 #endif // TS_QUEUE_HPP
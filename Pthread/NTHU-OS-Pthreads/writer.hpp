@@ -1,7 +1,12 @@
+#include <fcntl.h>
+#include <unistd.h>
 #include <fstream>
+#include <iostream>
 #include "thread.hpp"
 #include "ts_queue.hpp"
+#include "output_merger.hpp"
 #include "item.hpp"
+#include "item_record.hpp"
 
 #ifndef WRITER_HPP
 #define WRITER_HPP
@@ -9,7 +14,12 @@
 class Writer : public Thread {
 public:
 	// constructor
-	Writer(int expected_lines, std::string output_file, TSQueue<Item*>* output_queue);
+	Writer(int expected_lines, std::string output_file, TSQueue<Item*>* output_queue,
+	       ItemFormat format = TEXT_FORMAT);
+
+	// constructor, drains the rings of all Consumers instead of one queue
+	Writer(int expected_lines, std::string output_file, OutputMerger* output_merger,
+	       ItemFormat format = TEXT_FORMAT);
 
 	// destructor
 	~Writer();
@@ -22,24 +32,92 @@ private:
 
 	std::ofstream ofs;
 	TSQueue<Item*> *output_queue;
+	OutputMerger* output_merger;
 
 	std::string output_file_name;
 
+	ItemFormat format;
+	// the binary output, -1 for text output
+	int fd;
+	// records collected for the next write()
+	unsigned char* block;
+	int block_records;
+	bool header_written;
+
+	// open the output file in `format`
+	void open_output();
+
+	// write the collected records
+	void flush_block();
+
 	// the method for pthread to create a writer thread
 	static void* process(void* arg);
 };
 
 // Implementation start
 
-Writer::Writer(int expected_lines, std::string output_file, TSQueue<Item*>* output_queue)
-	: expected_lines(expected_lines), output_queue(output_queue) {
-	ofs = std::ofstream(output_file);
+Writer::Writer(int expected_lines, std::string output_file, TSQueue<Item*>* output_queue,
+               ItemFormat format)
+	: expected_lines(expected_lines), output_queue(output_queue), output_merger(nullptr),
+	output_file_name(output_file), format(format) {
+	open_output();
+}
+
+Writer::Writer(int expected_lines, std::string output_file, OutputMerger* output_merger,
+               ItemFormat format)
+	: expected_lines(expected_lines), output_queue(nullptr), output_merger(output_merger),
+	output_file_name(output_file), format(format) {
+	open_output();
 }
 
 Writer::~Writer() {
+	if (fd >= 0)
+		close(fd);
+	delete[] block;
 	ofs.close();
 }
 
+void Writer::open_output() {
+	fd = -1;
+	block = nullptr;
+	block_records = 0;
+	header_written = false;
+
+	if (format == TEXT_FORMAT) {
+		ofs = std::ofstream(output_file_name);
+		return;
+	}
+
+	fd = open(output_file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		std::cerr << "failed to open " << output_file_name << "\n";
+		return;
+	}
+
+	// the header is written in front of the first block
+	block = new unsigned char[ITEM_RECORD_HEADER_SIZE + ITEM_RECORD_BLOCK * ITEM_RECORD_SIZE];
+	encode_item_header(block, expected_lines);
+}
+
+void Writer::flush_block() {
+	if (fd < 0)
+		return;
+
+	// the first block also carries the header in front of the records
+	unsigned char* begin = block + ITEM_RECORD_HEADER_SIZE;
+	size_t length = (size_t)block_records * ITEM_RECORD_SIZE;
+	if (!header_written) {
+		begin = block;
+		length += ITEM_RECORD_HEADER_SIZE;
+		header_written = true;
+	}
+
+	if (!write_all(fd, begin, length))
+		std::cerr << "failed to write " << output_file_name << "\n";
+
+	block_records = 0;
+}
+
 void Writer::start() {
 	// TODO: starts a Writer thread
 	pthread_create(&t, 0, Writer::process, (void*)this);
@@ -48,13 +126,27 @@ void Writer::start() {
 void* Writer::process(void* arg) {
 	// TODO: implements the Writer's work
 	Writer* writer = (Writer*)arg;
+	Tracer::set_thread_name("Writer");
 
 	while (writer->expected_lines--) {
 		// Take an Item from the Output Queue
-		Item *item = writer->output_queue->dequeue();
-		writer->ofs << *item;
+		Item *item = writer->output_merger ? writer->output_merger->pop()
+		                                   : writer->output_queue->dequeue();
+		long long start = Tracer::now();
+		if (writer->format == BINARY_FORMAT && writer->fd >= 0) {
+			encode_item(writer->block + ITEM_RECORD_HEADER_SIZE +
+			            writer->block_records * ITEM_RECORD_SIZE, *item);
+			if (++writer->block_records == ITEM_RECORD_BLOCK)
+				writer->flush_block();
+		} else {
+			writer->ofs << *item;
+		}
+		Tracer::span("write", start);
 	}
 
+	if (writer->format == BINARY_FORMAT)
+		writer->flush_block();
+
 	return nullptr;
 }
 